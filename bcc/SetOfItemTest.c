@@ -111,7 +111,7 @@ void set_of_int_tests() {
 int unit_tests(__attribute__((unused)) int argc, __attribute__((unused)) char **argv) {
     set_of_str_tests();
     set_of_int_tests();
-    return 0;
+    return containers_test() != 0;
 }
 
 #pragma clang diagnostic pop
\ No newline at end of file
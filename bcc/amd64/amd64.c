@@ -59,11 +59,13 @@ const char * const opcode_names[] = {
 #define X(a,b,c) b
         OPCODE_LIST__
 #undef X
+        "",     // OPCODE_NONE
 };
 const unsigned char opcode_num_operands[] = {
 #define X(a,b,c) c
         OPCODE_LIST__
 #undef X
+        0,      // OPCODE_NONE
 };
 
 const char* const cond_code_suffix[] = {
@@ -82,15 +84,9 @@ const enum OPCODE cond_code_to_setXX[] = {
 #undef X
 };
 
-struct list_of_Amd64Instruction_helpers list_of_Amd64Instruction_helpers = {
-    .delete = Amd64Instruction_delete
-};
-LIST_OF_ITEM_DEFN(list_of_Amd64Instruction,struct Amd64Instruction*)
+LIST_OF_ITEM_DEFN_STATIC(list_of_Amd64Instruction,struct Amd64Instruction*,Amd64Instruction_delete)
 
-struct list_of_amd64_top_level_helpers list_of_amd64_top_level_helpers = {
-        .delete = amd64_top_level_delete,
-};
-LIST_OF_ITEM_DEFN(list_of_amd64_top_level,struct Amd64TopLevel*)
+LIST_OF_ITEM_DEFN_STATIC(list_of_amd64_top_level,struct Amd64TopLevel*,amd64_top_level_delete)
 #include "inc/constant.h"
 
 struct Amd64Program* amd64_program_new(void ) {
@@ -111,11 +107,12 @@ void amd64_program_delete(struct Amd64Program *program) {
     free(program);
 }
 
-struct Amd64Function* amd64_function_new(const char* name, bool global) {
+struct Amd64Function* amd64_function_new(uint32_t name, bool global) {
     struct Amd64Function* result = (struct Amd64Function*)malloc(sizeof(struct Amd64Function));
     result->name = name;
     result->global = global;
-    list_of_Amd64Instruction_init(&result->instructions, 101);
+    list_of_Amd64Instruction_init(&result->instructions, 0);
+    list_of_IrLabel_init(&result->labels, 0);
     return result;
 }
 void amd64_function_append_instruction(struct Amd64Function *function, struct Amd64Instruction *instruction) {
@@ -123,10 +120,11 @@ void amd64_function_append_instruction(struct Amd64Function *function, struct Am
 }
 void amd64_function_delete(struct Amd64Function *function) {
     list_of_Amd64Instruction_delete(&function->instructions);
+    list_of_IrLabel_delete(&function->labels);
     free(function);
 }
 
-struct Amd64StaticVar *amd64_static_var_new(const char *name, bool global, struct Constant init_val) {
+struct Amd64StaticVar *amd64_static_var_new(uint32_t name, bool global, struct Constant init_val) {
     struct Amd64StaticVar *result = (struct Amd64StaticVar *)malloc(sizeof(struct Amd64StaticVar));
     result->name = name;
     result->global = global;
@@ -166,8 +164,8 @@ void amd64_top_level_delete(struct Amd64TopLevel *top_level) {
 
 static struct Amd64Instruction* amd64_instruction_new(enum INSTRUCTION instruction, enum OPCODE opcode) {
     struct Amd64Instruction* inst = (struct Amd64Instruction *)malloc(sizeof(struct Amd64Instruction));
-    inst->instruction = instruction;
-    inst->opcode = opcode;
+    // Instructions with fewer operands leave the others as OPERAND_NONE.
+    *inst = (struct Amd64Instruction){.instruction = instruction, .opcode = opcode};
     return inst;
 }
 struct Amd64Instruction* amd64_instruction_new_call(struct Amd64Operand identifier) {
@@ -201,7 +199,7 @@ struct Amd64Instruction* amd64_instruction_new_cmp(struct Amd64Operand operand1,
     return inst;
 }
 struct Amd64Instruction* amd64_instruction_new_comment(const char *text) {
-    struct Amd64Instruction* inst = amd64_instruction_new(INST_COMMENT, 0 /* None */);
+    struct Amd64Instruction* inst = amd64_instruction_new(INST_COMMENT, OPCODE_NONE);
     inst->text = text;
     return inst;
 }
@@ -274,10 +272,10 @@ struct Amd64Operand amd64_operand_reg(enum REGISTER reg) {
     };
     return reg_operand;
 };
-struct Amd64Operand amd64_operand_pseudo(const char* pseudo_name) {
+struct Amd64Operand amd64_operand_pseudo(int var) {
     struct Amd64Operand pseudo_operand = {
             .operand_kind = OPERAND_PSEUDO,
-            .name = pseudo_name
+            .pseudo = var
     };
     return pseudo_operand;
 };
@@ -288,17 +286,17 @@ struct Amd64Operand amd64_operand_stack(int offset) {
     };
     return stack_operand;
 };
-struct Amd64Operand amd64_operand_func(const char* func_name) {
+struct Amd64Operand amd64_operand_func(uint32_t func_name) {
     struct Amd64Operand func_operand = {
             .operand_kind = OPERAND_FUNC,
             .name = func_name
     };
     return func_operand;
 }
-struct Amd64Operand amd64_operand_label(const char* label) {
+struct Amd64Operand amd64_operand_label(int label) {
     struct Amd64Operand pseudo_operand = {
             .operand_kind = OPERAND_LABEL,
-            .name = label
+            .label = label
     };
     return pseudo_operand;
 };
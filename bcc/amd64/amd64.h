@@ -147,17 +147,19 @@ extern char const * register_names[16][4];
 struct Amd64Operand {
     enum OPERAND operand_kind;
     union {
-        const char *name;
+        uint32_t name;      // string pool id of an OPERAND_FUNC or OPERAND_DATA
+        int pseudo;         // index of an OPERAND_PSEUDO's variable in the IrFunction's vars
+        int label;          // index of an OPERAND_LABEL in the function's labels
         int offset;
         enum REGISTER reg;
         int int_val;
     };
 };
-extern struct Amd64Operand amd64_operand_func(const char* func_name);
+extern struct Amd64Operand amd64_operand_func(uint32_t func_name);
 extern struct Amd64Operand amd64_operand_imm_int(int int_val);
-extern struct Amd64Operand amd64_operand_label(const char* label);
+extern struct Amd64Operand amd64_operand_label(int label);
 extern struct Amd64Operand amd64_operand_none;
-extern struct Amd64Operand amd64_operand_pseudo(const char* pseudo_name);
+extern struct Amd64Operand amd64_operand_pseudo(int var);
 extern struct Amd64Operand amd64_operand_reg(enum REGISTER reg);
 extern struct Amd64Operand amd64_operand_stack(int offset);
 //endregion
@@ -206,23 +208,24 @@ extern void Amd64Instruction_delete(struct Amd64Instruction *instruction);
 LIST_OF_ITEM_DECL(list_of_Amd64Instruction,struct Amd64Instruction*)
 
 struct Amd64Function {
-    const char *name;
+    uint32_t name;
     bool global;
     int stack_allocations;
     struct list_of_Amd64Instruction instructions;
+    struct list_of_IrLabel labels;          // Indexed by the label of OPERAND_LABELs; named when emitted.
 };
-extern struct Amd64Function* amd64_function_new(const char *name, bool global);
+extern struct Amd64Function* amd64_function_new(uint32_t name, bool global);
 extern void amd64_function_append_instruction(struct Amd64Function *function, struct Amd64Instruction *instruction);
 extern void amd64_function_delete(struct Amd64Function *function);
 //endregion
 
 //region struct Amd64StaticVar
 struct Amd64StaticVar {
-    const char *name;
+    uint32_t name;
     bool global;
     struct Constant init_val;
 };
-extern struct Amd64StaticVar *amd64_static_var_new(const char *name, bool global, struct Constant init_val);
+extern struct Amd64StaticVar *amd64_static_var_new(uint32_t name, bool global, struct Constant init_val);
 extern void amd64_static_var_delete(struct Amd64StaticVar *static_var);
 //endregion
 
@@ -254,7 +257,14 @@ extern struct Amd64Program* amd64_program_new(void );
 extern void amd64_program_add_function(struct Amd64Program* program, struct Amd64Function* function);
 extern void amd64_program_add_static_var(struct Amd64Program* program, struct Amd64StaticVar* static_var);
 extern void amd64_program_delete(struct Amd64Program *program);
-extern void amd64_program_emit(struct Amd64Program *amd64Program, FILE *out);
+extern void amd64_program_emit(struct Amd64Program *amd64Program, FILE *out, FILE *echo);
+
+// Emits a program a function at a time.
+struct Amd64Emitter;
+extern struct Amd64Emitter *amd64_emitter_new(FILE *out, FILE *echo);
+extern void amd64_emitter_emit_function(struct Amd64Emitter *emitter, struct Amd64Function *function);
+extern void amd64_emitter_emit_program(struct Amd64Emitter *emitter, struct Amd64Program *amd64Program);
+extern void amd64_emitter_delete(struct Amd64Emitter *emitter);
 //endregion
 
 #endif //BCC_AMD64_H
@@ -2,157 +2,351 @@
 // Created by Bill Evans on 11/3/24.
 //
 
-#include <string.h>
 #include <assert.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 
 #include "amd64.h"
 
-static int amd64_top_level_print(struct Amd64TopLevel *pAmd64TopLevel, FILE *out);
-static int amd64_function_print(struct Amd64Function *amd64Function, FILE *out);
-static int amd64_static_var_print(struct Amd64StaticVar *amd64StaticVar, FILE *out);
-void amd64_program_emit(struct Amd64Program *amd64Program, FILE *out) {
+/*
+ * The assembly is formatted into one large buffer, and written with a few large write() calls. Mnemonics,
+ * with their size suffix and padding, and register names are formatted once, up front; integers are
+ * formatted by hand.
+ */
+#define EMIT_BUFFER_SIZE (1024 * 1024)
+// Longest run of bytes appended without a check for room; every name is appended with its own check.
+#define EMIT_LINE_RESERVE 128
+
+struct emit_buffer {
+    char *text;
+    size_t length;
+    int fd;
+    int echo_fd;            // -1 if none
+};
+
+// "       movl    ": the indent and mnemonic of every instruction, padded like "%-8s".
+#define INST_INDENT "       "
+#define MNEMONIC_WIDTH 8
+#define INST_PREFIX_SIZE (sizeof(INST_INDENT) - 1 + MNEMONIC_WIDTH + OPCODE_BUF_SIZE)
+enum SUFFIX { SUFFIX_NONE, SUFFIX_L, SUFFIX_Q, NUM_SUFFIXES };
+static char inst_prefixes[OPCODE_NONE][NUM_SUFFIXES][INST_PREFIX_SIZE];
+static unsigned char inst_prefix_lengths[OPCODE_NONE][NUM_SUFFIXES];
+static unsigned char register_name_lengths[16][4];
+static bool tables_initialized;
+
+static void init_tables(void) {
+    static const char *const suffixes[NUM_SUFFIXES] = {"", "l", "q"};
+    for (int op = 0; op < OPCODE_NONE; ++op) {
+        for (int sx = 0; sx < NUM_SUFFIXES; ++sx) {
+            int n = snprintf(inst_prefixes[op][sx], INST_PREFIX_SIZE, INST_INDENT "%s%s",
+                             opcode_names[op], suffixes[sx]);
+            while (n < (int)(sizeof(INST_INDENT) - 1 + MNEMONIC_WIDTH)) inst_prefixes[op][sx][n++] = ' ';
+            inst_prefixes[op][sx][n] = '\0';
+            inst_prefix_lengths[op][sx] = n;
+        }
+    }
+    for (int reg = 0; reg < 16; ++reg) {
+        for (int size_ix = 0; size_ix < 4; ++size_ix) {
+            register_name_lengths[reg][size_ix] = strlen(register_names[reg][size_ix]);
+        }
+    }
+    tables_initialized = true;
+}
+
+static void write_all(int fd, const char *text, size_t length) {
+    while (length > 0) {
+        ssize_t n = write(fd, text, length);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            failf("Error writing assembly: %s", strerror(errno));
+            return;
+        }
+        text += n;
+        length -= n;
+    }
+}
+
+static void flush(struct emit_buffer *b) {
+    write_all(b->fd, b->text, b->length);
+    if (b->echo_fd >= 0) write_all(b->echo_fd, b->text, b->length);
+    b->length = 0;
+}
+
+// Makes room for at least n more bytes.
+static inline void reserve(struct emit_buffer *b, size_t n) {
+    if (b->length + n > EMIT_BUFFER_SIZE) flush(b);
+}
+
+// Appends bytes that were already reserved.
+static inline void put_mem(struct emit_buffer *b, const char *s, size_t n) {
+    memcpy(b->text + b->length, s, n);
+    b->length += n;
+}
+#define put_lit(b, s) put_mem((b), (s), sizeof(s) - 1)
+
+static inline void put_char(struct emit_buffer *b, char c) {
+    b->text[b->length++] = c;
+}
+
+// Appends a string of any length.
+static void put_str(struct emit_buffer *b, const char *s, size_t n) {
+    if (b->length + n + EMIT_LINE_RESERVE > EMIT_BUFFER_SIZE) {
+        flush(b);
+        if (n + EMIT_LINE_RESERVE > EMIT_BUFFER_SIZE) {
+            write_all(b->fd, s, n);
+            if (b->echo_fd >= 0) write_all(b->echo_fd, s, n);
+            return;
+        }
+    }
+    put_mem(b, s, n);
+}
+
+static inline void put_name(struct emit_buffer *b, uint32_t name) {
+    put_str(b, strpool_str(name), strpool_length(name));
+}
+
+// Appends an integer in decimal, like "%d".
+static void put_int(struct emit_buffer *b, int value) {
+    char digits[12];
+    char *p = digits + sizeof(digits);
+    unsigned int u = value < 0 ? 0u - (unsigned int)value : (unsigned int)value;
+    do {
+        *--p = (char)('0' + u % 10);
+        u /= 10;
+    } while (u);
+    if (value < 0) *--p = '-';
+    put_mem(b, p, digits + sizeof(digits) - p);
+}
+
+static inline void put_inst(struct emit_buffer *b, enum OPCODE opcode, enum SUFFIX suffix) {
+    reserve(b, EMIT_LINE_RESERVE);
+    put_mem(b, inst_prefixes[opcode][suffix], inst_prefix_lengths[opcode][suffix]);
+}
+
+static void amd64_top_level_print(struct Amd64TopLevel *pAmd64TopLevel, struct emit_buffer *b);
+static void amd64_function_print(struct Amd64Function *amd64Function, struct emit_buffer *b);
+static void amd64_static_var_print(struct Amd64StaticVar *amd64StaticVar, struct emit_buffer *b);
+struct Amd64Emitter {
+    struct emit_buffer buffer;
+};
+
+/**
+ * Begins writing assembly, for a whole program or a function at a time.
+ * @param out the file to receive the assembly.
+ * @param echo if not NULL, another file to receive the same assembly.
+ * @return the emitter; amd64_emitter_delete() writes whatever is still buffered.
+ */
+struct Amd64Emitter *amd64_emitter_new(FILE *out, FILE *echo) {
+    if (!tables_initialized) init_tables();
+    // Anything already printed to the files goes first.
+    fflush(out);
+    if (echo) fflush(echo);
+    struct Amd64Emitter *emitter = malloc(sizeof(struct Amd64Emitter));
+    emitter->buffer = (struct emit_buffer){.text = malloc(EMIT_BUFFER_SIZE), .fd = fileno(out), .echo_fd = echo ? fileno(echo) : -1};
+    return emitter;
+}
+
+void amd64_emitter_emit_function(struct Amd64Emitter *emitter, struct Amd64Function *function) {
+    amd64_function_print(function, &emitter->buffer);
+}
+
+void amd64_emitter_emit_program(struct Amd64Emitter *emitter, struct Amd64Program *amd64Program) {
     for (int ix=0; ix < amd64Program->top_level.num_items; ++ix) {
         struct Amd64TopLevel *pAmd64TopLevel = amd64Program->top_level.items[ix];
-        amd64_top_level_print(pAmd64TopLevel, out);
+        amd64_top_level_print(pAmd64TopLevel, &emitter->buffer);
     }
 }
 
-#define inst_fmt "       %-8s"
-static char * inst_op_fmt(enum OPCODE opcode, int nbytes) {
-    static char buf[OPCODE_BUF_SIZE];
-    strcpy(buf, opcode_names[opcode]);
-    if (nbytes == 4) {
-        strcat(buf, "l");
-    } else if (nbytes == 8) {
-        strcat(buf, "q");
-    }
-    return buf;
+void amd64_emitter_delete(struct Amd64Emitter *emitter) {
+    flush(&emitter->buffer);
+    free(emitter->buffer.text);
+    free(emitter);
 }
 
-int amd64_top_level_print(struct Amd64TopLevel *pAmd64TopLevel, FILE *out) {
+/**
+ * Writes the assembly for a program.
+ * @param amd64Program the program.
+ * @param out the file to receive the assembly.
+ * @param echo if not NULL, another file to receive the same assembly.
+ */
+void amd64_program_emit(struct Amd64Program *amd64Program, FILE *out, FILE *echo) {
+    struct Amd64Emitter *emitter = amd64_emitter_new(out, echo);
+    amd64_emitter_emit_program(emitter, amd64Program);
+    amd64_emitter_delete(emitter);
+}
+
+static void amd64_top_level_print(struct Amd64TopLevel *pAmd64TopLevel, struct emit_buffer *b) {
     switch(pAmd64TopLevel->kind) {
         case AMD64_FUNCTION:
-            return amd64_function_print(pAmd64TopLevel->function, out);
+            amd64_function_print(pAmd64TopLevel->function, b);
+            break;
         case AMD64_STATIC_VAR:
-            return amd64_static_var_print(pAmd64TopLevel->static_var, out);
+            amd64_static_var_print(pAmd64TopLevel->static_var, b);
+            break;
     }
 }
 
-int amd64_static_var_print(struct Amd64StaticVar *amd64StaticVar, FILE *out) {
+static void amd64_static_var_print(struct Amd64StaticVar *amd64StaticVar, struct emit_buffer *b) {
     int nBytes = 4;
-    if (amd64StaticVar->global) fprintf(out, "      .globl _%s\n", amd64StaticVar->name);
-    fprintf(out, "       %s\n", amd64StaticVar->init_val.int_value ? ".data" : ".bss");
-    fprintf(out, "       .balign %d\n", nBytes);
-    fprintf(out, "_%s:\n", amd64StaticVar->name);
+    reserve(b, EMIT_LINE_RESERVE);
+    if (amd64StaticVar->global) {
+        put_lit(b, "      .globl _");
+        put_name(b, amd64StaticVar->name);
+        put_lit(b, "\n");
+    }
+    if (amd64StaticVar->init_val.int_value) put_lit(b, INST_INDENT ".data\n");
+    else put_lit(b, INST_INDENT ".bss\n");
+    put_lit(b, INST_INDENT ".balign ");
+    put_int(b, nBytes);
+    put_lit(b, "\n_");
+    put_name(b, amd64StaticVar->name);
+    put_lit(b, ":\n");
     if (amd64StaticVar->init_val.int_value) {
-        fprintf(out, "       .long %d\n", amd64StaticVar->init_val.int_value);
+        put_lit(b, INST_INDENT ".long ");
+        put_int(b, amd64StaticVar->init_val.int_value);
     } else {
-        fprintf(out, "       .zero %d\n", nBytes);
+        put_lit(b, INST_INDENT ".zero ");
+        put_int(b, nBytes);
     }
-    return 1;
+    put_char(b, '\n');
 }
 
-static int amd64_instruction_print(struct Amd64Instruction *instruction, FILE *out);
-static int amd64_function_print(struct Amd64Function *amd64Function, FILE *out) {
-    fprintf(out, "\n");
-    if (amd64Function->global) fprintf(out, "       .globl _%s\n", amd64Function->name);
-    fprintf(out, "       .text\n");
-    fprintf(out, "_%s:\n", amd64Function->name);
-    fprintf(out, inst_fmt "%%rbp\n", "pushq");
-    fprintf(out, inst_fmt "%%rsp, %%rbp\n", "movq");
+static void amd64_instruction_print(const struct Amd64Function *function, struct Amd64Instruction *instruction, struct emit_buffer *b);
+static void amd64_function_print(struct Amd64Function *amd64Function, struct emit_buffer *b) {
+    reserve(b, EMIT_LINE_RESERVE);
+    put_char(b, '\n');
+    if (amd64Function->global) {
+        put_lit(b, INST_INDENT ".globl _");
+        put_name(b, amd64Function->name);
+        put_char(b, '\n');
+    }
+    put_lit(b, INST_INDENT ".text\n_");
+    put_name(b, amd64Function->name);
+    put_lit(b, ":\n");
+    put_inst(b, OPCODE_PUSH, SUFFIX_Q);
+    put_lit(b, "%rbp\n");
+    put_inst(b, OPCODE_MOV, SUFFIX_Q);
+    put_lit(b, "%rsp, %rbp\n");
     for (int ix=0; ix < amd64Function->instructions.num_items; ++ix) {
         struct Amd64Instruction *inst = amd64Function->instructions.items[ix];
-        amd64_instruction_print(inst, out);
+        amd64_instruction_print(amd64Function, inst, b);
     }
-    return 1;
 }
 
-static char* operand_fmt(char* buf, enum OPCODE op, struct Amd64Operand operand, int operand_no, int operand_size);
-static int amd64_instruction_print(struct Amd64Instruction *instruction, FILE *out) {
-    const int OPERAND_BUF_SIZE = 128;
-    char buf1[OPERAND_BUF_SIZE];
-    char buf2[OPERAND_BUF_SIZE];
+static void put_operand(struct emit_buffer *b, const struct Amd64Function *function, enum OPCODE op, struct Amd64Operand operand, int operand_no, int operand_size);
+static void amd64_instruction_print(const struct Amd64Function *function, struct Amd64Instruction *instruction, struct emit_buffer *b) {
     enum OPCODE opcode = instruction->opcode;
     switch (instruction->instruction) {
         case INST_MOV:
-            fprintf(out, inst_fmt "%s, %s\n",
-                    inst_op_fmt(opcode, 4),
-                    operand_fmt(buf1, opcode, instruction->operand1, 0, 4),
-                    operand_fmt(buf2, opcode, instruction->operand2, 1, 4) );
-            break;
-        case INST_UNARY:
-            fprintf(out, inst_fmt "%s\n",
-                    inst_op_fmt(opcode, 4),
-                    operand_fmt(buf1, opcode, instruction->operand1, 0, 4) );
-            break;
         case INST_BINARY:
-            fprintf(out, inst_fmt "%s, %s\n",
-                    inst_op_fmt(opcode, 4),
-                    operand_fmt(buf1, opcode, instruction->operand1, 0, 4),
-                    operand_fmt(buf2, opcode, instruction->operand2, 1, 4) );
-            break;
         case INST_CMP:
-            fprintf(out, inst_fmt "%s, %s\n",
-                    inst_op_fmt(opcode, 4),
-                    operand_fmt(buf1, opcode, instruction->operand1, 0, 4),
-                    operand_fmt(buf2, opcode, instruction->operand2, 1, 4) );
+            put_inst(b, opcode, SUFFIX_L);
+            put_operand(b, function, opcode, instruction->operand1, 0, 4);
+            put_lit(b, ", ");
+            put_operand(b, function, opcode, instruction->operand2, 1, 4);
             break;
+        case INST_UNARY:
         case INST_IDIV:
-            fprintf(out, inst_fmt "%s\n",
-                    inst_op_fmt(opcode, 4),
-                    operand_fmt(buf1, opcode, instruction->operand1, 0, 4) );
+            put_inst(b, opcode, SUFFIX_L);
+            put_operand(b, function, opcode, instruction->operand1, 0, 4);
             break;
         case INST_CDQ:
-            fprintf(out, inst_fmt "\n", inst_op_fmt(instruction->opcode, 0));
+            put_inst(b, opcode, SUFFIX_NONE);
             break;
         case INST_JMP:
-            fprintf(out, inst_fmt "%s\n", inst_op_fmt(instruction->opcode, 0), instruction->operand1.name);
-            break;
         case INST_JMPCC:
-            fprintf(out, inst_fmt "%s\n", inst_op_fmt(instruction->opcode, 0), instruction->operand1.name);
+            put_inst(b, opcode, SUFFIX_NONE);
+            put_operand(b, function, opcode, instruction->operand1, 0, 0);
             break;
         case INST_SETCC:
-            fprintf(out, inst_fmt "%s\n",
-                    inst_op_fmt(opcode, 0),
-                    operand_fmt(buf1, opcode, instruction->operand1, 0, 4) );
+            put_inst(b, opcode, SUFFIX_NONE);
+            put_operand(b, function, opcode, instruction->operand1, 0, 4);
             break;
         case INST_LABEL:
-            fprintf(out, "%s:\n", instruction->operand1.name);
+            reserve(b, EMIT_LINE_RESERVE);
+            put_operand(b, function, opcode, instruction->operand1, 0, 0);
+            put_char(b, ':');
             break;
         case INST_ALLOC_STACK:
-            fprintf(out, inst_fmt "$%d, %%rsp\n", "subq", instruction->bytes);
+            put_inst(b, OPCODE_SUB, SUFFIX_Q);
+            put_char(b, '$');
+            put_int(b, instruction->bytes);
+            put_lit(b, ", %rsp");
             break;
         case INST_RET:
-            fprintf(out, "       # epilog\n");
-            fprintf(out, inst_fmt "%%rbp, %%rsp\n", inst_op_fmt(OPCODE_MOV, 8));
-            fprintf(out, inst_fmt "%%rbp\n", inst_op_fmt(OPCODE_POP, 8));
-            fprintf(out, "       ret\n");
+            reserve(b, EMIT_LINE_RESERVE);
+            put_lit(b, INST_INDENT "# epilog\n");
+            put_mem(b, inst_prefixes[OPCODE_MOV][SUFFIX_Q], inst_prefix_lengths[OPCODE_MOV][SUFFIX_Q]);
+            put_lit(b, "%rbp, %rsp\n");
+            put_mem(b, inst_prefixes[OPCODE_POP][SUFFIX_Q], inst_prefix_lengths[OPCODE_POP][SUFFIX_Q]);
+            put_lit(b, "%rbp\n" INST_INDENT "ret");
             break;
         case INST_COMMENT:
-            fprintf(out, "     # %s\n", instruction->text);
+            reserve(b, EMIT_LINE_RESERVE);
+            put_lit(b, "     # ");
+            put_str(b, instruction->text, strlen(instruction->text));
             break;
         case INST_CALL:
-            fprintf(out, inst_fmt "_%s\n",
-                    inst_op_fmt(instruction->opcode, 0),
-                    instruction->operand1.name);
+            put_inst(b, opcode, SUFFIX_NONE);
+            put_char(b, '_');
+            put_name(b, instruction->operand1.name);
             break;
         case INST_DEALLOC_STACK:
-            fprintf(out, inst_fmt "$%d, %%rsp\n", "addq", instruction->bytes);
+            put_inst(b, OPCODE_ADD, SUFFIX_Q);
+            put_char(b, '$');
+            put_int(b, instruction->bytes);
+            put_lit(b, ", %rsp");
             break;
         case INST_PUSH:
-            fprintf(out, inst_fmt "%s\n",
-                    inst_op_fmt(instruction->opcode, 8),
-                    operand_fmt(buf1, opcode, instruction->operand1, 0, 8));
+            put_inst(b, opcode, SUFFIX_Q);
+            put_operand(b, function, opcode, instruction->operand1, 0, 8);
+            break;
+    }
+    put_char(b, '\n');
+}
+
+/**
+ * Appends the name of a label; the same name that ir_label_format gives it.
+ */
+static void put_label(struct emit_buffer *b, const struct Amd64Function *function, struct IrLabel label) {
+    if (label.kind == IR_LABEL_DECL) {
+        put_name(b, label.name);
+        return;
+    }
+    // The whole function name, as generated labels are only numbered within their function.
+    put_name(b, function->name);
+    switch (label.kind) {
+        case IR_LABEL_CASE:
+            put_lit(b, ".switch.");
+            put_int(b, label.id);
+            put_lit(b, ".case.");
+            put_int(b, label.case_value);
+            break;
+        case IR_LABEL_DEFAULT:
+            put_lit(b, ".switch.");
+            put_int(b, label.id);
+            put_lit(b, ".default");
+            break;
+        default:
+            put_char(b, '.');
+            put_mem(b, IR_LABEL_TAGS[label.kind], strlen(IR_LABEL_TAGS[label.kind]));
+            put_char(b, '.');
+            put_int(b, label.id);
             break;
     }
-    return 1;
 }
 
-static char* operand_fmt(char* buf, enum OPCODE op, struct Amd64Operand operand, int operand_no, int operand_size) {
+/**
+ * Appends an operand. There must be room for the operand, other than for any name in it.
+ */
+static void put_operand(struct emit_buffer *b, const struct Amd64Function *function, enum OPCODE op, struct Amd64Operand operand, int operand_no, int operand_size) {
     int size_ix;
     switch (operand.operand_kind) {
         case OPERAND_IMM_INT:
-            sprintf(buf, "$%d", operand.int_val);
+            put_char(b, '$');
+            put_int(b, operand.int_val);
             break;
         case OPERAND_REGISTER:
             switch (operand_size) {
@@ -170,25 +364,27 @@ static char* operand_fmt(char* buf, enum OPCODE op, struct Amd64Operand operand,
                 // SET CC needs an 8 bit register
                 size_ix = 3;
             }
-            sprintf(buf, "%s", register_names[operand.reg][size_ix]);
+            put_mem(b, register_names[operand.reg][size_ix], register_name_lengths[operand.reg][size_ix]);
             break;
         case OPERAND_PSEUDO:
-            sprintf(buf, "%%%s", operand.name);
+            put_lit(b, "%pseudo.");
+            put_int(b, operand.pseudo);
             break;
         case OPERAND_LABEL:
-            sprintf(buf, "%s", operand.name);
+            // A generated label is named only now.
+            put_label(b, function, function->labels.items[operand.label]);
             break;
         case OPERAND_STACK:
-            sprintf(buf, "%d(%%rbp)", operand.offset);
+            put_int(b, operand.offset);
+            put_lit(b, "(%rbp)");
             break;
         case OPERAND_NONE:
             break;
         case OPERAND_FUNC:
             break;
         case OPERAND_DATA:
-            sprintf(buf, "_%s(%%rip)", operand.name);
+            put_char(b, '_');
+            put_name(b, operand.name);
+            put_lit(b, "(%rip)");
     }
-
-    return buf;
 }
-
@@ -5,4 +5,6 @@
 #ifndef BCC_EMIT_AMD64_H
 #define BCC_EMIT_AMD64_H
 
+extern int amd64_emit_test(void);
+
 #endif //BCC_EMIT_AMD64_H
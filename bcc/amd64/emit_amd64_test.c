@@ -0,0 +1,177 @@
+//
+// Created by Bill Evans on 10/17/26.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "emit_amd64.h"
+#include "ir2amd64.h"
+
+// Function size, in IR instructions, for the timing.
+#define EMIT_TEST_SIZE 1000000
+
+/**
+ * Builds a program by hand with every kind of AMD64 instruction, and the text it must emit.
+ */
+static struct Amd64Program *make_exact_program(void) {
+    struct Amd64Program *program = amd64_program_new();
+    struct Constant zero = {.int_value = 0}, seven = {.int_value = 7};
+    amd64_program_add_static_var(program, amd64_static_var_new(strpool_intern("counter"), true, seven));
+    amd64_program_add_static_var(program, amd64_static_var_new(strpool_intern("flag"), false, zero));
+    struct Amd64Function *function = amd64_function_new(strpool_intern("exact"), true);
+    struct IrLabel end = {.kind = IR_LABEL_END, .id = 3};
+    struct IrLabel case_label = {.kind = IR_LABEL_CASE, .id = 2, .case_value = -12};
+    list_of_IrLabel_append(&function->labels, end);
+    list_of_IrLabel_append(&function->labels, case_label);
+    struct Amd64Operand data = {.operand_kind = OPERAND_DATA, .name = strpool_intern("counter")};
+#define APPEND(i) amd64_function_append_instruction(function, (i))
+    APPEND(amd64_instruction_new_alloc_stack(16));
+    APPEND(amd64_instruction_new_comment("a comment"));
+    APPEND(amd64_instruction_new_mov(amd64_operand_imm_int(-2147483647 - 1), amd64_operand_stack(-4)));
+    APPEND(amd64_instruction_new_mov(data, amd64_operand_reg(REG_R10)));
+    APPEND(amd64_instruction_new_binary(BINARY_OP_LSHIFT, amd64_operand_reg(REG_CX), amd64_operand_stack(-8)));
+    APPEND(amd64_instruction_new_unary(UNARY_OP_NEGATE, amd64_operand_pseudo(12)));
+    APPEND(amd64_instruction_new_cdq());
+    APPEND(amd64_instruction_new_idiv(amd64_operand_reg(REG_R11)));
+    APPEND(amd64_instruction_new_cmp(amd64_operand_imm_int(0), amd64_operand_reg(REG_AX)));
+    APPEND(amd64_instruction_new_setcc(CC_LE, amd64_operand_reg(REG_SI)));
+    APPEND(amd64_instruction_new_jmpcc(CC_NE, amd64_operand_label(1)));
+    APPEND(amd64_instruction_new_jmp(amd64_operand_label(0)));
+    APPEND(amd64_instruction_new_label(amd64_operand_label(1)));
+    APPEND(amd64_instruction_new_push(amd64_operand_reg(REG_DI)));
+    APPEND(amd64_instruction_new_call(amd64_operand_func(strpool_intern("callee"))));
+    APPEND(amd64_instruction_new_dealloc_stack(8));
+    APPEND(amd64_instruction_new_label(amd64_operand_label(0)));
+    APPEND(amd64_instruction_new_ret());
+#undef APPEND
+    amd64_program_add_function(program, function);
+    return program;
+}
+static const char exact_text[] =
+    "      .globl _counter\n"
+    "       .data\n"
+    "       .balign 4\n"
+    "_counter:\n"
+    "       .long 7\n"
+    "       .bss\n"
+    "       .balign 4\n"
+    "_flag:\n"
+    "       .zero 4\n"
+    "\n"
+    "       .globl _exact\n"
+    "       .text\n"
+    "_exact:\n"
+    "       pushq   %rbp\n"
+    "       movq    %rsp, %rbp\n"
+    "       subq    $16, %rsp\n"
+    "     # a comment\n"
+    "       movl    $-2147483648, -4(%rbp)\n"
+    "       movl    _counter(%rip), %r10d\n"
+    "       sall    %cl, -8(%rbp)\n"
+    "       negl    %pseudo.12\n"
+    "       cdq     \n"
+    "       idivl   %r11d\n"
+    "       cmpl    $0, %eax\n"
+    "       setle   %sil\n"
+    "       jne     exact.switch.2.case.-12\n"
+    "       jmp     exact.end.3\n"
+    "exact.switch.2.case.-12:\n"
+    "       pushq   %rdi\n"
+    "       call    _callee\n"
+    "       addq    $8, %rsp\n"
+    "exact.end.3:\n"
+    "       # epilog\n"
+    "       movq    %rbp, %rsp\n"
+    "       popq    %rbp\n"
+    "       ret\n";
+
+// The emitted text of a program; the caller frees it.
+static char *emitted_text(struct Amd64Program *program, size_t *size) {
+    char *name = strdup("/tmp/bcc_emit_test.XXXXXX");
+    FILE *out = fdopen(mkstemp(name), "w+");
+    amd64_program_emit(program, out, NULL);
+    *size = ftell(out);
+    char *text = malloc(*size + 1);
+    rewind(out);
+    *size = fread(text, 1, *size, out);
+    text[*size] = '\0';
+    fclose(out);
+    remove(name);
+    free(name);
+    return text;
+}
+
+/**
+ * Checks that generated labels carry the whole name of their function. They are numbered within the
+ * function, so two functions whose names differ only after many characters would otherwise share labels.
+ * @return the number of failures.
+ */
+static int long_name_check(void) {
+    int failures = 0;
+    char name[128], label_name[160], label_line[164];
+    struct Amd64Program *program = amd64_program_new();
+    struct IrLabel label = {.kind = IR_LABEL_FALSE, .id = 0};
+    for (int ix = 0; ix < 2; ix++) {
+        memset(name, 'f', 110);
+        sprintf(name + 110, "%d", ix);
+        struct Amd64Function *function = amd64_function_new(strpool_intern(name), true);
+        list_of_IrLabel_append(&function->labels, label);
+        amd64_function_append_instruction(function, amd64_instruction_new_label(amd64_operand_label(0)));
+        amd64_function_append_instruction(function, amd64_instruction_new_ret());
+        amd64_program_add_function(program, function);
+    }
+    size_t size;
+    char *text = emitted_text(program, &size);
+    for (int ix = 0; ix < 2; ix++) {
+        uint32_t function_name = program->top_level.items[ix]->function->name;
+        sprintf(label_line, "\n%s:\n", ir_label_format(label_name, sizeof(label_name), function_name, label));
+        if (strlen(label_name) != strpool_length(function_name) + strlen(".false.0") || !strstr(text, label_line)) {
+            printf("FAIL: label of function %d is not named with the whole function name\n", ix);
+            ++failures;
+        }
+    }
+    free(text);
+    amd64_program_delete(program);
+    return failures;
+}
+
+/**
+ * Checks the exact text emitted for every kind of instruction, and reports how fast a large
+ * program is emitted.
+ * @return the number of failures.
+ */
+int amd64_emit_test(void) {
+    int failures = 0;
+    printf("AMD64 emitter:\n");
+    struct Amd64Program *exact = make_exact_program();
+    size_t size;
+    char *text = emitted_text(exact, &size);
+    if (strcmp(text, exact_text) != 0) {
+        printf("FAIL: emitted assembly differs; got:\n%s", text);
+        ++failures;
+    }
+    free(text);
+    amd64_program_delete(exact);
+    failures += long_name_check();
+
+    struct IrProgram *ir_program = ir2amd64_test_program("emit_test", EMIT_TEST_SIZE);
+    struct Amd64Program *program = ir2amd64(ir_program);
+    text = emitted_text(program, &size);
+    free(text);
+    FILE *null = fopen("/dev/null", "w");
+    double best = 1e9;
+    for (int rep = 0; rep < 5; rep++) {
+        double start = now_seconds();
+        amd64_program_emit(program, null, NULL);
+        double t = now_seconds() - start;
+        if (t < best) best = t;
+    }
+    fclose(null);
+    printf("  %d AMD64 instructions, %.1f MB: %.1f ms, %.0f MB/s\n",
+           program->top_level.items[0]->function->instructions.num_items, size / 1e6, best * 1e3, size / 1e6 / best);
+    amd64_program_delete(program);
+    IrProgram_delete(ir_program);
+    return test_result("AMD64 emitter", failures);
+}
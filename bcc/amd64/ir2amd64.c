@@ -9,47 +9,20 @@
 #include <string.h>
 #include "amd64.h"
 #include "ir2amd64.h"
-#include "../parser/symtable.h"
-#include "inc/set_of.h"
 
-struct pseudo_register {
-    const char *name;
-    int offset;
-};
-SET_OF_ITEM_DECL(set_of_pseudo_register, struct pseudo_register)
-SET_OF_ITEM_DEFN(set_of_pseudo_register, struct pseudo_register)
-unsigned long pseudo_register_hash(struct pseudo_register pl) {
-    return hash_str(pl.name);
-}
-int pseudo_register_cmp(struct pseudo_register l, struct pseudo_register r) {
-    return strcmp(l.name, r.name);
-}
-struct pseudo_register pseudo_register_dup(struct pseudo_register pl) {
-    return pl;
-}
-void pseudo_register_delete(struct pseudo_register pl) {
-    ; // no-op
-}
-int pseudo_register_is_null(struct pseudo_register pl) {
-    return pl.name == NULL;
-}
-struct set_of_pseudo_register_helpers set_of_pseudo_register_helpers = {
-        .hash=pseudo_register_hash,
-        .cmp=pseudo_register_cmp,
-        .dup=pseudo_register_dup,
-        .delete=pseudo_register_delete,
-        .is_null=pseudo_register_is_null,
-        .null={0}
-};
+// Locations of pseudo registers, other than their (always negative) stack offsets.
+#define PSEUDO_UNALLOCATED 0
+#define PSEUDO_STATIC 1
 
 static enum REGISTER param_registers[] = {REG_DI, REG_SI, REG_DX, REG_CX, REG_R8, REG_R9};
 
 static struct Amd64Function *convert_function(struct IrFunction *irFunction);
-static int convert_instruction(struct Amd64Function *asmFunction, struct IrInstruction *irInstruction);
+static int convert_instruction(struct Amd64Function *asmFunction, const struct IrFunction *irFunction,
+                               const struct IrInstruction *irInstruction);
 static struct Amd64Operand make_operand(struct IrValue value);
 static void fixup_stack_accesses(struct Amd64Function* function);
-static int allocate_pseudo_registers(struct Amd64Function* function);
-static int fixup_pseudo_register(struct set_of_pseudo_register* locations, struct Amd64Operand* operand, int previously_allocated);
+static int allocate_pseudo_registers(struct Amd64Function* function, const struct IrFunction *irFunction);
+static int fixup_pseudo_register(const struct IrFunction *irFunction, int *locations, struct Amd64Operand* operand, int previously_allocated);
 
 struct Amd64Operand zero = {
         .operand_kind = OPERAND_IMM_INT,
@@ -80,6 +53,15 @@ struct Amd64Program *ir2amd64(struct IrProgram* irProgram) {
     return program;
 }
 
+/**
+ * Converts one function, for compiling a program a function at a time.
+ * @param irFunction to be converted; not changed.
+ * @return the AMD64 function.
+ */
+struct Amd64Function *ir2amd64_function(struct IrFunction *irFunction) {
+    return convert_function(irFunction);
+}
+
 /**
  * Copy params from ABI specified locations to more convenient (but less performant)
  * stack locations.
@@ -91,35 +73,38 @@ static void copy_function_params(struct Amd64Function *function, struct IrFuncti
     int num_parameters = irFunction->params.num_items;
     for (int ix=0; ix<6 && ix<num_parameters; ix++) {
         struct Amd64Operand src = amd64_operand_reg(param_registers[ix]);
-        struct Amd64Operand dst = amd64_operand_pseudo(irFunction->params.items[ix].text);
+        struct Amd64Operand dst = amd64_operand_pseudo(irFunction->params.items[ix].var);
         struct Amd64Instruction *inst = amd64_instruction_new_mov(src, dst);
         amd64_function_append_instruction(function, inst);
     }
     for (int ix=6; ix<num_parameters; ix++) {
         struct Amd64Operand src = amd64_operand_stack(16 + (ix-6)*8);
-        struct Amd64Operand dst = amd64_operand_pseudo(irFunction->params.items[ix].text);
+        struct Amd64Operand dst = amd64_operand_pseudo(irFunction->params.items[ix].var);
         struct Amd64Instruction *inst = amd64_instruction_new_mov(src, dst);
         amd64_function_append_instruction(function, inst);
     }
 }
 static struct Amd64Function *convert_function(struct IrFunction *irFunction) {
     struct Amd64Function *function = amd64_function_new(irFunction->name, irFunction->global);
+    // Most IR instructions become one or two AMD64 instructions.
+    list_of_Amd64Instruction_reserve(&function->instructions, irFunction->params.num_items + irFunction->body.num_items * 2 + 2);
+    // The labels are named from their descriptions only when emitted.
+    list_of_IrLabel_reserve(&function->labels, irFunction->labels.num_items);
+    for (int ix=0; ix<irFunction->labels.num_items; ix++) {
+        list_of_IrLabel_append(&function->labels, irFunction->labels.items[ix]);
+    }
     copy_function_params(function, irFunction);
     
     amd64_function_append_instruction(function, amd64_instruction_new_comment("end of function prolog"));
     for (int ix=0; ix<irFunction->body.num_items; ix++) {
-        struct IrInstruction *irInstruction = irFunction->body.items[ix];
-        convert_instruction(function, irInstruction);
+        convert_instruction(function, irFunction, &irFunction->body.items[ix]);
     }
     // Allocate space on the stack for the pseudo registers (locals and temporaries)
-    function->stack_allocations = allocate_pseudo_registers(function);
-    if (function->stack_allocations != 0) {
-        // Keep stack aligned on 16-byte boundaries.
-        if (function->stack_allocations % 16 != 0) function->stack_allocations += 16 - (function->stack_allocations % 16);
-        struct Amd64Instruction* stack = amd64_instruction_new_alloc_stack(function->stack_allocations);
-        list_of_Amd64Instruction_insert(&function->instructions, stack, 0);
-    }
+    function->stack_allocations = allocate_pseudo_registers(function, irFunction);
+    // Keep stack aligned on 16-byte boundaries.
+    if (function->stack_allocations % 16 != 0) function->stack_allocations += 16 - (function->stack_allocations % 16);
 
+    // Also emits the stack allocation, at the start of the function.
     fixup_stack_accesses(function);
     return function;
 }
@@ -149,16 +134,19 @@ static enum COND_CODE cc_for_binary_op(enum IR_BINARY_OP binary_op) {
     }
 } 
 
-static void convert_function_call(struct Amd64Function *asmFunction, struct IrInstruction *irInstruction) {
+static void convert_function_call(struct Amd64Function *asmFunction, const struct IrFunction *irFunction,
+                                  const struct IrInstruction *irInstruction) {
     // DI, SI, DX, CX, R8, R9, push[n], push[n-1], push[n-2], ...
     // Where does any result go?
     struct Amd64Operand result = make_operand(irInstruction->funcall.dst);
     // What function to call?
-    struct Amd64Operand target = amd64_operand_func(irInstruction->funcall.func_name.text);
+    struct Amd64Operand target = amd64_operand_func(irInstruction->funcall.func_name);
     struct Amd64Instruction* inst;
+    const struct IrValue *args = ir_function_call_args(irFunction, irInstruction);
+    int num_args = irInstruction->funcall.num_args;
     // How many register args, stack args? Pad stack to 16 bytes (per Sys V ABI)
-    int num_register_args = (irInstruction->funcall.args.num_items > 6) ? 6 : irInstruction->funcall.args.num_items;
-    int num_stack_args = (irInstruction->funcall.args.num_items <= 6) ? 0 : (irInstruction->funcall.args.num_items - 6);
+    int num_register_args = (num_args > 6) ? 6 : num_args;
+    int num_stack_args = (num_args <= 6) ? 0 : (num_args - 6);
     int stack_padding = (num_stack_args & 1) ? 8 : 0;
     if (stack_padding) {
         struct Amd64Instruction* stack = amd64_instruction_new_alloc_stack(stack_padding);
@@ -167,13 +155,13 @@ static void convert_function_call(struct Amd64Function *asmFunction, struct IrIn
     // register args
     for (int ix=0; ix<num_register_args; ix++) {
         struct Amd64Operand dst = amd64_operand_reg(param_registers[ix]);
-        struct Amd64Operand src = make_operand(irInstruction->funcall.args.items[ix]);
+        struct Amd64Operand src = make_operand(args[ix]);
         inst = amd64_instruction_new_mov(src, dst);
         amd64_function_append_instruction(asmFunction, inst);
     }
     // stack args
-    for (int ix=irInstruction->funcall.args.num_items-1; ix>=6; ix--) {
-        struct Amd64Operand src = make_operand(irInstruction->funcall.args.items[ix]);
+    for (int ix=num_args-1; ix>=6; ix--) {
+        struct Amd64Operand src = make_operand(args[ix]);
         if (src.operand_kind == OPERAND_REGISTER || src.operand_kind == OPERAND_IMM_INT) {
             inst = amd64_instruction_new_push(src);
         } else {
@@ -197,7 +185,8 @@ static void convert_function_call(struct Amd64Function *asmFunction, struct IrIn
     amd64_function_append_instruction(asmFunction, inst);
 }
 
-static int convert_instruction(struct Amd64Function *asmFunction, struct IrInstruction *irInstruction) {
+static int convert_instruction(struct Amd64Function *asmFunction, const struct IrFunction *irFunction,
+                               const struct IrInstruction *irInstruction) {
     struct Amd64Instruction *inst;
     struct Amd64Operand src;
     struct Amd64Operand src2;
@@ -347,7 +336,7 @@ static int convert_instruction(struct Amd64Function *asmFunction, struct IrInstr
             // no code for this.
             break;
         case IR_OP_FUNCALL:
-            convert_function_call(asmFunction, irInstruction);
+            convert_function_call(asmFunction, irFunction, irInstruction);
             break;
     }
     return 1;
@@ -359,11 +348,11 @@ static struct Amd64Operand make_operand(struct IrValue value) {
         case IR_VAL_CONST:
             operand = amd64_operand_imm_int(value.const_value.int_value);
             break;
-        case IR_VAL_ID:
-            operand = amd64_operand_pseudo(value.text);
+        case IR_VAL_VAR:
+            operand = amd64_operand_pseudo(value.var);
             break;
         case IR_VAL_LABEL:
-            operand = amd64_operand_label(value.text);
+            operand = amd64_operand_label(value.label);
             break;
     }
     return operand;
@@ -377,31 +366,46 @@ static int is_shift(struct Amd64Instruction* inst) {
             (inst->binary_op == BINARY_OP_LSHIFT || inst->binary_op == BINARY_OP_RSHIFT);
 }
 
+/**
+ * Legalizes the instructions of a function. Operands that an instruction can't take (two memory
+ * operands, a memory multiplicand, a variable shift count not in CX, ...) are routed through scratch
+ * registers, with the loads and stores of the scratch registers added around the instruction.
+ *
+ * The instructions are rewritten into a new list in a single pass, rather than inserting into
+ * the existing one, so the cost is linear in the size of the function. The stack allocation, if
+ * any, is the first instruction of the new list.
+ *
+ * @param function whose instructions are to be legalized.
+ */
 static void fixup_stack_accesses(struct Amd64Function* function) {
-    for (int i = 0; i < function->instructions.num_items; ++i) {
-        struct Amd64Instruction* inst = function->instructions.items[i];
-        
+    struct list_of_Amd64Instruction original = function->instructions;
+    struct list_of_Amd64Instruction *out = &function->instructions;
+    // Room for a fixup in about one instruction in four before the list needs to grow.
+    list_of_Amd64Instruction_init(out, original.num_items + original.num_items/4 + 2);
+    if (function->stack_allocations != 0) {
+        list_of_Amd64Instruction_append(out, amd64_instruction_new_alloc_stack(function->stack_allocations));
+    }
+
+    for (int i = 0; i < original.num_items; ++i) {
+        struct Amd64Instruction* inst = original.items[i];
+        // Any fixup to be added after the instruction.
+        struct Amd64Instruction* after = NULL;
+
         if (is_multiply(inst) && inst->operand2.operand_kind != OPERAND_REGISTER) {
             // The stack address that we must flow through a scratch register.
             struct Amd64Operand operand2 = inst->operand2;
             inst->operand2 = amd64_operand_reg(REG_R11);
             // Load the scratch register before the mult instruction
-            struct Amd64Instruction *fixup = amd64_instruction_new_mov(operand2, amd64_operand_reg(REG_R11));
-            list_of_Amd64Instruction_insert(&function->instructions, fixup, i);
+            list_of_Amd64Instruction_append(out, amd64_instruction_new_mov(operand2, amd64_operand_reg(REG_R11)));
             // Save the scratch register after the mult instruction
-            fixup = amd64_instruction_new_mov(amd64_operand_reg(REG_R11), operand2);
-            list_of_Amd64Instruction_insert(&function->instructions, fixup, i+2);
-            // Fix up loop index to skip the instruction we've already fixed. Two instructions inserted.
-            i+=2;
+            after = amd64_instruction_new_mov(amd64_operand_reg(REG_R11), operand2);
         }
         else if (inst->instruction == INST_IDIV) {
             if (inst->operand1.operand_kind != OPERAND_REGISTER) {
                 struct Amd64Operand operand = inst->operand1;
                 inst->operand1 = amd64_operand_reg(REG_R10);
                 // Load the scratch register before the instruction.
-                struct Amd64Instruction *fixup = amd64_instruction_new_mov(operand, amd64_operand_reg(REG_R10));
-                list_of_Amd64Instruction_insert(&function->instructions, fixup, i);
-                i+=1;
+                list_of_Amd64Instruction_append(out, amd64_instruction_new_mov(operand, amd64_operand_reg(REG_R10)));
             }
         }
         else if (is_shift(inst)) {
@@ -410,9 +414,7 @@ static void fixup_stack_accesses(struct Amd64Function* function) {
                 // if the operand1 operand1 isn't a constant, and isn't CX, use CX.
                 struct Amd64Operand operand1 = inst->operand1;
                 inst->operand1 = amd64_operand_reg(REG_CX);
-                struct Amd64Instruction *fixup = amd64_instruction_new_mov(operand1, amd64_operand_reg(REG_CX));
-                list_of_Amd64Instruction_insert(&function->instructions, fixup, i);
-                i+=1;
+                list_of_Amd64Instruction_append(out, amd64_instruction_new_mov(operand1, amd64_operand_reg(REG_CX)));
             }
         }
         else if ((inst->instruction == INST_BINARY || inst->instruction == INST_MOV) &&
@@ -424,32 +426,30 @@ static void fixup_stack_accesses(struct Amd64Function* function) {
             struct Amd64Operand operand1 = inst->operand1;
             inst->operand1 = amd64_operand_reg(REG_R10);
             // Load the scratch register before the instruction.
-            struct Amd64Instruction *fixup = amd64_instruction_new_mov(operand1, amd64_operand_reg(REG_R10));
-            list_of_Amd64Instruction_insert(&function->instructions, fixup, i);
-            // Fix up loop index to skip the instruction we've already fixed. One instruction inserted.
-            i += 1;
+            list_of_Amd64Instruction_append(out, amd64_instruction_new_mov(operand1, amd64_operand_reg(REG_R10)));
         } else if (inst->instruction == INST_CMP) {
             if (OPERAND_IS_MEMORY(inst->operand1.operand_kind) &&
                 OPERAND_IS_MEMORY(inst->operand2.operand_kind)) {
                 struct Amd64Operand operand1 = inst->operand1;
                 inst->operand1 = amd64_operand_reg(REG_R10);
                 // Load the scratch register before the instruction.
-                struct Amd64Instruction *fixup = amd64_instruction_new_mov(operand1, amd64_operand_reg(REG_R10));
-                list_of_Amd64Instruction_insert(&function->instructions, fixup, i);
-                // Fix up loop index to skip the instruction we've already fixed. One instruction inserted.
-                i += 1;
+                list_of_Amd64Instruction_append(out, amd64_instruction_new_mov(operand1, amd64_operand_reg(REG_R10)));
             } else if (inst->operand2.operand_kind == OPERAND_IMM_INT) {
                 // The second operand1 of a cmp instruction can't be a literal. Load literals into R11
                 struct Amd64Operand operand2 = inst->operand2;
                 inst->operand2 = amd64_operand_reg(REG_R11);
                 // Load the scratch register before the instruction.
-                struct Amd64Instruction *fixup = amd64_instruction_new_mov(operand2, amd64_operand_reg(REG_R11));
-                list_of_Amd64Instruction_insert(&function->instructions, fixup, i);
-                // Fix up loop index to skip the instruction we've already fixed. One instruction inserted.
-                i += 1;
+                list_of_Amd64Instruction_append(out, amd64_instruction_new_mov(operand2, amd64_operand_reg(REG_R11)));
             }
         }
+
+        list_of_Amd64Instruction_append(out, inst);
+        if (after) list_of_Amd64Instruction_append(out, after);
     }
+
+    // The instructions now belong to the new list; only the old array is to be freed.
+    original.num_items = 0;
+    list_of_Amd64Instruction_delete(&original);
 }
 
 /**
@@ -458,71 +458,67 @@ static void fixup_stack_accesses(struct Amd64Function* function) {
  *
  * These will be Amd64Operand structs with an operand_kind == OPERAND_PSEUDO.
  *
- * The pseudo registers for a function are tracked by uniquified name. The first time a name is seen,
- * space is reserved for it. The offset of that reservation is stored in the Amd64Operand record.
+ * The pseudo registers for a function are tracked by the index of their variable in the IrFunction. The first
+ * time a variable is seen, space is reserved for it, or, if it is a static variable, it is marked as such. The
+ * offset of that reservation is stored in the Amd64Operand record.
  *
  * Later, when we need to load from or store to the variable, the offset is used to address the correct stack location.
  *
  * @param function The function for which to allocate pseudo registers.
+ * @param irFunction The IR function from which it was converted, with its variables.
  * @return The number of stack bytes allocated.
  */
-static int allocate_pseudo_registers(struct Amd64Function* function) {
-    // Map of {uniquified-name: offset}
-    struct set_of_pseudo_register pseudo_registers;
-    set_of_pseudo_register_init(&pseudo_registers, 10);
+static int allocate_pseudo_registers(struct Amd64Function* function, const struct IrFunction *irFunction) {
+    // Location of every variable, by index: a stack offset, PSEUDO_STATIC, or PSEUDO_UNALLOCATED
+    int *locations = calloc(irFunction->vars.num_items, sizeof(int));
     int bytes_allocated = 0;
     for (int i=0; i<function->instructions.num_items; ++i) {
         struct Amd64Instruction* inst = function->instructions.items[i];
         if (inst->instruction != INST_ALLOC_STACK) {
             if (inst->operand1.operand_kind == OPERAND_PSEUDO) {
-                bytes_allocated += fixup_pseudo_register(&pseudo_registers, &inst->operand1, bytes_allocated);
+                bytes_allocated += fixup_pseudo_register(irFunction, locations, &inst->operand1, bytes_allocated);
             }
             if (opcode_num_operands[inst->opcode] > 1 && inst->operand2.operand_kind == OPERAND_PSEUDO) {
-                bytes_allocated += fixup_pseudo_register(&pseudo_registers, &inst->operand2, bytes_allocated);
+                bytes_allocated += fixup_pseudo_register(irFunction, locations, &inst->operand2, bytes_allocated);
             }
         }
     }
-    set_of_pseudo_register_delete(&pseudo_registers);
+    free(locations);
     return bytes_allocated;
 }
 
 /**
  * Fixes up pseudo-registers in an instruction factor.
- * @param locations - a set of previously assigned offsets for pseudo-registers.
+ * @param irFunction - the IR function, with the variables of the pseudo-registers.
+ * @param locations - previously assigned locations of the pseudo-registers, by variable.
  * @param operand - the factor to be fixed.
  * @param previously_allocated - number of bytes already allocated in the functions frame.
  * @return number of bytes allocated for this pseudo-registers. Zero if space has already
  *      been allocated for this pseudo register.
  */
-static int fixup_pseudo_register(struct set_of_pseudo_register* locations, struct Amd64Operand* operand, int previously_allocated) {
+static int fixup_pseudo_register(const struct IrFunction *irFunction, int *locations, struct Amd64Operand* operand, int previously_allocated) {
     int allocation = 0;
-    struct pseudo_register pseudo_register_lookup_key = {.name = operand->name};
-    struct pseudo_register pseudo_register_found;
-    bool was_found = set_of_pseudo_register_find(locations, pseudo_register_lookup_key, &pseudo_register_found);
-    bool is_static = false;
+    int var = operand->pseudo;
+    const struct IrVar *ir_var = &irFunction->vars.items[var];
 
     // If the space for this pseudo hasn't already been allocation, do so now.
-    if (!was_found) {
-        // Maybe this is a static variable. Look up in symbol table.
-        struct Symbol symbol;
-        if (find_symbol_by_name(operand->name, &symbol) == SYMTAB_OK) {
-            is_static = SYMBOL_IS_STATIC_VAR(symbol.attrs);
-        }
-        if (!is_static) {
+    if (locations[var] == PSEUDO_UNALLOCATED) {
+        // Static variables live in the data segment; everything else gets a stack slot.
+        if (ir_var->storage == IR_VAR_STATIC) {
+            locations[var] = PSEUDO_STATIC;
+        } else {
             allocation = 4; // when we have other sizes of stack variables, this will need to change.
-            pseudo_register_lookup_key.offset = -(previously_allocated + allocation);
-            pseudo_register_found = set_of_pseudo_register_insert(locations, pseudo_register_lookup_key);
+            locations[var] = -(previously_allocated + allocation);
         }
     }
-    if (is_static) {
+    if (locations[var] == PSEUDO_STATIC) {
         operand->operand_kind = OPERAND_DATA;
-        // name stays the same, of course.
+        operand->name = ir_var->name;
     } else {
         operand->operand_kind = OPERAND_STACK;
-        operand->offset = pseudo_register_found.offset;
+        operand->offset = locations[var];
     }
     return allocation;
 }
 
-
 #pragma clang diagnostic pop
\ No newline at end of file
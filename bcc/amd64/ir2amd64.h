@@ -9,5 +9,8 @@
 #include "amd64.h"
 
 extern struct Amd64Program *ir2amd64(struct IrProgram* irProgram);
+extern struct Amd64Function *ir2amd64_function(struct IrFunction* irFunction);
+extern struct IrProgram *ir2amd64_test_program(const char *name, int num_instructions);
+extern int ir2amd64_scaling_test(void);
 
 #endif //BCC_IR2AMD64_H
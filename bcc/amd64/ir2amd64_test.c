@@ -0,0 +1,105 @@
+//
+// Created by Bill Evans on 10/17/26.
+//
+
+#include <stdio.h>
+
+#include "ir2amd64.h"
+
+// Function sizes, in IR instructions, for the scaling test.
+static const int scaling_sizes[] = {1000, 10000, 100000, 1000000};
+#define NUM_SCALING_SIZES ((int)(sizeof(scaling_sizes)/sizeof(scaling_sizes[0])))
+// Distinct variables used by the generated code.
+#define NUM_TEST_VARS 16
+// Kinds of IR instruction in the test program; the ix'th instruction is of kind ix % NUM_TEST_KINDS.
+#define NUM_TEST_KINDS 8
+// AMD64 instructions made from each kind of IR instruction of the test program, after fixups.
+static const int asm_per_ir[NUM_TEST_KINDS] = {4, 5, 5, 4, 4, 1, 2, 2};
+// AMD64 instructions outside the body: the stack allocation, the end-of-prolog comment, and the return of 0.
+#define ASM_FIXED_INSTRUCTIONS 4
+
+/**
+ * Builds a program with one function of the given number of IR instructions, for the ir2amd64 and
+ * emitter tests. Nearly every instruction operates on variables (which live on the stack), and so needs
+ * a fixup: add and copy of memory to memory, imul and idiv of memory, shift by a variable count, and
+ * compare. There is also a multiply by a constant, and a label with a conditional jump to it.
+ * @param name of the function.
+ * @param num_instructions in the function's body.
+ * @return the program.
+ */
+struct IrProgram *ir2amd64_test_program(const char *name, int num_instructions) {
+    struct IrProgram *program = ir_program_new();
+    struct IrFunction *function = ir_function_new(strpool_intern(name), true);
+    int vars[NUM_TEST_VARS];
+    char buf[16];
+    for (int ix = 0; ix < NUM_TEST_VARS; ix++) {
+        sprintf(buf, "v.%d", ix);
+        vars[ix] = ir_function_new_var(function, strpool_intern(buf), IR_VAR_LOCAL);
+    }
+    struct IrLabel loop = {.kind = IR_LABEL_START, .id = 1};
+    struct IrValue label = ir_value_new_label(ir_function_new_label(function, loop));
+    for (int ix = 0; ix < num_instructions; ix++) {
+        struct IrValue a = ir_value_new_var(vars[ix % NUM_TEST_VARS]);
+        struct IrValue b = ir_value_new_var(vars[(ix + 5) % NUM_TEST_VARS]);
+        struct IrValue dst = ir_value_new_var(vars[(ix + 11) % NUM_TEST_VARS]);
+        struct IrInstruction inst;
+        switch (ix % NUM_TEST_KINDS) {
+            case 0:
+                inst = ir_instruction_new_binary(IR_BINARY_ADD, a, b, dst);
+                break;
+            case 1:
+                inst = ir_instruction_new_binary(IR_BINARY_MULTIPLY, a, ir_value_new_int(ix - 500000), dst);
+                break;
+            case 2:
+                inst = ir_instruction_new_binary(IR_BINARY_DIVIDE, a, b, dst);
+                break;
+            case 3:
+                inst = ir_instruction_new_binary(IR_BINARY_LSHIFT, a, b, dst);
+                break;
+            case 4:
+                inst = ir_instruction_new_binary(IR_BINARY_LT, a, b, dst);
+                break;
+            case 5:
+                inst = ir_instruction_new_label(label);
+                break;
+            case 6:
+                inst = ir_instruction_new_jumpz(a, label);
+                break;
+            default:
+                inst = ir_instruction_new_copy(a, dst);
+                break;
+        }
+        ir_function_append_instruction(function, inst);
+    }
+    ir_function_append_instruction(function, ir_instruction_new_ret(ir_value_new_int(0)));
+    ir_program_add_function(program, function);
+    return program;
+}
+
+/**
+ * Converts functions of 1K to 1M IR instructions to AMD64, reporting the time per instruction, which
+ * should stay about the same. Checks that each comes to exactly the expected number of AMD64 instructions.
+ * @return the number of failures.
+ */
+int ir2amd64_scaling_test(void) {
+    int failures = 0;
+    printf("ir2amd64 scaling:\n");
+    for (int ix = 0; ix < NUM_SCALING_SIZES; ix++) {
+        struct IrProgram *program = ir2amd64_test_program("scaling_test", scaling_sizes[ix]);
+        double start = now_seconds();
+        struct Amd64Program *asm_program = ir2amd64(program);
+        double elapsed = now_seconds() - start;
+        int num_asm = asm_program->top_level.items[0]->function->instructions.num_items;
+        printf("  %8d IR -> %8d AMD64 instructions: %9.3f ms, %6.1f ns/instruction\n",
+               scaling_sizes[ix], num_asm, elapsed * 1e3, elapsed * 1e9 / scaling_sizes[ix]);
+        int expected = ASM_FIXED_INSTRUCTIONS;
+        for (int ir = 0; ir < scaling_sizes[ix]; ir++) expected += asm_per_ir[ir % NUM_TEST_KINDS];
+        if (num_asm != expected) {
+            printf("FAIL: %d IR instructions became %d AMD64 instructions, not %d\n", scaling_sizes[ix], num_asm, expected);
+            ++failures;
+        }
+        amd64_program_delete(asm_program);
+        IrProgram_delete(program);
+    }
+    return test_result("ir2amd64 instruction counts", failures);
+}
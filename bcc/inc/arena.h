@@ -0,0 +1,32 @@
+//
+// Created by Bill Evans on 10/17/26.
+//
+
+#ifndef BCC_ARENA_H
+#define BCC_ARENA_H
+
+#include <stddef.h>
+
+/**
+ * A bump allocator. Memory is carved from large blocks, and is only ever released all at once, by
+ * arena_release(). Allocations never move.
+ */
+struct arena_block;
+struct arena {
+    struct arena_block *blocks;     // Most recent block first.
+    char *next;                     // Next free byte in the current block.
+    char *limit;                    // End of the current block.
+    size_t block_size;              // Size of new blocks; larger requests get a block of their own.
+    // Statistics, for tracing.
+    size_t num_allocs;
+    size_t num_bytes;
+    size_t num_blocks;
+};
+
+extern void arena_init(struct arena *arena, size_t block_size);
+extern void *arena_alloc(struct arena *arena, size_t size);
+extern void *arena_alloc_zero(struct arena *arena, size_t size);
+extern void arena_release(struct arena *arena);
+extern void arena_reset(struct arena *arena);
+
+#endif //BCC_ARENA_H
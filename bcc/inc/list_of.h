@@ -5,8 +5,27 @@
 #ifndef LIST_OF_DEF
 #define LIST_OF_DEF
 
+#include "inc/arena.h"
 
-#define LIST_OF_ITEM_DECL(NAME,TYPE)                                                                \
+/*
+ * Deletes an item of a list defined with LIST_OF_ITEM_DEFN, through its helpers, if it has a delete helper.
+ * This expands inside the list's functions, where 'list' is the list being operated on.
+ */
+#define LIST_OF_DYNAMIC_DELETE(item) do { if (list->helpers.delete) list->helpers.delete(item); } while (0)
+/* For lists whose items own nothing. */
+#define LIST_OF_NO_DELETE(item) ((void)0)
+/* The first capacity of a list that started out empty. */
+#define LIST_OF_MIN_GROWTH 4
+
+/*
+ * A list's items are kept in one of three places:
+ * - the list's own small buffer, when it was declared with LIST_OF_ITEM_DECL_SMALL and the items fit,
+ * - the list's arena, when it was initialized with NAME##_init_arena; the memory is only released
+ *   with the arena, or
+ * - the heap, grown with realloc.
+ * A list using its small buffer points into itself, so such a list must not be copied by value.
+ */
+#define LIST_OF_ITEM_DECL_STRUCT(NAME,TYPE,SMALL_BUFFER)                                            \
 struct NAME##_helpers {                                                                             \
     void (*delete)(TYPE item);                                                                      \
     TYPE null;                                                                                      \
@@ -16,32 +35,91 @@ struct NAME {
     TYPE* items;                                                                                    \
     int num_items;                                                                                  \
     int max_num_items;                                                                              \
+    struct arena *arena;                                                                            \
+    SMALL_BUFFER                                                                                    \
 };                                                                                                  \
 extern void NAME##_init(struct NAME *list, int init_size);                                          \
+extern void NAME##_init_arena(struct NAME *list, int init_size, struct arena *arena);               \
 extern void NAME##_append(struct NAME* list, TYPE new_item);                                        \
 extern void NAME##_insert(struct NAME* list, TYPE new_item, int atIx);                              \
+extern TYPE NAME##_pop(struct NAME* list);                                                          \
+extern void NAME##_reserve(struct NAME* list, int num_items);                                       \
+extern void NAME##_shrink_to_fit(struct NAME* list);                                                \
 extern void NAME##_clear(struct NAME* list);                                                        \
 extern void NAME##_delete(struct NAME* list);                                                       \
 extern int NAME##_is_empty(struct NAME* list);                                                      \
 
+/* A list with no small buffer; its items are always in the arena or on the heap. */
+#define LIST_OF_ITEM_DECL(NAME,TYPE)                                                                \
+LIST_OF_ITEM_DECL_STRUCT(NAME,TYPE,)                                                                \
+enum { NAME##_small_size = 0 };                                                                     \
+static inline TYPE *NAME##_small_items(struct NAME *list) { (void)list; return NULL; }              \
 
-#define LIST_OF_ITEM_DEFN(NAME,TYPE)                                                                \
-void NAME##_init(struct NAME *list, int init_size) {                                                \
-    list->helpers = NAME##_helpers;                                                                 \
+/* A list that holds up to SMALL items in the list itself, without allocating. */
+#define LIST_OF_ITEM_DECL_SMALL(NAME,TYPE,SMALL)                                                    \
+LIST_OF_ITEM_DECL_STRUCT(NAME,TYPE,TYPE small[SMALL];)                                              \
+enum { NAME##_small_size = SMALL };                                                                 \
+static inline TYPE *NAME##_small_items(struct NAME *list) { return list->small; }                   \
+
+
+#define LIST_OF_ITEM_IMPL(NAME,TYPE,DELETE)                                                         \
+static void NAME##_init_items(struct NAME *list, int init_size) {                                   \
     list->num_items = 0;                                                                            \
-    list->max_num_items = init_size;                                                                \
-    list->items = (TYPE *)malloc(list->max_num_items * sizeof(TYPE));                               \
-    memset(list->items, 0, list->max_num_items * sizeof(TYPE));                                     \
+    if (init_size <= NAME##_small_size) {                                                           \
+        list->items = NAME##_small_items(list);                                                     \
+        list->max_num_items = NAME##_small_size;                                                    \
+    } else {                                                                                        \
+        list->max_num_items = init_size;                                                            \
+        list->items = list->arena ? (TYPE *)arena_alloc_zero(list->arena, init_size * sizeof(TYPE)) \
+                                  : (TYPE *)calloc(init_size, sizeof(TYPE));                        \
+    }                                                                                               \
 }                                                                                                   \
-void NAME##_grow(struct NAME* list) {                                                               \
-    list->max_num_items *= 2;                                                                       \
-    /* One extra so that lists of pointers have a NULL entry at the end */                          \
-    TYPE* new_list = malloc((list->max_num_items+1) * sizeof(TYPE));                                \
-    for (int i=0; i<list->num_items; ++i) {                                                         \
-        new_list[i] = list->items[i];                                                               \
-    };                                                                                              \
-    free(list->items);                                                                              \
-    list->items = new_list;                                                                         \
+void NAME##_init(struct NAME *list, int init_size) {                                                \
+    list->arena = NULL;                                                                             \
+    NAME##_init_items(list, init_size);                                                             \
+    NAME##_init_helpers(list);                                                                      \
+}                                                                                                   \
+void NAME##_init_arena(struct NAME *list, int init_size, struct arena *arena) {                     \
+    list->arena = arena;                                                                            \
+    NAME##_init_items(list, init_size);                                                             \
+    NAME##_init_helpers(list);                                                                      \
+}                                                                                                   \
+/* Moves the items to storage for exactly max_num_items items, which must be at least num_items. */ \
+static void NAME##_set_capacity(struct NAME* list, int max_num_items) {                             \
+    TYPE *small = NAME##_small_items(list);                                                         \
+    TYPE *new_items;                                                                                \
+    if (max_num_items <= NAME##_small_size) {                                                       \
+        if (list->items != small) {                                                                 \
+            for (int i=0; i<list->num_items; ++i) small[i] = list->items[i];                        \
+            if (!list->arena) free(list->items);                                                    \
+        }                                                                                           \
+        new_items = small;                                                                          \
+        max_num_items = NAME##_small_size;                                                          \
+    } else if (list->arena) {                                                                       \
+        /* An arena's memory is only released with the arena. */                                    \
+        new_items = arena_alloc(list->arena, max_num_items * sizeof(TYPE));                         \
+        if (list->num_items) memcpy(new_items, list->items, list->num_items * sizeof(TYPE));        \
+    } else if (list->items == small) {                                                              \
+        /* Out of the small buffer (or no buffer at all, yet). */                                   \
+        new_items = malloc(max_num_items * sizeof(TYPE));                                           \
+        for (int i=0; i<list->num_items; ++i) new_items[i] = small[i];                              \
+    } else {                                                                                        \
+        new_items = realloc(list->items, max_num_items * sizeof(TYPE));                             \
+    }                                                                                               \
+    list->items = new_items;                                                                        \
+    list->max_num_items = max_num_items;                                                            \
+}                                                                                                   \
+static void NAME##_grow(struct NAME* list) {                                                        \
+    NAME##_set_capacity(list, list->max_num_items < LIST_OF_MIN_GROWTH/2 ? LIST_OF_MIN_GROWTH : list->max_num_items * 2);\
+}                                                                                                   \
+void NAME##_reserve(struct NAME* list, int num_items) {                                             \
+    if (num_items > list->max_num_items) NAME##_set_capacity(list, num_items);                      \
+}                                                                                                   \
+/* Releases unused capacity. An arena list can only give up its arena memory for its small buffer. */\
+void NAME##_shrink_to_fit(struct NAME* list) {                                                      \
+    if (list->num_items == list->max_num_items) return;                                             \
+    if (list->arena && list->num_items > NAME##_small_size) return;                                 \
+    NAME##_set_capacity(list, list->num_items);                                                     \
 }                                                                                                   \
 void NAME##_append(struct NAME* list, TYPE new_item) {                                              \
     if (list->num_items == list->max_num_items) {                                                   \
@@ -53,18 +131,21 @@ void NAME##_insert(struct NAME* list, TYPE new_item, int atIx) {
     if (list->num_items == list->max_num_items) {                                                   \
         NAME##_grow(list);                                                                          \
     }                                                                                               \
-    for (int i=list->num_items++; i>atIx; --i) {                                                    \
-        list->items[i] = list->items[i-1];                                                          \
-    }                                                                                               \
+    memmove(list->items + atIx + 1, list->items + atIx, (list->num_items++ - atIx) * sizeof(TYPE)); \
     list->items[atIx] = new_item;                                                                   \
 }                                                                                                   \
+/* Removes and returns the last item, which the caller now owns. An empty list returns the null item. */\
+TYPE NAME##_pop(struct NAME* list) {                                                                \
+    if (list->num_items == 0) return list->helpers.null;                                            \
+    return list->items[--(list->num_items)];                                                        \
+}                                                                                                   \
 void NAME##_delete(struct NAME* list) {                                                             \
     NAME##_clear(list);                                                                             \
-    free(list->items);                                                                              \
+    if (!list->arena && list->items != NAME##_small_items(list)) free(list->items);                 \
 }                                                                                                   \
 extern void NAME##_clear(struct NAME* list) {                                                       \
     for (int i=0; i<list->num_items; ++i) {                                                         \
-        list->helpers.delete(list->items[i]);                                                       \
+        DELETE(list->items[i]);                                                                     \
         list->items[i] = list->helpers.null;                                                        \
     }                                                                                               \
     list->num_items = 0;                                                                            \
@@ -73,6 +154,25 @@ int NAME##_is_empty(struct NAME* list) {
     return (list->num_items == 0);                                                                  \
 }                                                                                                   \
 
+
+/* A list whose items are deleted through NAME##_helpers, which the instantiating file defines. */
+#define LIST_OF_ITEM_DEFN(NAME,TYPE)                                                                \
+static void NAME##_init_helpers(struct NAME *list) {                                                \
+    list->helpers = NAME##_helpers;                                                                 \
+}                                                                                                   \
+LIST_OF_ITEM_IMPL(NAME,TYPE,LIST_OF_DYNAMIC_DELETE)                                                 \
+
+
+/*
+ * A list whose items are deleted by DELETE, the name of a function (or function-like macro) taking a TYPE,
+ * called directly. Such a list has no NAME##_helpers; its helpers are zero.
+ */
+#define LIST_OF_ITEM_DEFN_STATIC(NAME,TYPE,DELETE)                                                  \
+static void NAME##_init_helpers(struct NAME *list) {                                                \
+    memset(&list->helpers, 0, sizeof(list->helpers));                                               \
+}                                                                                                   \
+LIST_OF_ITEM_IMPL(NAME,TYPE,DELETE)                                                                 \
+
 #endif
 
 
@@ -1,6 +1,36 @@
 #ifndef SET_OF_DEF
 #define SET_OF_DEF
 
+/*
+ * A set of TYPE, kept in an open-addressed hash table with Robin Hood probing.
+ *
+ * - The capacity is a power of two, so the natural slot of an item is its hash masked by the capacity.
+ * - Each slot caches the hash of its item (with the high bit set; 0 means the slot is empty). Probes
+ *   compare the cached hashes, and only call cmp() when the hashes match. Growing the table rehashes
+ *   from the cached hashes, without calling hash().
+ * - On insert, an item that is farther from its natural slot than the occupant of a slot takes that
+ *   slot, and the occupant continues probing ("robs from the rich"). That keeps probe lengths short
+ *   and even, and lets a search stop as soon as it passes the distance at which its item would be.
+ * - Removal shifts the following items back by one slot, until an empty slot or an item in its natural
+ *   slot, so there are no tombstones.
+ *
+ * The null item (as recognized by is_null()) is kept outside of the table.
+ */
+#define SET_OF_HASH_USED 0x80000000u
+#define SET_OF_MIN_SIZE 8
+
+/*
+ * The operations of a set defined with SET_OF_ITEM_DEFN, called through its helpers. These expand inside
+ * the set's functions, where 'set' is the set being operated on.
+ */
+#define SET_OF_DYNAMIC_HASH(item) set->v_helpers.hash(item)
+#define SET_OF_DYNAMIC_CMP(left, right) set->v_helpers.cmp(left, right)
+#define SET_OF_DYNAMIC_DUP(item) set->v_helpers.dup(item)
+#define SET_OF_DYNAMIC_DELETE(item) set->v_helpers.delete(item)
+#define SET_OF_DYNAMIC_IS_NULL(item) set->v_helpers.is_null(item)
+/* For sets of values that need no copying or freeing. */
+#define SET_OF_NO_DUP(item) (item)
+#define SET_OF_NO_DELETE(item) ((void)0)
 
 #define SET_OF_ITEM_DECL(NAME,TYPE)                                                                 \
 struct NAME##_helpers {                                                                             \
@@ -14,9 +44,10 @@ struct NAME##_helpers {
 struct NAME {                                                                                       \
     struct NAME##_helpers v_helpers;                                                                \
     TYPE *items;                                                                                    \
+    unsigned int *hashes;       /* Cached hash of each slot's item, or 0 if the slot is empty. */   \
     unsigned int num_items;                                                                         \
-    unsigned int max_num_items;                                                                     \
-    unsigned int collisions;                                                                        \
+    unsigned int max_num_items; /* Capacity; always a power of two. */                              \
+    unsigned int collisions;    /* Sum over all items of the distance from the natural slot. */     \
     TYPE null_item;                                                                                 \
     int is_null_item_set;                                                                           \
 };                                                                                                  \
@@ -26,238 +57,204 @@ extern void NAME##_init(struct NAME *set, int init_size);
 extern TYPE NAME##_insert(struct NAME *set, TYPE newItem);                                          \
 extern void NAME##_remove(struct NAME *set, TYPE oldItem);                                          \
 extern int NAME##_find(struct NAME *set, TYPE item, TYPE* found_item);                              \
+extern TYPE* NAME##_lookup(struct NAME *set, TYPE item);                                            \
+extern int NAME##_max_probe_length(struct NAME *set);                                               \
 extern void NAME##_delete(struct NAME *set);                                                        \
 
 
 
-#define SET_OF_ITEM_DEFN(NAME,TYPE)                                                                 \
-void NAME##_init(struct NAME *set, int init_size) {                                                 \
-    set->v_helpers = NAME##_helpers;                                                                \
+#define SET_OF_ITEM_IMPL(NAME,TYPE,HASH,CMP,DUP,DELETE,IS_NULL)                                     \
+static void NAME##_init_table(struct NAME *set, int init_size) {                                    \
+    unsigned int size = SET_OF_MIN_SIZE;                                                            \
+    while (size < (unsigned int)init_size) size *= 2;                                               \
     set->collisions = set->num_items = 0;                                                           \
-    set->max_num_items = init_size;                                                                 \
-    set->items = (TYPE *)malloc(set->max_num_items * sizeof(TYPE));                                 \
+    set->max_num_items = size;                                                                      \
+    set->items = (TYPE *)malloc(size * sizeof(TYPE));                                               \
+    set->hashes = (unsigned int *)calloc(size, sizeof(unsigned int));                               \
     set->is_null_item_set = 0;                                                                      \
-    memset(set->items, 0, set->max_num_items * sizeof(TYPE));                                       \
-}                                                                                                   \
-static int NAME##_mod(struct NAME* set, int x) {                                                    \
-    return (((x)%set->max_num_items + set->max_num_items) % set->max_num_items);                    \
 }                                                                                                   \
 TYPE NAME##_no_dup(TYPE value) {                                                                    \
     return value;                                                                                   \
 }                                                                                                   \
+/* Mixes the helper's hash, so that the low bits (which pick the slot) depend on all of it. */      \
+static unsigned int NAME##_hash(struct NAME *set, TYPE item) {                                      \
+    unsigned long h = HASH(item);                                                                   \
+    h ^= h >> 33;                                                                                   \
+    h *= 0xff51afd7ed558ccdul;                                                                      \
+    h ^= h >> 33;                                                                                   \
+    h *= 0xc4ceb9fe1a85ec53ul;                                                                      \
+    h ^= h >> 33;                                                                                   \
+    return (unsigned int)h | SET_OF_HASH_USED;                                                      \
+}                                                                                                   \
+/* How far the item in slot ix is from its natural slot. */                                         \
+static unsigned int NAME##_distance(struct NAME *set, unsigned int ix) {                            \
+    return (ix - set->hashes[ix]) & (set->max_num_items - 1);                                       \
+}                                                                                                   \
+/* Places an item known not to be in the set. Returns the slot in which the item was placed. */     \
+static unsigned int NAME##_place(struct NAME *set, TYPE item, unsigned int hash) {                  \
+    unsigned int mask = set->max_num_items - 1;                                                     \
+    unsigned int ix = hash & mask;                                                                  \
+    unsigned int distance = 0;                                                                      \
+    unsigned int placed_ix = ~0u;                                                                   \
+    while (set->hashes[ix] != 0) {                                                                  \
+        unsigned int occupant_distance = NAME##_distance(set, ix);                                  \
+        if (occupant_distance < distance) {                                                         \
+            /* Take the slot; carry the occupant on to the next one. */                             \
+            TYPE occupant = set->items[ix];                                                         \
+            unsigned int occupant_hash = set->hashes[ix];                                           \
+            set->items[ix] = item;                                                                  \
+            set->hashes[ix] = hash;                                                                 \
+            set->collisions += distance - occupant_distance;                                        \
+            if (placed_ix == ~0u) placed_ix = ix;                                                   \
+            item = occupant;                                                                        \
+            hash = occupant_hash;                                                                   \
+            distance = occupant_distance;                                                           \
+        }                                                                                           \
+        ix = (ix + 1) & mask;                                                                       \
+        ++distance;                                                                                 \
+    }                                                                                               \
+    set->items[ix] = item;                                                                          \
+    set->hashes[ix] = hash;                                                                         \
+    set->collisions += distance;                                                                    \
+    return placed_ix == ~0u ? ix : placed_ix;                                                       \
+}                                                                                                   \
 void NAME##_grow(struct NAME *set) {                                                                \
-    /* New larger set to which to move the old set's contents.  */                                  \
-    struct NAME newSet;                                                                             \
-    NAME##_init(&newSet, set->max_num_items*2);                                                     \
-    /* Reuse existing values; don't copy as new ones. */                                            \
-    newSet.v_helpers.dup = NAME##_no_dup;                                                           \
-    /* For every active slot in the old set, insert it into the new set. */                         \
-    for (int ix=0; ix<set->max_num_items; ++ix) {                                                   \
-        TYPE val = set->items[ix];                                                                  \
-        if (!set->v_helpers.is_null(val)) NAME##_insert(&newSet, val);                              \
+    TYPE *old_items = set->items;                                                                   \
+    unsigned int *old_hashes = set->hashes;                                                         \
+    unsigned int old_size = set->max_num_items;                                                     \
+    set->max_num_items = old_size * 2;                                                              \
+    set->items = (TYPE *)malloc(set->max_num_items * sizeof(TYPE));                                 \
+    set->hashes = (unsigned int *)calloc(set->max_num_items, sizeof(unsigned int));                 \
+    set->collisions = 0;                                                                            \
+    /* Reuse existing values, and their cached hashes. */                                           \
+    for (unsigned int ix=0; ix<old_size; ++ix) {                                                    \
+        if (old_hashes[ix] != 0) NAME##_place(set, old_items[ix], old_hashes[ix]);                  \
     }                                                                                               \
-    /* Clean up old set's memory. */                                                                \
-    free(set->items);                                                                               \
-    /* And replace with the new set. */                                                             \
-    set->items = newSet.items;                                                                      \
-    set->collisions = newSet.collisions;                                                            \
-    set->max_num_items = newSet.max_num_items;                                                      \
+    free(old_items);                                                                                \
+    free(old_hashes);                                                                               \
 }                                                                                                   \
-TYPE NAME##_insert(struct NAME *set, TYPE newItem) {                                                \
-    if (set->collisions > set->max_num_items/3 || set->num_items > set->max_num_items*3/4) {        \
-        NAME##_grow(set);                                                                           \
+/* Finds the slot holding an item equal to the given one, or -1 if there is none. */                \
+static int NAME##_find_slot(struct NAME *set, TYPE item, unsigned int hash) {                       \
+    unsigned int mask = set->max_num_items - 1;                                                     \
+    unsigned int ix = hash & mask;                                                                  \
+    for (unsigned int distance = 0; set->hashes[ix] != 0; ++distance) {                             \
+        /* Past the point where the item would have been placed. */                                 \
+        if (NAME##_distance(set, ix) < distance) return -1;                                         \
+        if (set->hashes[ix] == hash && CMP(item, set->items[ix]) == 0) return (int)ix;              \
+        ix = (ix + 1) & mask;                                                                       \
     }                                                                                               \
-    if (set->v_helpers.is_null(newItem)) {                                                          \
-        if (set->is_null_item_set) set->v_helpers.delete(set->null_item);                           \
+    return -1;                                                                                      \
+}                                                                                                   \
+TYPE NAME##_insert(struct NAME *set, TYPE newItem) {                                                \
+    if (IS_NULL(newItem)) {                                                                         \
+        if (set->is_null_item_set) DELETE(set->null_item);                                          \
         set->is_null_item_set = 1;                                                                  \
         set->null_item = newItem;                                                                   \
         return newItem;                                                                             \
     }                                                                                               \
-    unsigned long h = set->v_helpers.hash(newItem);                                                 \
-    int ix = (int)(h % set->max_num_items);                                                         \
-    int isCollision = 0;                                                                            \
-    /* Search until we find a match or there's nothing else to inspect.  */                         \
-    while (!set->v_helpers.is_null(set->items[ix]) && set->v_helpers.cmp(newItem, set->items[ix])!=0) {\
-        if (++ix >= set->max_num_items) ix=0;                                                       \
-        isCollision = 1;                                                                            \
-    }                                                                                               \
-    /* ix either indexes an existing match or an empty slot. If not a match, add it. */             \
-    if (set->v_helpers.is_null(set->items[ix])) {                                                   \
-        set->items[ix] = set->v_helpers.dup(newItem);                                               \
-        set->num_items++;                                                                           \
-        set->collisions += isCollision;                                                             \
+    unsigned int h = NAME##_hash(set, newItem);                                                     \
+    int found = NAME##_find_slot(set, newItem, h);                                                  \
+    if (found >= 0) return set->items[found];                                                       \
+    /* Keep the load factor at or below 3/4. */                                                     \
+    if ((set->num_items + 1) * 4 > set->max_num_items * 3) {                                        \
+        NAME##_grow(set);                                                                           \
     }                                                                                               \
-    return set->items[ix];                                                                          \
+    set->num_items++;                                                                               \
+    return set->items[NAME##_place(set, DUP(newItem), h)];                                          \
 }                                                                                                   \
-                                                                                                    \
-/**                                                                                                 \
- * Notes on set_of_T_remove:                                                                        \
- *                                                                                                  \
- * These definitions will be used in this discussion:                                               \
- * "Natural slot" is the slot in which an item would appear if there were no collisions.            \
- * "Top items", the largest contiguous set of filled slots immediately following a                  \
- *    given item's natural slot, not including any that may have wrapped around to slot 0.          \
- *    Set ix_top to the first index _after_ the set of filled slots. This may be past the           \
- *    end of the array.                                                                             \
- * "Bottom items", the largest contiguous set of filled slots immediately preceding a               \
- *    given item's natural slot, not including any that may have wrapped around to slot 0.          \
- *    Set ix_bottom to the first element in the bottom items. This may be equal to the              \
- *    index being cleared, the current location of the item being deleted.                          \
- * - Either the following or the preceding items may wrap around the array of slots; not both.      \
- *    If the preceding items wraps around to the top of the array, that is an "underflow            \
- *    items". If the following items wraps around to the bottom of the array, that is an            \
- *    "overflow items".                                                                             \
- * - Because we grow the array when the load factor reaches ~0.75, empty slots are guaranteed.      \
- *    There may sometimes be an underflow items, or sometimes may be an overflow items, but         \
- *    it is not possible that there will be both.                                                   \
- *                                                                                                  \
- * The general process is as follows:                                                               \
- * 1) Find the item in the array. If not found, done. Otherwise, set ix_delete to the location      \
- *    of the item in the array.                                                                     \
- * 2) Set ix_top, ix_bottom, ix_overflow, and ix_underflow appropriately.                           \
- * 3) Delete the item, clear slot ix_delete.                                                        \
- * 4) Iterate the top items: for (int ix=ix_delete+1; ix<ix_top; ++ix)                              \
- * 5)   For each ix, get the "natural slot" for the item in that slot. Call that ix_item.           \
- * 6)   If (ix_item <= ix_delete || ix_item > ix_underflow), move the item at ix_item to ix_delete, \
- *      clear the slot at ix_item, and set ix_delete = ix_item.                                     \
- * 7)   Continue                                                                                    \
- * 8) Iterate the overflow items: for (int ix=0; ix<ix_overflow; ++ix)                              \
- * 9)   For each ix, get the "natural slot" for the item in that slot. Call that ix_item.           \
- * 10)  If (ix_delete < ix_overflow ? (ix_item <= ix_delete || ix_item > ix_overflow)               \
- *                                : (ix_item <= ix_delete && ix_item >= ix_bottom) ),               \
- *        move the item at ix_item to ix_delete, clear the slot at ix_item, and set ix_delete = ix_item.\
- * 11)  Continue                                                                                    \
- *                                                                                                  \
- * Given this population (with much omitted):                                                       \
- *     Slot: |  0|  1|  2|  3|  4|  5| ... | 44| 45| 46| 47| 48| 49| ... | 94| 95| 96| 97| 98| 99|  \
- *           +---+---+---+---+---+---+-...-+---+---+---+---+---+---+-...-+---+---+---+---+---+---+  \
- * Contents: |  0|197|  1|  3|100|   | ... |   | 45|146|145| 46|   | ... |   | 95|195| 97|295|199|  \
- *                                                                                                  \
- *                                                                                                  \
- * Consider deleting item 45, natural slot 45, in slot 45.                                          \
- * - ix_top = 49, ix_bottom = 45, ix_underflow = 100, ix_overflow = 0                               \
- * 1) Clear slot 45. set ix_delete=45                                                               \
- * 2) Examine slot 46, ix_item = 46, not <= ix_delete, don't move.                                  \
- * 3) Examine slot 47, ix_item = 45, <= ix_delete, move. Set ix_delete=47.                          \
- * 4) Examine slot 48, ix_item = 46, <= ix_delete, move. Set ix_delete=48.                          \
- * 5) Finished.                                                                                     \
- *                                                                                                  \
- * Now consider deleting item 0, natural slot 0, in slot 0.                                         \
- * - ix_top = 5, ix_bottom = 0, ix_underflow = 95, ix_overflow = 0                                  \
- * 1) Clear slot 0. Set ix_delete=0.                                                                \
- * 2) Examine slot 1, ix_item = 99, not <= ix_delete, but in underflow items, move.                 \
- *     Set ix_delete=1.                                                                             \
- * 3) Examine slot 2, ix_item = 1, <= ix_delete, move. Set ix_delete=2.                             \
- * 4) Examine slot 3, ix_item = 3, not <= ix_delete, don't move.                                    \
- * 5) Examine slot 4, ix_item = 0, <= ix_delete, move. Set ix_delete=4.                             \
- * 6) Finished.                                                                                     \
- *                                                                                                  \
- * Finally, consider deleting item 195 (natural slot 95, in slot 96).                               \
- * - ix_top = 100, ix_bottom = 95, ix_underflow = 100, ix_overflow = 5                              \
- * 1) Clear slot 96. Set ix_delete=96.                                                              \
- * 2) Examine slot 97, ix_item = 97, not <= ix_delete, don't move.                                  \
- * 3) Examine slot 98, ix_item = 95, <= ix_delete, move. Set ix_delete=98.                          \
- * 4) Examine slot 99, ix_item = 99, not <= ix_delete, don't move.                                  \
- * -- process overflow items --                                                                     \
- * 5) Examine slot 0, ix_item = 0, FALSE, don't move.                                               \
- * 6) Examine slot 1, ix_item = 97, TRUE, move, set ix_delete=1.                                    \
- * 7) Examine slot 2, ix_item = 1, TRUE, move, set ix_delete=2;                                     \
- * 8) Examine slot 3, ix_item = 3, FALSE, don't move.                                               \
- * 9) Examine slot 4, ix_item = 0, TRUE, move, set ix_delete=4.                                     \
- *                                                                                                  \
- */                                                                                                 \
 void NAME##_remove(struct NAME *set, TYPE oldItem) {                                                \
-    if (set->v_helpers.is_null(oldItem)) {                                                          \
+    if (IS_NULL(oldItem)) {                                                                         \
         if (set->is_null_item_set) {                                                                \
             set->is_null_item_set = 0;                                                              \
-            set->v_helpers.delete(set->null_item);                                                  \
+            DELETE(set->null_item);                                                                 \
             set->null_item = set->v_helpers.null;                                                   \
         }                                                                                           \
         return;                                                                                     \
     }                                                                                               \
-    /* Find the item to be deleted */                                                               \
-    unsigned long h = set->v_helpers.hash(oldItem);                                                 \
-    int ix_delete = (int) (h % set->max_num_items);                                                 \
-    int cmp = 1;                                                                                    \
-    while (!set->v_helpers.is_null(set->items[ix_delete]) &&                                        \
-            (cmp = set->v_helpers.cmp(oldItem, set->items[ix_delete]))) {                           \
-        if (++ix_delete >= set->max_num_items)                                                      \
-            ix_delete = 0;                                                                          \
-    }                                                                                               \
-    /* Was the oldItem in the set? */                                                               \
-    if (cmp != 0) return;  /* No, done. */                                                          \
-                                                                                                    \
-    /* Yes. Free the oldItem and fix up any affected collisions. */                                 \
-    /* First, find ix_underflow, ix_bottom, ix_top, ix_overflow */                                  \
-    int ix_underflow = ix_delete;                                                                   \
-    while (!set->v_helpers.is_null(set->items[NAME##_mod(set, ix_underflow - 1)])) --ix_underflow;  \
-    int ix_bottom = ix_underflow >= 0 ? ix_underflow : 0;                                           \
-    ix_underflow = ix_underflow < 0 ? NAME##_mod(set, ix_underflow) : set->max_num_items;           \
-                                                                                                    \
-    int ix_overflow = ix_delete;                                                                    \
-    while (!set->v_helpers.is_null(set->items[NAME##_mod(set, ix_overflow)])) ++ix_overflow;        \
-    int ix_top = ix_overflow <= set->max_num_items ? ix_overflow : set->max_num_items;              \
-    ix_overflow = ix_overflow <= set->max_num_items ? 0 : NAME##_mod(set, ix_overflow);             \
-                                                                                                    \
-    /* Free the oldItem */                                                                          \
-    set->v_helpers.delete(set->items[ix_delete]);                                                   \
-    set->items[ix_delete] = set->v_helpers.null;                                                    \
-                                                                                                    \
-    /* Handle the "top items" */                                                                    \
-    for (int ix = ix_delete + 1; ix < ix_top; ++ix) {                                               \
-        int ix_item = (int) (set->v_helpers.hash(set->items[ix]) % set->max_num_items);             \
-        int do_move = ix_item <= ix_delete || ix_item > ix_underflow;                               \
-        if (do_move) {                                                                              \
-            set->items[ix_delete] = set->items[ix];                                                 \
-            set->items[ix] = set->v_helpers.null;                                                   \
-            ix_delete = ix;                                                                         \
-        }                                                                                           \
-    }                                                                                               \
-    /* Handle any "overflow items" */                                                               \
-    for (int ix = 0; ix < ix_overflow; ++ix) {                                                      \
-        int ix_item = (int) (set->v_helpers.hash(set->items[ix]) % set->max_num_items);             \
-        int do_move = ix_delete < ix_overflow ? (ix_item <= ix_delete || ix_item > ix_overflow)     \
-                                              : (ix_item <= ix_delete && ix_item >= ix_bottom);     \
-        if (do_move) {                                                                              \
-            set->items[ix_delete] = set->items[ix];                                                 \
-            set->items[ix] = set->v_helpers.null;                                                   \
-            ix_delete = ix;                                                                         \
-        }                                                                                           \
+    int found = NAME##_find_slot(set, oldItem, NAME##_hash(set, oldItem));                          \
+    if (found < 0) return;                                                                          \
+    unsigned int mask = set->max_num_items - 1;                                                     \
+    unsigned int ix = (unsigned int)found;                                                          \
+    DELETE(set->items[ix]);                                                                         \
+    set->collisions -= NAME##_distance(set, ix);                                                    \
+    set->num_items--;                                                                               \
+    /* Shift following items back a slot, until an empty slot or one already in its natural slot. */\
+    unsigned int next = (ix + 1) & mask;                                                            \
+    while (set->hashes[next] != 0 && NAME##_distance(set, next) != 0) {                             \
+        set->items[ix] = set->items[next];                                                          \
+        set->hashes[ix] = set->hashes[next];                                                        \
+        set->collisions--;                                                                          \
+        ix = next;                                                                                  \
+        next = (next + 1) & mask;                                                                   \
     }                                                                                               \
+    set->hashes[ix] = 0;                                                                            \
 }                                                                                                   \
 int NAME##_find(struct NAME *set, TYPE item, TYPE* found_item) {                                    \
-    if (set->v_helpers.is_null(item)) {                                                             \
+    if (IS_NULL(item)) {                                                                            \
         if (!set->is_null_item_set) return 0;                                                       \
         if (found_item) {                                                                           \
             *found_item = set->null_item;                                                           \
         }                                                                                           \
         return 1;                                                                                   \
     }                                                                                               \
-                                                                                                    \
-    unsigned long h = set->v_helpers.hash(item);                                                    \
-    int ix = (int)(h % set->max_num_items);                                                         \
-    int cmp=1; /* init to 'not equal'  */                                                           \
-    /* Search until we find a match or there's nothing else to inspect.  */                         \
-    while (!set->v_helpers.is_null(set->items[ix]) && (cmp=set->v_helpers.cmp(item, set->items[ix]))) {\
-        if (++ix >= set->max_num_items) ix=0;                                                       \
+    int found = NAME##_find_slot(set, item, NAME##_hash(set, item));                                \
+    if (found < 0) return 0;                                                                        \
+    if (found_item) {                                                                               \
+        *found_item = set->items[found];                                                            \
     }                                                                                               \
-    /* return item if we found a match. */                                                          \
-    if (cmp==0) {                                                                                   \
-        if (found_item) {                                                                           \
-            *found_item = set->items[ix];                                                           \
-        }                                                                                           \
-        return 1;                                                                                   \
+    return 1;                                                                                       \
+}                                                                                                   \
+/*                                                                                                  \
+ * The set's own copy of an item equal to the given one, or NULL if there is none. Fields that take no\
+ * part in hash() and cmp() may be updated through it. The pointer is good until the set is next changed.\
+ */                                                                                                 \
+TYPE* NAME##_lookup(struct NAME *set, TYPE item) {                                                  \
+    if (IS_NULL(item)) return set->is_null_item_set ? &set->null_item : NULL;                       \
+    int found = NAME##_find_slot(set, item, NAME##_hash(set, item));                                \
+    return found < 0 ? NULL : &set->items[found];                                                   \
+}                                                                                                   \
+/* The longest probe needed to find any item in the set; 1 is an item in its natural slot. */       \
+int NAME##_max_probe_length(struct NAME *set) {                                                     \
+    unsigned int longest = 0;                                                                       \
+    for (unsigned int ix=0; ix<set->max_num_items; ++ix) {                                          \
+        if (set->hashes[ix] != 0 && NAME##_distance(set, ix) + 1 > longest) longest = NAME##_distance(set, ix) + 1;\
     }                                                                                               \
-    return 0;                                                                                       \
+    return (int)longest;                                                                            \
 }                                                                                                   \
 void NAME##_delete(struct NAME *set) {                                                              \
-    for (int i=0; i<set->max_num_items; ++i) {                                                      \
-        if (!set->v_helpers.is_null(set->items[i])) {                                               \
-            set->v_helpers.delete(set->items[i]);                                                   \
+    for (unsigned int i=0; i<set->max_num_items; ++i) {                                             \
+        if (set->hashes[i] != 0) {                                                                  \
+            DELETE(set->items[i]);                                                                  \
         }                                                                                           \
     }                                                                                               \
-    if (set->is_null_item_set) set->v_helpers.delete(set->null_item);                               \
+    if (set->is_null_item_set) DELETE(set->null_item);                                              \
     free(set->items);                                                                               \
+    free(set->hashes);                                                                              \
+}                                                                                                   \
+
+
+/*
+ * A set whose hash, cmp, dup, delete, and is_null are called through NAME##_helpers, which the
+ * instantiating file defines.
+ */
+#define SET_OF_ITEM_DEFN(NAME,TYPE)                                                                 \
+SET_OF_ITEM_IMPL(NAME,TYPE,SET_OF_DYNAMIC_HASH,SET_OF_DYNAMIC_CMP,SET_OF_DYNAMIC_DUP,SET_OF_DYNAMIC_DELETE,SET_OF_DYNAMIC_IS_NULL)\
+void NAME##_init(struct NAME *set, int init_size) {                                                 \
+    NAME##_init_table(set, init_size);                                                              \
+    set->v_helpers = NAME##_helpers;                                                                \
+}                                                                                                   \
+
+
+/*
+ * A set whose operations are bound when it is defined: HASH, CMP, DUP, DELETE, and IS_NULL are the names of
+ * functions (or function-like macros) taking a TYPE, called directly, so that the compiler can inline them into
+ * the probe loops. Such a set has no NAME##_helpers; its v_helpers are zero, null included.
+ */
+#define SET_OF_ITEM_DEFN_STATIC(NAME,TYPE,HASH,CMP,DUP,DELETE,IS_NULL)                              \
+SET_OF_ITEM_IMPL(NAME,TYPE,HASH,CMP,DUP,DELETE,IS_NULL)                                             \
+void NAME##_init(struct NAME *set, int init_size) {                                                 \
+    NAME##_init_table(set, init_size);                                                              \
+    memset(&set->v_helpers, 0, sizeof(set->v_helpers));                                             \
 }                                                                                                   \
 
 
@@ -0,0 +1,31 @@
+//
+// Created by Bill Evans on 10/17/26.
+//
+
+#ifndef BCC_STRPOOL_H
+#define BCC_STRPOOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * The global string pool. Every name in the compiler (identifiers, uniquified names, temporaries,
+ * labels) is interned here once, and referred to by a dense 32-bit id. Two names are equal exactly
+ * when their ids are equal, so tables keyed by name compare ids, never characters. The length and hash
+ * of each string are kept with it. Id 0 is reserved to mean "no string".
+ *
+ * Any thread may intern strings, and look them up, at any time. Ids are issued in order of first interning,
+ * so they are the same from run to run when one thread does the interning.
+ */
+
+extern void strpool_init(void);
+extern uint32_t strpool_intern(const char *str);
+extern uint32_t strpool_intern_n(const char *str, size_t length);
+extern const char *strpool_str(uint32_t id);
+extern uint32_t strpool_length(uint32_t id);
+extern uint32_t strpool_hash(uint32_t id);
+extern uint32_t strpool_count(void);
+
+extern int strpool_concurrency_test(void);
+
+#endif //BCC_STRPOOL_H
@@ -9,6 +9,7 @@
 #include "inc/set_of.h"
 #include "inc/list_of.h"
 
+extern unsigned long hash_bytes(const char *str, size_t length);
 extern unsigned long hash_str(const char *str);
 extern int long_is_zero(long l);
 
@@ -16,11 +17,16 @@ extern void fail(const char* msg);
 extern void failf(const char* fmt, ...);
 
 extern int next_uniquifier(void);
+extern void set_uniquifier_range(int first, int limit);
+
+extern double now_seconds(void);
+extern int test_result(const char *what, int failures);
+extern int containers_test(void);
 
 SET_OF_ITEM_DECL(set_of_str, const char*)
 
 SET_OF_ITEM_DECL(set_of_int, int)
 
-LIST_OF_ITEM_DECL(list_of_int,int)
+LIST_OF_ITEM_DECL_SMALL(list_of_int,int,8)
 
 #endif //BCC_UTILS_H
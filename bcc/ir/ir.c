@@ -2,6 +2,7 @@
 // Created by Bill Evans on 9/23/24.
 //
 
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include "ir.h"
@@ -16,25 +17,22 @@ const char * const IR_BINARY_NAMES[] = {
         IR_BINARY_OP_LIST__
 #undef X
 };
+const char * const IR_LABEL_TAGS[] = {
+#define X(a,b) b
+        IR_LABEL_KIND_LIST__
+#undef X
+};
 
 
-static void IrValue_delete(struct IrValue val) {}
-struct list_of_IrValue_helpers list_of_IrValue_helpers = {
-        .delete = IrValue_delete,
-        .null = {0},
-};
-LIST_OF_ITEM_DEFN(list_of_IrValue,struct IrValue)
+LIST_OF_ITEM_DEFN_STATIC(list_of_IrValue,struct IrValue,LIST_OF_NO_DELETE)
 
-struct list_of_IrInstruction_helpers list_of_IrInstruction_helpers = {
-        .delete = IrInstruction_delete
-};
-LIST_OF_ITEM_DEFN(list_of_IrInstruction,struct IrInstruction*)
+LIST_OF_ITEM_DEFN_STATIC(list_of_IrInstruction,struct IrInstruction,LIST_OF_NO_DELETE)
 
-struct list_of_top_level_helpers list_of_top_level_helpers = {
-        .delete = ir_top_level_delete,
-        .null = {},
-};
-LIST_OF_ITEM_DEFN(list_of_top_level,struct IrTopLevel*)
+LIST_OF_ITEM_DEFN_STATIC(list_of_IrVar,struct IrVar,LIST_OF_NO_DELETE)
+
+LIST_OF_ITEM_DEFN_STATIC(list_of_IrLabel,struct IrLabel,LIST_OF_NO_DELETE)
+
+LIST_OF_ITEM_DEFN_STATIC(list_of_top_level,struct IrTopLevel*,ir_top_level_delete)
 #include "inc/constant.h"
 
 
@@ -64,12 +62,15 @@ void IrProgram_delete(struct IrProgram *program) {
     free(program);
 }
 
-struct IrFunction *ir_function_new(const char *name, bool global) {
+struct IrFunction *ir_function_new(uint32_t name, bool global) {
     struct IrFunction *function = (struct IrFunction*)malloc(sizeof(struct IrFunction));
     function->name = name;
     function->global = global;
-    list_of_IrValue_init(&function->params, 10);
-    list_of_IrInstruction_init(&function->body, 10);
+    list_of_IrValue_init(&function->params, 0);
+    list_of_IrInstruction_init(&function->body, 0);
+    list_of_IrValue_init(&function->call_args, 0);
+    list_of_IrVar_init(&function->vars, 0);
+    list_of_IrLabel_init(&function->labels, 0);
     return function;
 }
 
@@ -78,18 +79,106 @@ struct IrFunction *ir_function_new(const char *name, bool global) {
  * @param function the IrFunction to be freed.
  */
 void IrFunction_delete(struct IrFunction *function) {
+    list_of_IrValue_delete(&function->params);
     list_of_IrInstruction_delete(&function->body);
+    list_of_IrValue_delete(&function->call_args);
+    list_of_IrVar_delete(&function->vars);
+    list_of_IrLabel_delete(&function->labels);
     free(function);
 }
-void IrFunction_add_param(struct IrFunction* function, const char* param_name) {
-    list_of_IrValue_append(&function->params, ir_value_new_id(param_name));
+void IrFunction_add_param(struct IrFunction* function, int var) {
+    list_of_IrValue_append(&function->params, ir_value_new_var(var));
+}
+/**
+ * Adds a variable to the function.
+ * @param function to which the variable belongs.
+ * @param name string pool id of a declared variable, or 0 for a temporary.
+ * @param storage where the variable lives.
+ * @return the variable's index, for ir_value_new_var().
+ */
+int ir_function_new_var(struct IrFunction *function, uint32_t name, enum IR_VAR_STORAGE storage) {
+    struct IrVar var = {.name = name, .storage = storage};
+    list_of_IrVar_append(&function->vars, var);
+    return function->vars.num_items - 1;
+}
+/**
+ * Adds a label to the function.
+ * @param function to which the label belongs.
+ * @param label describing the label, from which its name is made.
+ * @return the label's index, for ir_value_new_label().
+ */
+int ir_function_new_label(struct IrFunction *function, struct IrLabel label) {
+    list_of_IrLabel_append(&function->labels, label);
+    return function->labels.num_items - 1;
+}
+
+/**
+ * Formats the name of a label.
+ * @param buf to receive the name.
+ * @param size of buf; IR_NAME_BUF_SIZE(function_name) is enough.
+ * @param function_name string pool id of the function with the label. The whole name is used, as labels are
+ *          only numbered within their function.
+ * @param label to be named.
+ * @return buf, or the label's own name, for a DECL label.
+ */
+const char *ir_label_format(char *buf, size_t size, uint32_t function_name, struct IrLabel label) {
+    switch (label.kind) {
+        case IR_LABEL_DECL:
+            return strpool_str(label.name);
+        case IR_LABEL_CASE:
+            snprintf(buf, size, "%s.switch.%d.case.%d", strpool_str(function_name), label.id, label.case_value);
+            break;
+        case IR_LABEL_DEFAULT:
+            snprintf(buf, size, "%s.switch.%d.default", strpool_str(function_name), label.id);
+            break;
+        default:
+            snprintf(buf, size, "%s.%s.%d", strpool_str(function_name), IR_LABEL_TAGS[label.kind], label.id);
+            break;
+    }
+    return buf;
 }
-void ir_function_append_instruction(struct IrFunction *function, struct IrInstruction *instruction) {
+/**
+ * Formats the name of a variable.
+ * @param buf to receive the name.
+ * @param size of buf; IR_NAME_BUF_SIZE(function_name) is enough.
+ * @param function_name string pool id of the function with the variable.
+ * @param var index of the variable in the function.
+ * @param ir_var the variable.
+ * @return buf, or the variable's own name, for a declared variable.
+ */
+const char *ir_var_format(char *buf, size_t size, uint32_t function_name, int var, struct IrVar ir_var) {
+    if (ir_var.name) return strpool_str(ir_var.name);
+    snprintf(buf, size, "%s.tmp.%d", strpool_str(function_name), var);
+    return buf;
+}
+void ir_function_append_instruction(struct IrFunction *function, struct IrInstruction instruction) {
     list_of_IrInstruction_append(&function->body, instruction);
 }
+/**
+ * Adds the arguments of a function call to the function's argument array.
+ * @param function containing the call.
+ * @param args the argument values, in order.
+ * @return the index of the first argument, for ir_instruction_new_funcall().
+ */
+int ir_function_add_call_args(struct IrFunction *function, const struct list_of_IrValue *args) {
+    int first_arg = function->call_args.num_items;
+    for (int i = 0; i < args->num_items; i++) {
+        list_of_IrValue_append(&function->call_args, args->items[i]);
+    }
+    return first_arg;
+}
+/**
+ * The arguments of a function call.
+ * @param function containing the call.
+ * @param funcall an IR_OP_FUNCALL instruction of the function.
+ * @return pointer to funcall.num_args values. Valid until more arguments are added to the function.
+ */
+const struct IrValue *ir_function_call_args(const struct IrFunction *function, const struct IrInstruction *funcall) {
+    return function->call_args.items + funcall->funcall.first_arg;
+}
 
 //region IrStaticVar
-struct IrStaticVar *ir_static_var_new(const char *name, bool global, struct Constant init_value) {
+struct IrStaticVar *ir_static_var_new(uint32_t name, bool global, struct Constant init_value) {
     struct IrStaticVar *static_var = (struct IrStaticVar*)malloc(sizeof(struct IrStaticVar));
     static_var->name = name;
     static_var->global = global;
@@ -128,114 +217,93 @@ void ir_top_level_delete(struct IrTopLevel *top_level) {
 }
 //endregion
 
-static struct IrInstruction* ir_instruction_new(enum IR_OP inst) {
-    struct IrInstruction *instruction = (struct IrInstruction*)malloc(sizeof(struct IrInstruction));
-    instruction->inst = inst;
-    return instruction;
-}
 
-struct IrInstruction* ir_instruction_new_var(struct IrValue value) {
-    struct IrInstruction *instruction = ir_instruction_new(IR_OP_VAR);
-    instruction->var.value = value;
+struct IrInstruction ir_instruction_new_var(struct IrValue value) {
+    struct IrInstruction instruction = {.inst = IR_OP_VAR};
+    instruction.var.value = value;
     return instruction;
 }
 
-struct IrInstruction* ir_instruction_new_ret(struct IrValue value) {
-    struct IrInstruction *instruction = ir_instruction_new(IR_OP_RET);
-    instruction->ret.value = value;
+struct IrInstruction ir_instruction_new_ret(struct IrValue value) {
+    struct IrInstruction instruction = {.inst = IR_OP_RET};
+    instruction.ret.value = value;
     return instruction;
 }
 
-struct IrInstruction *ir_instruction_new_unary(enum IR_UNARY_OP op, struct IrValue src, struct IrValue dst) {
-    struct IrInstruction *instruction = ir_instruction_new(IR_OP_UNARY);
-    instruction->unary.op = op;
-    instruction->unary.src = src;
-    instruction->unary.dst = dst;
+struct IrInstruction ir_instruction_new_unary(enum IR_UNARY_OP op, struct IrValue src, struct IrValue dst) {
+    struct IrInstruction instruction = {.inst = IR_OP_UNARY};
+    instruction.unary.op = op;
+    instruction.unary.src = src;
+    instruction.unary.dst = dst;
     return instruction;
 }
 
-struct IrInstruction *ir_instruction_new_binary(enum IR_BINARY_OP op, struct IrValue src1, struct IrValue src2, struct IrValue dst) {
-    struct IrInstruction *instruction = ir_instruction_new(IR_OP_BINARY);
-    instruction->binary.op = op;
-    instruction->binary.src1 = src1;
-    instruction->binary.src2 = src2;
-    instruction->binary.dst = dst;
+struct IrInstruction ir_instruction_new_binary(enum IR_BINARY_OP op, struct IrValue src1, struct IrValue src2, struct IrValue dst) {
+    struct IrInstruction instruction = {.inst = IR_OP_BINARY};
+    instruction.binary.op = op;
+    instruction.binary.src1 = src1;
+    instruction.binary.src2 = src2;
+    instruction.binary.dst = dst;
     return instruction;
 }
-struct IrInstruction* ir_instruction_new_copy(struct IrValue src, struct IrValue dst) {
-    struct IrInstruction *instruction = ir_instruction_new(IR_OP_COPY);
-    instruction->copy.src = src;
-    instruction->copy.dst = dst;
+struct IrInstruction ir_instruction_new_copy(struct IrValue src, struct IrValue dst) {
+    struct IrInstruction instruction = {.inst = IR_OP_COPY};
+    instruction.copy.src = src;
+    instruction.copy.dst = dst;
     return instruction;
 }
-struct IrInstruction* ir_instruction_new_jump(struct IrValue target) {
-    struct IrInstruction *instruction = ir_instruction_new(IR_OP_JUMP);
-    instruction->jump.target = target;
+struct IrInstruction ir_instruction_new_jump(struct IrValue target) {
+    struct IrInstruction instruction = {.inst = IR_OP_JUMP};
+    instruction.jump.target = target;
     return instruction;
 }
-struct IrInstruction *ir_instruction_new_jumpeq(struct IrValue value, struct IrValue comparand, struct IrValue target) {
-struct IrInstruction *instruction = ir_instruction_new(IR_OP_JUMP_EQ);
-    instruction->cjump.value = value;
-    instruction->cjump.comparand = comparand;
-    instruction->cjump.target = target;
+struct IrInstruction ir_instruction_new_jumpeq(struct IrValue value, struct IrValue comparand, struct IrValue target) {
+    struct IrInstruction instruction = {.inst = IR_OP_JUMP_EQ};
+    instruction.cjump.value = value;
+    instruction.cjump.comparand = comparand;
+    instruction.cjump.target = target;
     return instruction;
 }
-struct IrInstruction* ir_instruction_new_jumpz(struct IrValue value, struct IrValue target) {
-    struct IrInstruction *instruction = ir_instruction_new(IR_OP_JUMP_ZERO);
-    instruction->cjump.value = value;
-    instruction->cjump.comparand = ir_value_new_int(0);
-    instruction->cjump.target = target;
+struct IrInstruction ir_instruction_new_jumpz(struct IrValue value, struct IrValue target) {
+    struct IrInstruction instruction = {.inst = IR_OP_JUMP_ZERO};
+    instruction.cjump.value = value;
+    instruction.cjump.comparand = ir_value_new_int(0);
+    instruction.cjump.target = target;
     return instruction;
 }
-struct IrInstruction* ir_instruction_new_jumpnz(struct IrValue value, struct IrValue target) {
-    struct IrInstruction *instruction = ir_instruction_new(IR_OP_JUMP_NZERO);
-    instruction->cjump.value = value;
-    instruction->cjump.comparand = ir_value_new_int(0);
-    instruction->cjump.target = target;
+struct IrInstruction ir_instruction_new_jumpnz(struct IrValue value, struct IrValue target) {
+    struct IrInstruction instruction = {.inst = IR_OP_JUMP_NZERO};
+    instruction.cjump.value = value;
+    instruction.cjump.comparand = ir_value_new_int(0);
+    instruction.cjump.target = target;
     return instruction;
 }
-struct IrInstruction* ir_instruction_new_label(struct IrValue label) {
-    struct IrInstruction *instruction = ir_instruction_new(IR_OP_LABEL);
-    instruction->label.label = label;
+struct IrInstruction ir_instruction_new_label(struct IrValue label) {
+    struct IrInstruction instruction = {.inst = IR_OP_LABEL};
+    instruction.label.label = label;
     return instruction;
 }
-struct IrInstruction* ir_instruction_new_funcall(struct IrValue func_name, struct list_of_IrValue* args, struct IrValue dst) {
-    struct IrInstruction *instruction = ir_instruction_new(IR_OP_FUNCALL);
-    instruction->funcall.func_name = func_name;
-    list_of_IrValue_init(&instruction->funcall.args, args->num_items);
-    for (int i = 0; i < args->num_items; i++) {
-        list_of_IrValue_append(&instruction->funcall.args, args->items[i]);
-    }
-    instruction->funcall.dst = dst;
+struct IrInstruction ir_instruction_new_funcall(uint32_t func_name, int first_arg, int num_args, struct IrValue dst) {
+    struct IrInstruction instruction = {.inst = IR_OP_FUNCALL};
+    instruction.funcall.func_name = func_name;
+    instruction.funcall.first_arg = first_arg;
+    instruction.funcall.num_args = num_args;
+    instruction.funcall.dst = dst;
     return instruction;
 }
 
-struct IrInstruction* ir_instruction_new_comment(const char *text) {
-    struct IrInstruction *instruction = ir_instruction_new(IR_OP_COMMENT);
-    instruction->comment.text = text;
+struct IrInstruction ir_instruction_new_comment(const char *text) {
+    struct IrInstruction instruction = {.inst = IR_OP_COMMENT};
+    instruction.comment.text = text;
     return instruction;
 }
-/**
- * Releases the memory associated with an IrInstruction.
- * @param instruction the IrInstruction to be freed.
- */
-void IrInstruction_delete(struct IrInstruction *instruction) {
-    switch (instruction->inst) {
-        case IR_OP_FUNCALL:
-            list_of_IrValue_delete(&instruction->funcall.args);
-            break;
-        default:
-            break;
-    }
-    free(instruction);
-}
 
-struct IrValue ir_value_new_id(const char* id) {
-    struct IrValue result = {.kind = IR_VAL_ID, .text = id};
+struct IrValue ir_value_new_var(int var) {
+    struct IrValue result = {.kind = IR_VAL_VAR, .var = var};
     return result;
 }
-struct IrValue ir_value_new_label(const char* label_name) {
-    struct IrValue result = {.kind = IR_VAL_LABEL, .text = label_name};
+struct IrValue ir_value_new_label(int label) {
+    struct IrValue result = {.kind = IR_VAL_LABEL, .label = label};
     return result;
 }
 struct IrValue ir_value_new_int(int int_val) {
@@ -9,6 +9,7 @@
 #include <stdbool.h>
 #include "inc/constant.h"
 #include "inc/utils.h"
+#include "inc/strpool.h"
 
 enum IR_OP {
     IR_OP_VAR,
@@ -69,7 +70,7 @@ extern const char * const IR_BINARY_NAMES[];
 //region struct IrValue
 enum IR_VAL {
     IR_VAL_CONST,
-    IR_VAL_ID,
+    IR_VAL_VAR,
     IR_VAL_LABEL,
 };
 
@@ -77,17 +78,77 @@ struct IrValue {
     enum IR_VAL kind;
     union {
         struct Constant const_value;
-        const char *text;
+        int var;            // index of an IR_VAL_VAR in its function's vars
+        int label;          // index of an IR_VAL_LABEL in its function's labels
     };
 };
-extern struct IrValue ir_value_new_id(const char* id);
-extern struct IrValue ir_value_new_label(const char* label_name);
+extern struct IrValue ir_value_new_var(int var);
+extern struct IrValue ir_value_new_label(int label);
 extern struct IrValue ir_value_new_int(int int_val);
 extern struct IrValue ir_value_new_const(struct Constant value);
 
-LIST_OF_ITEM_DECL(list_of_IrValue,struct IrValue)
+// Parameters and call arguments; up to the six that are passed in registers fit in the list itself.
+LIST_OF_ITEM_DECL_SMALL(list_of_IrValue,struct IrValue,6)
 //endregion VALUE
 
+//region struct IrVar
+/*
+ * A variable of a function: a declared variable (local, parameter, or a static or extern the function
+ * refers to), or a compiler-generated temporary. Temporaries have no name until one is needed for
+ * printing; see ir_var_format().
+ *
+ * Where the variable lives is decided when it is lowered, so the backend needn't consult the symbol table.
+ */
+enum IR_VAR_STORAGE {
+    IR_VAR_TEMPORARY,       // a compiler-generated temporary, on the stack
+    IR_VAR_LOCAL,           // a local variable or parameter, on the stack
+    IR_VAR_STATIC,          // a static or extern variable, in the data segment
+};
+struct IrVar {
+    uint32_t name;          // string pool id of a declared variable; 0 for a temporary
+    enum IR_VAR_STORAGE storage;
+};
+LIST_OF_ITEM_DECL(list_of_IrVar, struct IrVar)
+//endregion
+
+//region struct IrLabel
+/*
+ * The kinds of labels, with the tag used in their names. A DECL label is declared in the source, and is
+ * named by its uniquified name. The others are generated by the compiler, and named when printed or
+ * emitted, from the function name, the tag, and the uniquifier or flow id; see ir_label_format().
+ */
+#define IR_LABEL_KIND_LIST__ \
+    X(DECL,         ""),                \
+    X(TRUE,         "true"),            \
+    X(FALSE,        "false"),           \
+    X(END,          "end"),             \
+    X(START,        "start"),           \
+    X(BREAK,        "break"),           \
+    X(CONTINUE,     "continue"),        \
+    X(CASE,         "case"),            \
+    X(DEFAULT,      "default"),
+
+enum IR_LABEL_KIND {
+#define X(a,b) IR_LABEL_##a
+    IR_LABEL_KIND_LIST__
+#undef X
+};
+extern const char * const IR_LABEL_TAGS[];
+
+struct IrLabel {
+    enum IR_LABEL_KIND kind;
+    uint32_t name;          // string pool id of a DECL label
+    int id;                 // uniquifier or flow id of a generated label
+    int case_value;         // of a CASE label
+};
+LIST_OF_ITEM_DECL(list_of_IrLabel, struct IrLabel)
+
+// Large enough for the name of any label or variable of the function: its whole name, and a generated suffix.
+#define IR_NAME_BUF_SIZE(function_name) (strpool_length(function_name) + 60)
+extern const char *ir_label_format(char *buf, size_t size, uint32_t function_name, struct IrLabel label);
+extern const char *ir_var_format(char *buf, size_t size, uint32_t function_name, int var, struct IrVar ir_var);
+//endregion
+
 //region struct IrInstruction
 struct IrInstruction {
     enum IR_OP inst;
@@ -128,51 +189,58 @@ struct IrInstruction {
             const char *text;
         } comment;
         struct {
-            struct IrValue func_name;
-            struct list_of_IrValue args;
+            uint32_t func_name;     // string pool id
+            int first_arg;      // Index of the first argument in the function's call_args.
+            int num_args;
             struct IrValue dst;
         } funcall;
     };
 };
-extern struct IrInstruction* ir_instruction_new_var(struct IrValue value);
-extern struct IrInstruction* ir_instruction_new_ret(struct IrValue value);
-extern struct IrInstruction *ir_instruction_new_unary(enum IR_UNARY_OP op, struct IrValue src, struct IrValue dst);
-extern struct IrInstruction *ir_instruction_new_binary(enum IR_BINARY_OP op, struct IrValue src1, struct IrValue src2, struct IrValue dst);
-extern struct IrInstruction* ir_instruction_new_copy(struct IrValue src, struct IrValue dst);
-extern struct IrInstruction* ir_instruction_new_jump(struct IrValue target);
-extern struct IrInstruction *
-ir_instruction_new_jumpeq(struct IrValue value, struct IrValue comparand, struct IrValue target);
-extern struct IrInstruction* ir_instruction_new_jumpz(struct IrValue value, struct IrValue target);
-extern struct IrInstruction* ir_instruction_new_jumpnz(struct IrValue value, struct IrValue target);
-extern struct IrInstruction* ir_instruction_new_label(struct IrValue label);
-extern struct IrInstruction* ir_instruction_new_funcall(struct IrValue func_name, struct list_of_IrValue* args, struct IrValue dst);
-extern struct IrInstruction* ir_instruction_new_comment(const char* text);
-extern void IrInstruction_delete(struct IrInstruction *instruction);
-
-LIST_OF_ITEM_DECL(list_of_IrInstruction, struct IrInstruction*)
+// Instructions are small values, stored directly in their function's body.
+extern struct IrInstruction ir_instruction_new_var(struct IrValue value);
+extern struct IrInstruction ir_instruction_new_ret(struct IrValue value);
+extern struct IrInstruction ir_instruction_new_unary(enum IR_UNARY_OP op, struct IrValue src, struct IrValue dst);
+extern struct IrInstruction ir_instruction_new_binary(enum IR_BINARY_OP op, struct IrValue src1, struct IrValue src2, struct IrValue dst);
+extern struct IrInstruction ir_instruction_new_copy(struct IrValue src, struct IrValue dst);
+extern struct IrInstruction ir_instruction_new_jump(struct IrValue target);
+extern struct IrInstruction ir_instruction_new_jumpeq(struct IrValue value, struct IrValue comparand, struct IrValue target);
+extern struct IrInstruction ir_instruction_new_jumpz(struct IrValue value, struct IrValue target);
+extern struct IrInstruction ir_instruction_new_jumpnz(struct IrValue value, struct IrValue target);
+extern struct IrInstruction ir_instruction_new_label(struct IrValue label);
+extern struct IrInstruction ir_instruction_new_funcall(uint32_t func_name, int first_arg, int num_args, struct IrValue dst);
+extern struct IrInstruction ir_instruction_new_comment(const char* text);
+
+LIST_OF_ITEM_DECL(list_of_IrInstruction, struct IrInstruction)
 //endregion
 
 //region struct IrStaticVar
 struct IrStaticVar {
-    const char *name;
+    uint32_t name;
     bool global;
     struct Constant init_value;
 };
-extern struct IrStaticVar *ir_static_var_new(const char *name, bool global, struct Constant init_value);
+extern struct IrStaticVar *ir_static_var_new(uint32_t name, bool global, struct Constant init_value);
 extern void ir_static_var_delete(struct IrStaticVar *static_var);
 //endregion
 
 //region struct IrFunction
 struct IrFunction {
-    const char *name;
+    uint32_t name;
     bool global;
     struct list_of_IrValue params;
     struct list_of_IrInstruction body;
+    struct list_of_IrValue call_args;       // The arguments of every IR_OP_FUNCALL in the body.
+    struct list_of_IrVar vars;              // Indexed by the IrValue.var of the function's values.
+    struct list_of_IrLabel labels;          // Indexed by the IrValue.label of the function's labels.
 };
-extern struct IrFunction *ir_function_new(const char *name, bool global);
+extern struct IrFunction *ir_function_new(uint32_t name, bool global);
 extern void IrFunction_delete(struct IrFunction *function);
-extern void IrFunction_add_param(struct IrFunction* function, const char* param_name);
-extern void ir_function_append_instruction(struct IrFunction *function, struct IrInstruction *instruction);
+extern void IrFunction_add_param(struct IrFunction* function, int var);
+extern int ir_function_new_var(struct IrFunction *function, uint32_t name, enum IR_VAR_STORAGE storage);
+extern int ir_function_new_label(struct IrFunction *function, struct IrLabel label);
+extern void ir_function_append_instruction(struct IrFunction *function, struct IrInstruction instruction);
+extern int ir_function_add_call_args(struct IrFunction *function, const struct list_of_IrValue *args);
+extern const struct IrValue *ir_function_call_args(const struct IrFunction *function, const struct IrInstruction *funcall);
 //endregion
 
 //region struct IrTopLevel
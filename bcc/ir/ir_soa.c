@@ -0,0 +1,277 @@
+//
+// Created by Bill Evans on 10/17/26.
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include "ir_soa.h"
+
+LIST_OF_ITEM_DEFN_STATIC(list_of_IrSoaCall,struct IrSoaCall,LIST_OF_NO_DELETE)
+LIST_OF_ITEM_DEFN_STATIC(list_of_Constant,struct Constant,LIST_OF_NO_DELETE)
+LIST_OF_ITEM_DEFN_STATIC(list_of_IrSoaComment,const char*,LIST_OF_NO_DELETE)
+
+/*
+ * While a function is converted, the index in the constant pool of each distinct constant.
+ */
+struct constant_index_item {
+    struct Constant constant;
+    int index;
+    bool present;
+};
+static inline unsigned long constant_bits(struct Constant constant) {
+    switch (constant.kind) {
+        case CONST_INT:
+            return (unsigned long)constant.int_value;
+        case CONST_LONG:
+            return (unsigned long)constant.long_value;
+        case CONST_STRING:
+            return (unsigned long)constant.string_value;
+    }
+    return 0;
+}
+static inline unsigned long constant_index_item_hash(struct constant_index_item item) {
+    return constant_bits(item.constant) * 31u + item.constant.kind;
+}
+static inline int constant_index_item_cmp(struct constant_index_item l, struct constant_index_item r) {
+    if (l.constant.kind != r.constant.kind) return l.constant.kind < r.constant.kind ? -1 : 1;
+    unsigned long lbits = constant_bits(l.constant);
+    unsigned long rbits = constant_bits(r.constant);
+    return (lbits > rbits) - (lbits < rbits);
+}
+static inline int constant_index_item_is_null(struct constant_index_item item) {
+    return !item.present;
+}
+SET_OF_ITEM_DECL(set_of_constant_index, struct constant_index_item)
+SET_OF_ITEM_DEFN_STATIC(set_of_constant_index, struct constant_index_item, constant_index_item_hash,
+                        constant_index_item_cmp, SET_OF_NO_DUP, SET_OF_NO_DELETE, constant_index_item_is_null)
+
+static uint32_t pack_value(struct IrSoa *soa, struct set_of_constant_index *constant_index, struct IrValue value) {
+    switch (value.kind) {
+        case IR_VAL_VAR:
+            return IR_OPERAND(IR_OPERAND_VAR, value.var);
+        case IR_VAL_LABEL:
+            return IR_OPERAND(IR_OPERAND_LABEL, value.label);
+        case IR_VAL_CONST: {
+            struct constant_index_item key = {.constant = value.const_value, .present = true};
+            struct constant_index_item *found = set_of_constant_index_lookup(constant_index, key);
+            if (!found) {
+                key.index = soa->constants.num_items;
+                list_of_Constant_append(&soa->constants, value.const_value);
+                set_of_constant_index_insert(constant_index, key);
+                return IR_OPERAND(IR_OPERAND_CONST, key.index);
+            }
+            return IR_OPERAND(IR_OPERAND_CONST, found->index);
+        }
+    }
+    return IR_OPERAND(IR_OPERAND_NONE, 0);
+}
+
+/**
+ * Builds the structure-of-arrays view of a function's body. The view is a copy; later changes to either
+ * the function or the view aren't reflected in the other.
+ * @param soa to receive the view.
+ * @param function whose body is to be viewed.
+ */
+void ir_soa_from_function(struct IrSoa *soa, const struct IrFunction *function) {
+    int n = function->body.num_items;
+    soa->num_instructions = n;
+    soa->ops = malloc(n * sizeof(unsigned char));
+    soa->sub_ops = calloc(n, sizeof(unsigned char));
+    soa->dst = calloc(n, sizeof(uint32_t));
+    soa->src1 = calloc(n, sizeof(uint32_t));
+    soa->src2 = calloc(n, sizeof(uint32_t));
+    soa->aux = calloc(n, sizeof(int));
+    soa->num_args = function->call_args.num_items;
+    soa->args = malloc(soa->num_args * sizeof(uint32_t));
+    list_of_Constant_init(&soa->constants, 0);
+    list_of_IrSoaCall_init(&soa->calls, 0);
+    list_of_IrSoaComment_init(&soa->comments, 0);
+
+    struct set_of_constant_index constant_index;
+    set_of_constant_index_init(&constant_index, 16);
+    for (int ix = 0; ix < soa->num_args; ix++) {
+        soa->args[ix] = pack_value(soa, &constant_index, function->call_args.items[ix]);
+    }
+    for (int ix = 0; ix < n; ix++) {
+        const struct IrInstruction *inst = &function->body.items[ix];
+        soa->ops[ix] = inst->inst;
+        switch (inst->inst) {
+            case IR_OP_VAR:
+                soa->aux[ix] = inst->var.value.var;
+                break;
+            case IR_OP_RET:
+                soa->src1[ix] = pack_value(soa, &constant_index, inst->ret.value);
+                break;
+            case IR_OP_UNARY:
+                soa->sub_ops[ix] = inst->unary.op;
+                soa->src1[ix] = pack_value(soa, &constant_index, inst->unary.src);
+                soa->dst[ix] = pack_value(soa, &constant_index, inst->unary.dst);
+                break;
+            case IR_OP_BINARY:
+                soa->sub_ops[ix] = inst->binary.op;
+                soa->src1[ix] = pack_value(soa, &constant_index, inst->binary.src1);
+                soa->src2[ix] = pack_value(soa, &constant_index, inst->binary.src2);
+                soa->dst[ix] = pack_value(soa, &constant_index, inst->binary.dst);
+                break;
+            case IR_OP_COPY:
+                soa->src1[ix] = pack_value(soa, &constant_index, inst->copy.src);
+                soa->dst[ix] = pack_value(soa, &constant_index, inst->copy.dst);
+                break;
+            case IR_OP_JUMP:
+                soa->aux[ix] = inst->jump.target.label;
+                break;
+            case IR_OP_JUMP_ZERO:
+            case IR_OP_JUMP_NZERO:
+            case IR_OP_JUMP_EQ:
+                soa->src1[ix] = pack_value(soa, &constant_index, inst->cjump.value);
+                soa->src2[ix] = pack_value(soa, &constant_index, inst->cjump.comparand);
+                soa->aux[ix] = inst->cjump.target.label;
+                break;
+            case IR_OP_LABEL:
+                soa->aux[ix] = inst->label.label.label;
+                break;
+            case IR_OP_COMMENT:
+                soa->aux[ix] = soa->comments.num_items;
+                list_of_IrSoaComment_append(&soa->comments, inst->comment.text);
+                break;
+            case IR_OP_FUNCALL: {
+                struct IrSoaCall call = {
+                        .func_name = inst->funcall.func_name,
+                        .first_arg = inst->funcall.first_arg,
+                        .num_args = inst->funcall.num_args,
+                };
+                soa->aux[ix] = soa->calls.num_items;
+                list_of_IrSoaCall_append(&soa->calls, call);
+                soa->dst[ix] = pack_value(soa, &constant_index, inst->funcall.dst);
+                break;
+            }
+        }
+    }
+    set_of_constant_index_delete(&constant_index);
+}
+
+/**
+ * The IrValue of a packed operand.
+ * @param soa with the constant pool.
+ * @param operand to be unpacked; must not be IR_OPERAND_NONE.
+ * @return the value.
+ */
+struct IrValue ir_soa_value(const struct IrSoa *soa, uint32_t operand) {
+    int index = IR_OPERAND_INDEX(operand);
+    switch (IR_OPERAND_KIND_OF(operand)) {
+        case IR_OPERAND_VAR:
+            return ir_value_new_var(index);
+        case IR_OPERAND_LABEL:
+            return ir_value_new_label(index);
+        case IR_OPERAND_CONST:
+            return ir_value_new_const(soa->constants.items[index]);
+        case IR_OPERAND_NONE:
+            break;
+    }
+    return ir_value_new_int(0);
+}
+
+/**
+ * Replaces the body and call arguments of a function with those of a structure-of-arrays view.
+ * @param soa the view, possibly changed by some pass.
+ * @param function to receive the instructions. Its vars and labels must be those the view refers to.
+ */
+void ir_soa_to_function(const struct IrSoa *soa, struct IrFunction *function) {
+    list_of_IrInstruction_clear(&function->body);
+    list_of_IrInstruction_reserve(&function->body, soa->num_instructions);
+    list_of_IrValue_clear(&function->call_args);
+    list_of_IrValue_reserve(&function->call_args, soa->num_args);
+    for (int ix = 0; ix < soa->num_args; ix++) {
+        list_of_IrValue_append(&function->call_args, ir_soa_value(soa, soa->args[ix]));
+    }
+    for (int ix = 0; ix < soa->num_instructions; ix++) {
+        struct IrInstruction inst = {.inst = IR_OP_COMMENT};
+        struct IrValue label = ir_value_new_label(soa->aux[ix]);
+        switch ((enum IR_OP)soa->ops[ix]) {
+            case IR_OP_VAR:
+                inst = ir_instruction_new_var(ir_value_new_var(soa->aux[ix]));
+                break;
+            case IR_OP_RET:
+                inst = ir_instruction_new_ret(ir_soa_value(soa, soa->src1[ix]));
+                break;
+            case IR_OP_UNARY:
+                inst = ir_instruction_new_unary((enum IR_UNARY_OP)soa->sub_ops[ix], ir_soa_value(soa, soa->src1[ix]),
+                                                ir_soa_value(soa, soa->dst[ix]));
+                break;
+            case IR_OP_BINARY:
+                inst = ir_instruction_new_binary((enum IR_BINARY_OP)soa->sub_ops[ix], ir_soa_value(soa, soa->src1[ix]),
+                                                 ir_soa_value(soa, soa->src2[ix]), ir_soa_value(soa, soa->dst[ix]));
+                break;
+            case IR_OP_COPY:
+                inst = ir_instruction_new_copy(ir_soa_value(soa, soa->src1[ix]), ir_soa_value(soa, soa->dst[ix]));
+                break;
+            case IR_OP_JUMP:
+                inst = ir_instruction_new_jump(label);
+                break;
+            case IR_OP_JUMP_ZERO:
+                inst = ir_instruction_new_jumpz(ir_soa_value(soa, soa->src1[ix]), label);
+                break;
+            case IR_OP_JUMP_NZERO:
+                inst = ir_instruction_new_jumpnz(ir_soa_value(soa, soa->src1[ix]), label);
+                break;
+            case IR_OP_JUMP_EQ:
+                inst = ir_instruction_new_jumpeq(ir_soa_value(soa, soa->src1[ix]), ir_soa_value(soa, soa->src2[ix]),
+                                                 label);
+                break;
+            case IR_OP_LABEL:
+                inst = ir_instruction_new_label(label);
+                break;
+            case IR_OP_COMMENT:
+                inst = ir_instruction_new_comment(soa->comments.items[soa->aux[ix]]);
+                break;
+            case IR_OP_FUNCALL: {
+                const struct IrSoaCall *call = &soa->calls.items[soa->aux[ix]];
+                inst = ir_instruction_new_funcall(call->func_name, call->first_arg, call->num_args,
+                                                  ir_soa_value(soa, soa->dst[ix]));
+                break;
+            }
+        }
+        list_of_IrInstruction_append(&function->body, inst);
+    }
+}
+
+/**
+ * Releases the memory of a structure-of-arrays view.
+ * @param soa the view to be freed.
+ */
+void ir_soa_delete(struct IrSoa *soa) {
+    free(soa->ops);
+    free(soa->sub_ops);
+    free(soa->dst);
+    free(soa->src1);
+    free(soa->src2);
+    free(soa->aux);
+    free(soa->args);
+    list_of_Constant_delete(&soa->constants);
+    list_of_IrSoaCall_delete(&soa->calls);
+    list_of_IrSoaComment_delete(&soa->comments);
+}
+
+/**
+ * Counts the definitions and uses of each variable of a function. Only the operand columns are read.
+ * @param soa view of the function's body.
+ * @param num_vars in the function.
+ * @param defs receives the number of definitions of each variable, by index.
+ * @param uses receives the number of uses of each variable, by index.
+ */
+void ir_soa_count_defs_and_uses(const struct IrSoa *soa, int num_vars, int *defs, int *uses) {
+    memset(defs, 0, num_vars * sizeof(int));
+    memset(uses, 0, num_vars * sizeof(int));
+    for (int ix = 0; ix < soa->num_instructions; ix++) {
+        if (IR_OPERAND_IS_VAR(soa->dst[ix])) ++defs[IR_OPERAND_INDEX(soa->dst[ix])];
+    }
+    for (int ix = 0; ix < soa->num_instructions; ix++) {
+        if (IR_OPERAND_IS_VAR(soa->src1[ix])) ++uses[IR_OPERAND_INDEX(soa->src1[ix])];
+    }
+    for (int ix = 0; ix < soa->num_instructions; ix++) {
+        if (IR_OPERAND_IS_VAR(soa->src2[ix])) ++uses[IR_OPERAND_INDEX(soa->src2[ix])];
+    }
+    for (int ix = 0; ix < soa->num_args; ix++) {
+        if (IR_OPERAND_IS_VAR(soa->args[ix])) ++uses[IR_OPERAND_INDEX(soa->args[ix])];
+    }
+}
@@ -0,0 +1,67 @@
+//
+// Created by Bill Evans on 10/17/26.
+//
+
+#ifndef BCC_IR_SOA_H
+#define BCC_IR_SOA_H
+
+#include "ir.h"
+
+/*
+ * A structure-of-arrays view of the body of an IrFunction, for analyses that look at only part of each
+ * instruction. Instruction ix is described by element ix of each of the columns:
+ *   ops:        the IR_OP
+ *   sub_ops:    the IR_UNARY_OP or IR_BINARY_OP, of a unary or binary instruction
+ *   dst:        the operand the instruction defines, if any
+ *   src1, src2: the operands the instruction uses, if any
+ *   aux:        the variable declared by a var instruction; the label of a label or jump instruction;
+ *               the index in calls of a function call; the index in comments of a comment
+ * The arguments of every call, in order, are in args.
+ *
+ * An operand is packed into 32 bits: its kind, and the index of its variable, label, or constant. Constants
+ * are kept in the constant pool, each distinct constant once.
+ */
+enum IR_OPERAND_KIND {
+    IR_OPERAND_NONE,
+    IR_OPERAND_VAR,
+    IR_OPERAND_LABEL,
+    IR_OPERAND_CONST,
+};
+#define IR_OPERAND(kind, index) (((uint32_t)(index) << 2) | (uint32_t)(kind))
+#define IR_OPERAND_KIND_OF(operand) ((enum IR_OPERAND_KIND)((operand) & 3u))
+#define IR_OPERAND_INDEX(operand) ((int)((operand) >> 2))
+#define IR_OPERAND_IS_VAR(operand) (IR_OPERAND_KIND_OF(operand) == IR_OPERAND_VAR)
+
+struct IrSoaCall {
+    uint32_t func_name;     // string pool id
+    int first_arg;          // index in args
+    int num_args;
+};
+LIST_OF_ITEM_DECL(list_of_IrSoaCall, struct IrSoaCall)
+LIST_OF_ITEM_DECL(list_of_Constant, struct Constant)
+LIST_OF_ITEM_DECL(list_of_IrSoaComment, const char*)
+
+struct IrSoa {
+    int num_instructions;
+    unsigned char *ops;
+    unsigned char *sub_ops;
+    uint32_t *dst;
+    uint32_t *src1;
+    uint32_t *src2;
+    int *aux;
+    int num_args;
+    uint32_t *args;
+    struct list_of_Constant constants;
+    struct list_of_IrSoaCall calls;
+    struct list_of_IrSoaComment comments;
+};
+
+extern void ir_soa_from_function(struct IrSoa *soa, const struct IrFunction *function);
+extern void ir_soa_to_function(const struct IrSoa *soa, struct IrFunction *function);
+extern void ir_soa_delete(struct IrSoa *soa);
+extern struct IrValue ir_soa_value(const struct IrSoa *soa, uint32_t operand);
+extern void ir_soa_count_defs_and_uses(const struct IrSoa *soa, int num_vars, int *defs, int *uses);
+
+extern int ir_soa_test(void);
+
+#endif //BCC_IR_SOA_H
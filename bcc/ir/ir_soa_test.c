@@ -0,0 +1,208 @@
+//
+// Created by Bill Evans on 10/17/26.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ir_soa.h"
+#include "print_ir.h"
+
+// Function size, in IR instructions, for the timing.
+#define SOA_TEST_SIZE 1000000
+// Distinct variables used by the generated code.
+#define NUM_TEST_VARS 64
+
+/**
+ * Builds a function with every kind of IR instruction: unary, binary, copy, calls with arguments, labels,
+ * and jumps, on variables and constants.
+ * @param num_instructions about the number of instructions in the function's body.
+ * @return the function.
+ */
+static struct IrFunction *make_test_function(int num_instructions) {
+    struct IrFunction *function = ir_function_new(strpool_intern("soa_test"), true);
+    char buf[16];
+    for (int ix = 0; ix < NUM_TEST_VARS; ix++) {
+        sprintf(buf, "v.%d", ix);
+        ir_function_new_var(function, strpool_intern(buf), IR_VAR_LOCAL);
+    }
+    struct IrLabel loop = {.kind = IR_LABEL_START, .id = 1};
+    struct IrValue label = ir_value_new_label(ir_function_new_label(function, loop));
+    struct list_of_IrValue args;
+    list_of_IrValue_init(&args, 0);
+    uint32_t callee = strpool_intern("callee");
+    for (int ix = 0; ix < num_instructions; ix++) {
+        struct IrValue a = ir_value_new_var(ix % NUM_TEST_VARS);
+        struct IrValue b = ir_value_new_var((ix + 5) % NUM_TEST_VARS);
+        struct IrValue dst = ir_value_new_var((ix + 11) % NUM_TEST_VARS);
+        struct IrValue k = ir_value_new_int(ix % 100);
+        struct IrInstruction inst;
+        switch (ix % 8) {
+            case 0:
+                inst = ir_instruction_new_binary(IR_BINARY_ADD, a, b, dst);
+                break;
+            case 1:
+                inst = ir_instruction_new_binary(IR_BINARY_MULTIPLY, a, k, dst);
+                break;
+            case 2:
+                inst = ir_instruction_new_unary(IR_UNARY_NEGATE, a, dst);
+                break;
+            case 3:
+                inst = ir_instruction_new_copy(k, dst);
+                break;
+            case 4:
+                inst = ir_instruction_new_label(label);
+                break;
+            case 5:
+                inst = ir_instruction_new_jumpeq(a, k, label);
+                break;
+            case 6:
+                list_of_IrValue_clear(&args);
+                list_of_IrValue_append(&args, a);
+                list_of_IrValue_append(&args, k);
+                inst = ir_instruction_new_funcall(callee, ir_function_add_call_args(function, &args), args.num_items, dst);
+                break;
+            default:
+                inst = ir_instruction_new_jumpz(b, label);
+                break;
+        }
+        ir_function_append_instruction(function, inst);
+    }
+    ir_function_append_instruction(function, ir_instruction_new_ret(ir_value_new_var(0)));
+    list_of_IrValue_delete(&args);
+    return function;
+}
+
+// The printed IR of a function, for comparison; the caller frees it.
+static char *function_text(struct IrFunction *function) {
+    char *text = NULL;
+    size_t size = 0;
+    FILE *out = open_memstream(&text, &size);
+    struct IrProgram *program = ir_program_new();
+    ir_program_add_function(program, function);
+    print_ir(program, out);
+    fclose(out);
+    // The function belongs to the caller; free only the program and its top level item.
+    free(program->top_level.items[0]);
+    program->top_level.num_items = 0;
+    IrProgram_delete(program);
+    return text;
+}
+
+// Counts defs and uses of variables by walking the instructions themselves.
+static void count_in_instructions(const struct IrFunction *function, int *defs, int *uses) {
+    memset(defs, 0, function->vars.num_items * sizeof(int));
+    memset(uses, 0, function->vars.num_items * sizeof(int));
+#define DEF(v) do { if ((v).kind == IR_VAL_VAR) ++defs[(v).var]; } while (0)
+#define USE(v) do { if ((v).kind == IR_VAL_VAR) ++uses[(v).var]; } while (0)
+    for (int ix = 0; ix < function->body.num_items; ix++) {
+        const struct IrInstruction *inst = &function->body.items[ix];
+        switch (inst->inst) {
+            case IR_OP_VAR:
+                // Declares the variable; it isn't a definition.
+                break;
+            case IR_OP_RET:
+                USE(inst->ret.value);
+                break;
+            case IR_OP_UNARY:
+                USE(inst->unary.src);
+                DEF(inst->unary.dst);
+                break;
+            case IR_OP_BINARY:
+                USE(inst->binary.src1);
+                USE(inst->binary.src2);
+                DEF(inst->binary.dst);
+                break;
+            case IR_OP_COPY:
+                USE(inst->copy.src);
+                DEF(inst->copy.dst);
+                break;
+            case IR_OP_JUMP_ZERO:
+            case IR_OP_JUMP_NZERO:
+            case IR_OP_JUMP_EQ:
+                USE(inst->cjump.value);
+                USE(inst->cjump.comparand);
+                break;
+            case IR_OP_FUNCALL: {
+                const struct IrValue *args = ir_function_call_args(function, inst);
+                for (int i = 0; i < inst->funcall.num_args; i++) USE(args[i]);
+                DEF(inst->funcall.dst);
+                break;
+            }
+            case IR_OP_JUMP:
+            case IR_OP_LABEL:
+            case IR_OP_COMMENT:
+                break;
+        }
+    }
+#undef DEF
+#undef USE
+}
+
+/**
+ * Checks that converting a function to its structure-of-arrays view and back gives the same function, and
+ * that counting defs and uses from the view agrees with counting them from the instructions. Reports the
+ * time of each way of counting.
+ * @return the number of failures.
+ */
+int ir_soa_test(void) {
+    int failures = 0;
+    printf("IR structure-of-arrays view:\n");
+    struct IrFunction *function = make_test_function(SOA_TEST_SIZE);
+    struct IrSoa soa;
+    double start = now_seconds();
+    ir_soa_from_function(&soa, function);
+    double to_soa = now_seconds() - start;
+
+    // Round trip.
+    struct IrFunction *copy = ir_function_new(function->name, function->global);
+    for (int ix = 0; ix < function->vars.num_items; ix++) ir_function_new_var(copy, function->vars.items[ix].name, function->vars.items[ix].storage);
+    for (int ix = 0; ix < function->labels.num_items; ix++) ir_function_new_label(copy, function->labels.items[ix]);
+    start = now_seconds();
+    ir_soa_to_function(&soa, copy);
+    double from_soa = now_seconds() - start;
+    char *original_text = function_text(function);
+    char *copy_text = function_text(copy);
+    if (strcmp(original_text, copy_text) != 0) {
+        printf("FAIL: IR differs after conversion to structure-of-arrays and back\n");
+        ++failures;
+    }
+    free(original_text);
+    free(copy_text);
+    printf("  %d instructions, %d constants in the pool; to view %.1f ms, back %.1f ms\n",
+           soa.num_instructions, soa.constants.num_items, to_soa * 1e3, from_soa * 1e3);
+
+    // Defs and uses, both ways.
+    int num_vars = function->vars.num_items;
+    int *defs = malloc(num_vars * sizeof(int)), *uses = malloc(num_vars * sizeof(int));
+    int *soa_defs = malloc(num_vars * sizeof(int)), *soa_uses = malloc(num_vars * sizeof(int));
+    double best_list = 1e9, best_soa = 1e9;
+    for (int rep = 0; rep < 5; rep++) {
+        start = now_seconds();
+        count_in_instructions(function, defs, uses);
+        double t = now_seconds() - start;
+        if (t < best_list) best_list = t;
+        start = now_seconds();
+        ir_soa_count_defs_and_uses(&soa, num_vars, soa_defs, soa_uses);
+        t = now_seconds() - start;
+        if (t < best_soa) best_soa = t;
+    }
+    if (memcmp(defs, soa_defs, num_vars * sizeof(int)) != 0 || memcmp(uses, soa_uses, num_vars * sizeof(int)) != 0) {
+        printf("FAIL: defs and uses counted from the structure-of-arrays view differ\n");
+        ++failures;
+    }
+    size_t soa_bytes = 2 * sizeof(unsigned char) + 3 * sizeof(uint32_t) + sizeof(int);
+    printf("  defs and uses: instructions (%zu bytes each) %.2f ns/instruction, view (%zu bytes each) %.2f ns/instruction\n",
+           sizeof(struct IrInstruction), best_list * 1e9 / soa.num_instructions,
+           soa_bytes, best_soa * 1e9 / soa.num_instructions);
+    free(defs);
+    free(uses);
+    free(soa_defs);
+    free(soa_uses);
+
+    ir_soa_delete(&soa);
+    IrFunction_delete(copy);
+    IrFunction_delete(function);
+    return test_result("IR structure-of-arrays view", failures);
+}
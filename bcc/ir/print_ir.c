@@ -9,8 +9,8 @@
 static void print_ir_top_level(const struct IrTopLevel *top_level, FILE *file);
 static void print_ir_function(const struct IrFunction *function, FILE *file);
 static void print_ir_static_var(const struct IrStaticVar *static_var, FILE *file);
-static void print_ir_instruction(const struct IrInstruction *instruction, FILE *file);
-static void print_ir_value(struct IrValue value, FILE *file);
+static void print_ir_instruction(const struct IrFunction *function, const struct IrInstruction *instruction, FILE *file);
+static void print_ir_value(const struct IrFunction *function, struct IrValue value, FILE *file);
 
 void print_ir(const struct IrProgram *program, FILE *file) {
     fprintf(file, "\n\nIR program\n");
@@ -31,7 +31,7 @@ void print_ir_top_level(const struct IrTopLevel *top_level, FILE *file) {
 }
 
 void print_ir_static_var(const struct IrStaticVar *static_var, FILE *file) {
-    fprintf(file, "Var %s", static_var->name);
+    fprintf(file, "Var %s", strpool_str(static_var->name));
     if (static_var->global) fprintf(file, " (global)");
 //    if (static_var->has_init_val)
         fprintf(file, " = %d", static_var->init_value.int_value);
@@ -39,101 +39,110 @@ void print_ir_static_var(const struct IrStaticVar *static_var, FILE *file) {
 }
 
 void print_ir_function(const struct IrFunction *function, FILE *file) {
-    fprintf(file, "Function %s", function->name);
+    fprintf(file, "Function %s", strpool_str(function->name));
     if (function->global) fprintf(file, " (global)");
     fputc('\n', file);
     for (int i=0; i<function->body.num_items; ++i) {
-        print_ir_instruction(function->body.items[i], file);
+        print_ir_instruction(function, &function->body.items[i], file);
     }
 }
 
-void print_ir_instruction(const struct IrInstruction *instruction, FILE *file) {
+void print_ir_instruction(const struct IrFunction *function, const struct IrInstruction *instruction, FILE *file) {
     switch (instruction->inst) {
         case IR_OP_RET:
             fputs("    RET     ", file);
-            print_ir_value(instruction->ret.value, file);
+            print_ir_value(function, instruction->ret.value, file);
             fputc('\n', file);
             break;
         case IR_OP_UNARY:
             fprintf(file, inst_fmt, IR_UNARY_NAMES[instruction->unary.op]);
-            print_ir_value(instruction->unary.src, file);
+            print_ir_value(function, instruction->unary.src, file);
             fputs(", ", file);
-            print_ir_value(instruction->unary.dst, file);
+            print_ir_value(function, instruction->unary.dst, file);
             fputc('\n', file);
             break;
         case IR_OP_BINARY:
             fprintf(file, inst_fmt, IR_BINARY_NAMES[instruction->binary.op]);
-            print_ir_value(instruction->binary.src1, file);
+            print_ir_value(function, instruction->binary.src1, file);
             fputs(", ", file);
-            print_ir_value(instruction->binary.src2, file);
+            print_ir_value(function, instruction->binary.src2, file);
             fputs(", ", file);
-            print_ir_value(instruction->binary.dst, file);
+            print_ir_value(function, instruction->binary.dst, file);
             fputc('\n', file);
             break;
         case IR_OP_COPY:
             fprintf(file, inst_fmt, "copy");
-            print_ir_value(instruction->copy.src, file);
+            print_ir_value(function, instruction->copy.src, file);
             fputs(", ", file);
-            print_ir_value(instruction->copy.dst, file);
+            print_ir_value(function, instruction->copy.dst, file);
             fputc('\n', file);
             break;
         case IR_OP_JUMP:
             fprintf(file, inst_fmt, "j");
-            print_ir_value(instruction->jump.target, file);
+            print_ir_value(function, instruction->jump.target, file);
             fputs("\n", file);
             break;
         case IR_OP_JUMP_EQ:
             fprintf(file, inst_fmt, "je");
-            print_ir_value(instruction->cjump.comparand, file);
+            print_ir_value(function, instruction->cjump.comparand, file);
             fputs(", ", file);
-            print_ir_value(instruction->cjump.value, file);
+            print_ir_value(function, instruction->cjump.value, file);
             fputs(", ", file);
-            print_ir_value(instruction->cjump.target, file);
+            print_ir_value(function, instruction->cjump.target, file);
             fputc('\n', file);
             break;
         case IR_OP_JUMP_ZERO:
             fprintf(file, inst_fmt, "jz");
-            print_ir_value(instruction->cjump.value, file);
+            print_ir_value(function, instruction->cjump.value, file);
             fputs(", ", file);
-            print_ir_value(instruction->cjump.target, file);
+            print_ir_value(function, instruction->cjump.target, file);
             fputc('\n', file);
             break;
         case IR_OP_JUMP_NZERO:
             fprintf(file, inst_fmt, "jnz");
-            print_ir_value(instruction->cjump.value, file);
+            print_ir_value(function, instruction->cjump.value, file);
             fputs(", ", file);
-            print_ir_value(instruction->cjump.target, file);
+            print_ir_value(function, instruction->cjump.target, file);
             fputc('\n', file);
             break;
         case IR_OP_LABEL:
-            print_ir_value(instruction->label.label, file);
+            print_ir_value(function, instruction->label.label, file);
             fputs(":\n", file);
             break;
         case IR_OP_VAR:
-            fprintf(file, "    VAR %s\n", instruction->var.value.text);
+            fputs("    VAR ", file);
+            print_ir_value(function, instruction->var.value, file);
+            fputc('\n', file);
             break;
-        case IR_OP_FUNCALL:
-            fprintf(file, "    CALL %s(", instruction->funcall.func_name.text);
-            for (int i=0; i<instruction->funcall.args.num_items; ++i) {
+        case IR_OP_FUNCALL: {
+            const struct IrValue *args = ir_function_call_args(function, instruction);
+            fprintf(file, "    CALL %s(", strpool_str(instruction->funcall.func_name));
+            for (int i=0; i<instruction->funcall.num_args; ++i) {
                 if (i>0) fputs(", ", file);
-                print_ir_value(instruction->funcall.args.items[i], file);
+                print_ir_value(function, args[i], file);
             }
-            fprintf(file, ") => %s\n", instruction->funcall.dst.text);
+            fputs(") => ", file);
+            print_ir_value(function, instruction->funcall.dst, file);
+            fputc('\n', file);
             break;
+        }
         case IR_OP_COMMENT:
             fprintf(file, "    # %s\n", instruction->comment.text);
             break;
     }
 }
 
-void print_ir_value(struct IrValue value, FILE *file) {
+void print_ir_value(const struct IrFunction *function, struct IrValue value, FILE *file) {
+    char buf[IR_NAME_BUF_SIZE(function->name)];
     switch (value.kind) {
         case IR_VAL_CONST:
             fprintf(file, "$%d", value.const_value.int_value);
             break;
-        case IR_VAL_ID:
+        case IR_VAL_VAR:
+            fputs(ir_var_format(buf, sizeof(buf), function->name, value.var, function->vars.items[value.var]), file);
+            break;
         case IR_VAL_LABEL:
-            fprintf(file, "%s", value.text);
+            fputs(ir_label_format(buf, sizeof(buf), function->name, function->labels.items[value.label]), file);
             break;
     }
 }
@@ -0,0 +1,93 @@
+# Generates a perfect hash table of the keywords in tokens.h, for the lexer.
+#
+# The keywords are the tokens from TK_KEYWORDS_BEGIN up to (not including) TK_KEYWORDS_END.
+# A keyword is hashed on its first character, last character, and length:
+#     ((first*A + last*B + length*C) >> S) & (KEYWORD_HASH_SIZE-1)
+# The smallest power-of-two table, and the first multipliers, with no collisions are chosen.
+#
+# usage: awk -f keywords.awk tokens.h > keywords.h
+
+BEGIN {
+    for (i = 1; i < 256; ++i) ord[sprintf("%c", i)] = i
+    n = 0
+}
+
+# X(TK_ELSE,          "else",             0),
+/^[ \t]*X\(TK_/ {
+    line = $0
+    sub(/^[ \t]*X\(/, "", line)
+    name = line; sub(/,.*/, "", name)
+    text = line; sub(/^[^"]*"/, "", text); sub(/".*/, "", text)
+    tokens[n] = name; texts[n] = text; index_of[name] = n
+    ++n
+    next
+}
+
+# TK_KEYWORDS_BEGIN=TK_ELSE,
+/TK_KEYWORDS_BEGIN *=/ {
+    v = $0; sub(/.*= */, "", v); sub(/[ ,].*/, "", v)
+    kw_begin = index_of[v]
+}
+
+# TK_KEYWORDS_END=TK_DEFAULT+1,
+/TK_KEYWORDS_END *=/ {
+    v = $0; sub(/.*= */, "", v); sub(/[ ,].*/, "", v)
+    plus = 0
+    if (v ~ /\+/) { plus = v; sub(/.*\+/, "", plus); sub(/\+.*/, "", v) }
+    kw_end = index_of[v] + plus
+}
+
+function try(size, a, b, c, s,    i, h, used) {
+    for (i = kw_begin; i < kw_end; ++i) {
+        h = int((first[i]*a + last[i]*b + len[i]*c) / 2^s) % size
+        if (h in used) return 0
+        used[h] = 1
+        slot[i] = h
+    }
+    return 1
+}
+
+END {
+    if (kw_end <= kw_begin) {
+        print "keywords.awk: no keywords found" > "/dev/stderr"
+        exit 1
+    }
+    for (i = kw_begin; i < kw_end; ++i) {
+        first[i] = ord[substr(texts[i], 1, 1)]
+        last[i] = ord[substr(texts[i], length(texts[i]), 1)]
+        len[i] = length(texts[i])
+    }
+    size = 1
+    while (size < kw_end - kw_begin) size *= 2
+    for (found = 0; !found; size *= 2) {
+        for (s = 0; s < 4 && !found; ++s)
+            for (a = 1; a < 32 && !found; ++a)
+                for (b = 1; b < 32 && !found; ++b)
+                    for (c = 0; c < 32 && !found; ++c)
+                        if (try(size, a, b, c, s)) found = 1
+    }
+    size /= 2; --a; --b; --c; --s
+
+    print "//"
+    print "// Generated from tokens.h by keywords.awk. Do not edit."
+    print "//"
+    print ""
+    print "#ifndef BCC_KEYWORDS_H"
+    print "#define BCC_KEYWORDS_H"
+    print ""
+    print "#include \"tokens.h\""
+    print ""
+    printf("#define KEYWORD_HASH_SIZE %d\n", size)
+    printf("#define KEYWORD_HASH(first, last, length) ((((unsigned)(first)*%d + (unsigned)(last)*%d + (unsigned)(length)*%d) >> %d) & (KEYWORD_HASH_SIZE-1))\n", a, b, c, s)
+    print ""
+    print "// The keyword, if any, at each hash value, and its length. Empty slots are TK_UNKNOWN."
+    print "static const struct keyword_slot {"
+    print "    enum TK tk;"
+    print "    int length;"
+    print "} keyword_table[KEYWORD_HASH_SIZE] = {"
+    for (i = kw_begin; i < kw_end; ++i)
+        printf("    [%d] = {%s, %d},\n", slot[i], tokens[i], len[i])
+    print "};"
+    print ""
+    print "#endif //BCC_KEYWORDS_H"
+}
@@ -0,0 +1,44 @@
+//
+// Generated from tokens.h by keywords.awk. Do not edit.
+//
+
+#ifndef BCC_KEYWORDS_H
+#define BCC_KEYWORDS_H
+
+#include "tokens.h"
+
+#define KEYWORD_HASH_SIZE 64
+#define KEYWORD_HASH(first, last, length) ((((unsigned)(first)*1 + (unsigned)(last)*1 + (unsigned)(length)*18) >> 0) & (KEYWORD_HASH_SIZE-1))
+
+// The keyword, if any, at each hash value, and its length. Empty slots are TK_UNKNOWN.
+static const struct keyword_slot {
+    enum TK tk;
+    int length;
+} keyword_table[KEYWORD_HASH_SIZE] = {
+    [18] = {TK_ELSE, 4},
+    [30] = {TK_GOTO, 4},
+    [51] = {TK_IF, 2},
+    [49] = {TK_CONST, 5},
+    [19] = {TK_INT, 3},
+    [27] = {TK_LONG, 4},
+    [1] = {TK_SHORT, 5},
+    [29] = {TK_CHAR, 4},
+    [3] = {TK_SIGNED, 6},
+    [41] = {TK_UNSIGNED, 8},
+    [52] = {TK_FLOAT, 5},
+    [53] = {TK_DOUBLE, 6},
+    [12] = {TK_RETURN, 6},
+    [34] = {TK_VOID, 4},
+    [2] = {TK_STATIC, 6},
+    [63] = {TK_EXTERN, 6},
+    [54] = {TK_WHILE, 5},
+    [55] = {TK_DO, 2},
+    [14] = {TK_FOR, 3},
+    [39] = {TK_BREAK, 5},
+    [24] = {TK_CONTINUE, 8},
+    [7] = {TK_SWITCH, 6},
+    [16] = {TK_CASE, 4},
+    [22] = {TK_DEFAULT, 7},
+};
+
+#endif //BCC_KEYWORDS_H
@@ -3,43 +3,82 @@
 //
 
 #include <stdlib.h>
+#include <limits.h>
 #include <ctype.h>
 #include <assert.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "lexer.h"
+#include "keywords.h"
+#include "scan.h"
 
 #include <stdio.h>
 
 #include "../parser/ast.h"
 #include "../utils/startup.h"
-
-void token_delete(struct Token token) {
-    // no-op
-}
-struct list_of_token_helpers list_of_token_helpers = {
-        .delete = token_delete,
-        .null = {},
-};
-LIST_OF_ITEM_DEFN(list_of_token,struct Token)
-
-
-// This is a pretty long line, but generated code can be longer.
-#define INITIAL_LINE_BUFFER_SIZE 512
-
-char *lineBuffer = NULL;
-int lineBufferSize = 0;
-int lineNumber = 0;
+#include "../utils/trace.h"
+#include "inc/utils.h"
+#include "inc/strpool.h"
+
+LIST_OF_ITEM_DEFN_STATIC(list_of_token,struct Token,LIST_OF_NO_DELETE)
+LIST_OF_ITEM_DECL(list_of_long_value,uint64_t)
+LIST_OF_ITEM_DEFN_STATIC(list_of_long_value,uint64_t,LIST_OF_NO_DELETE)
+_Static_assert(sizeof(struct Token) == 8, "tokens are pre-lexed by the million");
+
+
+// Initial size of the buffer used when the source can't be mapped (eg, it's a pipe). Doubles as needed.
+#define INITIAL_SOURCE_BUFFER_SIZE (64*1024)
+// Zeroed bytes following the source text in a heap buffer. The first one is the end-of-text sentinel,
+// and the scanning kernels may read up to SCAN_MAX_OVERREAD bytes past it.
+#define SOURCE_PADDING (SCAN_MAX_OVERREAD+1)
+
+// The entire source text, either mapped from the file or read into a heap buffer. Always followed by a '\0'.
+const char *sourceBuffer = NULL;
+// One past the last character of source text; *sourceEnd == '\0'.
+const char *sourceEnd = NULL;
+// Size of the mapping, if sourceBuffer is mapped, or 0 if it was malloc'd.
+size_t sourceMappedSize = 0;
+// Bytes at the front of a mapped source whose pages have been given back; see lex_release_consumed().
+static size_t sourceReleased = 0;
+
+// Line number of lineCountedTo, counted lazily by lex_line_number().
+int lineNumber = 1;
+// Newlines before this point have been counted into lineNumber.
+const char *lineCountedTo;
+
+// The string pool id of each token type's name, used as the text_id of keywords and operators.
+uint32_t token_name_ids[NUM_TOKEN_TYPES];
+
+// The pre-lexed tokens of the whole file, when lex_prelex() has been called. Ends with TK_EOF.
+struct list_of_token prelexed_tokens;
+int prelexed = 0;
+// Index in prelexed_tokens of the next token to be taken.
+int next_token_ix = 0;
 
 #define MAX_READAHEAD 3
 
-// Pointer to next character in line buffer.
+// Pointer to next character in source buffer.
 const char *pBuffer;
-// Pointer to beginning of current token, in line buffer
+// Pointer to beginning of current token, in source buffer
 const char *token_begin;
-// Pointer to end of current token, in line buffer
+// Pointer to end of current token, in source buffer
 const char *token_end;
+// Value of the current token, if it is a literal.
+static uint64_t token_value;
+// The values of the long literals of the file, indexed by their tokens' long_ix.
+static struct list_of_long_value long_values;
 
 struct Token current_token;
 
+/**
+ * When it is necessary to look ahead without affecting the "current_token", the "peeked" token is stored here.
+ * Only used when the tokens have not been pre-lexed.
+ */
+struct Token readahead_list[MAX_READAHEAD];
+int readahead_count = 0;
+
 const char *token_names[NUM_TOKEN_TYPES] = {
 #define X(a,b,c) b
     TOKENS__
@@ -51,16 +90,23 @@ enum TOKEN_FLAGS TOKEN_FLAGS[] = {
 #undef X
 };
 
+// The operator and punctuation tokens are recognized by a DFA built from token_names. States are the
+// distinct prefixes of those tokens; state 0 is the empty prefix, and a transition to 0 means "no
+// longer token". Indexed directly by character, so a step is a single load.
+#define MAX_DFA_STATES 64
+unsigned char dfa_next[MAX_DFA_STATES][256];
+// The token recognized in each state, or TK_UNKNOWN if that prefix is not itself a token.
+unsigned char dfa_accept[MAX_DFA_STATES];
+_Static_assert(NUM_TOKEN_TYPES <= 256, "dfa_accept holds token types in a byte");
+
 char const *sourceFileName;
-FILE *sourceFile = NULL;
-int atEOF = 1;
 
 // Forwards
 
-static void tokens_set_init(void);
-static const char * tokens_set_insert(const char *str);
-int tokens_set_contains(const char *str);
-static int read_next_line(void);
+static void lex_tables_init(void);
+static void release_source(void);
+static int map_source(int fd, size_t size);
+static int read_source(int fd);
 // lex a numeric token_text
 static enum TK numericToken(void);
 // lex a word token_text (keyword or identifier)
@@ -68,36 +114,64 @@ static enum TK wordToken(void);
 
 
 /**
- * Opens a source file for lexing. Initializes the token_text buffer on first call.
- * Closes any previously opened file.
+ * Opens a source file for lexing. Initializes the lexer's tables on first call.
+ * Releases any previously opened file.
+ *
+ * A regular file is mapped into memory in its entirety, and the tokenizer walks the mapping directly;
+ * anything else (eg, a pipe) is read into a heap buffer. Either way, the text is followed by a '\0'.
  * @param fname to be opened
  * @return zero if the file could not be opened, non-zero if opened.
  */
 int lex_openFile(char const *fname) {
+    static int initialized = 0;
     if (sourceFileName != NULL) {
         free((char*)sourceFileName);
+        sourceFileName = NULL;
     }
-    if (sourceFile != NULL) {
-        fclose(sourceFile);
+    release_source();
+    int fd = open(fname, O_RDONLY);
+    if (fd < 0) {
+        return 0;
     }
-    sourceFile = fopen(fname, "r");
-    if (sourceFile == NULL) {
-        atEOF = 1;
+    struct stat st;
+    int ok = (fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) ? map_source(fd, (size_t)st.st_size) : read_source(fd);
+    close(fd);
+    if (!ok) {
         return 0;
     }
     sourceFileName = strdup(fname);
-    atEOF = 0;
-    if (lineBuffer == NULL) {
-        lineBufferSize = INITIAL_LINE_BUFFER_SIZE;
-        lineBuffer = malloc(lineBufferSize);
-        lineBuffer[0] = '\0';
-        pBuffer = lineBuffer;
-
-        tokens_set_init();
+    if (prelexed) {
+        list_of_token_delete(&prelexed_tokens);
+        prelexed = 0;
+    }
+    readahead_count = 0;
+    list_of_long_value_clear(&long_values);
+    sourceReleased = 0;
+    pBuffer = token_begin = token_end = lineCountedTo = sourceBuffer;
+    lineNumber = 1;
+    if (!initialized) {
+        lex_tables_init();
+        list_of_long_value_init(&long_values, 0);
+        initialized = 1;
     }
     return 1;
 }
 
+/**
+ * The line number of the most recently tokenized token. Lines are counted on demand, by scanning
+ * for '\n' from wherever the previous count stopped.
+ * @return the 1-based line number.
+ */
+int lex_line_number(void) {
+    const char *nl;
+    while ((nl = memchr(lineCountedTo, '\n', token_begin - lineCountedTo)) != NULL) {
+        ++lineNumber;
+        lineCountedTo = nl + 1;
+    }
+    lineCountedTo = token_begin;
+    return lineNumber;
+}
+
 /**
  * The name of the given token, like "+" or ">=". Note that the name of an identifier token is not the identifier,
  * but rather "an identifier".
@@ -111,12 +185,6 @@ const char *lex_token_name(enum TK token) {
 static struct Token internal_take_token(void);
 static enum TK tokenizer(void);
 
-/**
- * When it is necessary to look ahead without affecting the "current_token", the "peeked" token is stored here.
- */
-struct Token readahead_list[MAX_READAHEAD];
-int readahead_count = 0;
-
 /**
  * Peek at the next token without affecting the "current_token".
  * @return the "next" token.
@@ -127,12 +195,16 @@ struct Token lex_peek_token(void) {
 
 /**
  * Peek at the nth token. n==1 means peek at the token that will be returned by lex_take_token()
+ * Once the file has been pre-lexed, n may be any distance; peeking past the end gives TK_EOF.
  * @param n the token at which to peek.
  * @return The token.
  */
 struct Token lex_peek_ahead(int n) {
+    if (prelexed) {
+        int ix = next_token_ix + n - 1;
+        return prelexed_tokens.items[ix < prelexed_tokens.num_items ? ix : prelexed_tokens.num_items - 1];
+    }
     assert(n <= MAX_READAHEAD);
-    int x = n - readahead_count;
     while ((n - readahead_count) > 0) {
         readahead_list[readahead_count++] = internal_take_token();
     }
@@ -146,20 +218,88 @@ struct Token lex_peek_ahead(int n) {
  * @return the next token.
  */
 struct Token lex_take_token(void) {
+    if (prelexed) {
+        current_token = prelexed_tokens.items[next_token_ix];
+        // Stay on the final TK_EOF.
+        if (next_token_ix < prelexed_tokens.num_items - 1) ++next_token_ix;
+        TRACE(TRACE_TOKENS, "Take token (%d) %s\n", current_token.tk, lex_token_text(current_token));
+        return current_token;
+    }
     if (readahead_count) {
         current_token = readahead_list[0];
         for (int i=0; i<readahead_count-1; ++i) {
             readahead_list[i] = readahead_list[i+1];
         }
         --readahead_count;
-        if (traceTokens) printf("Take ra token (%d) %s\n", current_token.tk, current_token.text);
+        TRACE(TRACE_TOKENS, "Take ra token (%d) %s\n", current_token.tk, lex_token_text(current_token));
         return current_token;
     }
     current_token = internal_take_token();
-    if (traceTokens) printf("Take token (%d) %s\n", current_token.tk, current_token.text);
+    TRACE(TRACE_TOKENS, "Take token (%d) %s\n", current_token.tk, lex_token_text(current_token));
     return current_token;
 }
 
+/**
+ * Lets the system reclaim the pages of a mapped source file that lie wholly before the current token, for
+ * compiling a file a function at a time. The pages are read from the file again if they are ever looked at.
+ */
+void lex_release_consumed(void) {
+    if (!sourceMappedSize || prelexed) return;
+    // Lines are counted from where the count last stopped; bring it up to here first.
+    lex_line_number();
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t consumed = (size_t)(lineCountedTo - sourceBuffer) / page * page;
+    if (consumed > sourceReleased) {
+        madvise((char *)sourceBuffer + sourceReleased, consumed - sourceReleased, MADV_DONTNEED);
+        sourceReleased = consumed;
+    }
+}
+
+/**
+ * Tokenizes the rest of the open file into a contiguous array. Afterwards, lex_take_token() and
+ * lex_peek_ahead() just index into the array, and lookahead is unlimited.
+ */
+void lex_prelex(void) {
+    if (prelexed) return;
+    // Typical pre-processed code is about 5 bytes per token.
+    list_of_token_init(&prelexed_tokens, (int)((sourceEnd - pBuffer) / 4) + 16);
+    // Any tokens already peeked come first.
+    for (int i=0; i<readahead_count; ++i) {
+        list_of_token_append(&prelexed_tokens, readahead_list[i]);
+    }
+    readahead_count = 0;
+    struct Token token;
+    do {
+        token = internal_take_token();
+        list_of_token_append(&prelexed_tokens, token);
+    } while (token.tk != TK_EOF);
+    next_token_ix = 0;
+    prelexed = 1;
+}
+
+/**
+ * The text of a token: the identifier as written, the literal's value, or the token's name.
+ * @param token whose text is wanted.
+ * @return the text. That of a literal is only good until the next call.
+ */
+const char *lex_token_text(struct Token token) {
+    if (token.tk == TK_LITERAL || token.tk == TK_LONG_LITERAL) {
+        static char buf[24];
+        snprintf(buf, sizeof(buf), "%llu", (unsigned long long)lex_token_value(token));
+        return buf;
+    }
+    return strpool_str(token.text_id);
+}
+
+/**
+ * The value of a literal token.
+ * @param token a TK_LITERAL or TK_LONG_LITERAL.
+ * @return its value.
+ */
+uint64_t lex_token_value(struct Token token) {
+    return token.tk == TK_LONG_LITERAL ? long_values.items[token.long_ix] : token.int_value;
+}
+
 /**
  * Internal (to the lexer) function to read the next token. May not immediately become the "current_token"
  * if the parser is looking ahead.
@@ -167,14 +307,14 @@ struct Token lex_take_token(void) {
  */
 static struct Token internal_take_token(void) {
     enum TK tk = tokenizer();
-    struct Token token = {.tk = tk};
-    if (tk == TK_ID || tk == TK_LITERAL) {
-        char saved = *token_end;
-        *(char *) token_end = '\0';  // const_cast<char*>()
-        token.text = tokens_set_insert(token_begin);
-        *(char *) token_end = saved;
-    } else {
-        token.text = lex_token_name(tk);
+    struct Token token = {.tk = tk, .text_id = token_name_ids[tk]};
+    if (tk == TK_ID) {
+        token.text_id = strpool_intern_n(token_begin, token_end - token_begin);
+    } else if (tk == TK_LITERAL) {
+        token.int_value = (uint32_t)token_value;
+    } else if (tk == TK_LONG_LITERAL) {
+        token.long_ix = long_values.num_items;
+        list_of_long_value_append(&long_values, token_value);
     }
     return token;
 }
@@ -184,174 +324,50 @@ static struct Token internal_take_token(void) {
  * @return the token_text, or TK_EOF when no more.
  */
 static enum TK tokenizer(void) {
-    // Skip whitespace. At the end of line, read another line.
-    while (isspace(*pBuffer) || *pBuffer=='\0') {
-        if (*pBuffer == '\0') {
-            if (read_next_line())
-                pBuffer = lineBuffer;
-            else
-                return TK_EOF;
-        } else {
+    // Skip whitespace. A '\0' is the end of the source text, unless it's a stray one in the text.
+    for (;;) {
+        // Most runs of whitespace are a single space, so only longer ones go to the scanning kernel.
+        if (char_class[(unsigned char)*pBuffer] & CC_SPACE) {
             ++pBuffer;
+            if (char_class[(unsigned char)*pBuffer] & CC_SPACE)
+                pBuffer = scan_space(pBuffer + 1);
+        }
+        if (*pBuffer != '\0')
+            break;
+        if (pBuffer >= sourceEnd) {
+            token_end = token_begin = pBuffer;
+            return TK_EOF;
         }
+        ++pBuffer;
     }
 
     // pBuffer points to a non-whitespace character. Look there for a token; none yet.
     token_end = token_begin = pBuffer;
 
+    unsigned char cc = char_class[(unsigned char)*pBuffer];
     // Starts with alpha or '_'? keyword or identifier
-    if (isalpha(*pBuffer) || *pBuffer=='_') {
+    if (cc & CC_IDENT_START) {
         return wordToken();
     }
-
     // Starts with digit (todo: or . followed by digit)? Numeric literal
-    if (isdigit(*pBuffer) /* || *pBuffer=='.' && isdigit(*pBuffer+1) */ ) {
+    if (cc & CC_DIGIT) {
         return numericToken();
     }
 
-    // Assume a one-character token, and adjust if two- or three-character token.
-    ++token_end;
-    // See what we really have.
-    switch (*pBuffer++) {
-        case '(':
-            return TK_L_PAREN;
-        case ')':
-            return TK_R_PAREN;
-        case '{':
-            return TK_L_BRACE;
-        case '}':
-            return TK_R_BRACE;
-        case ';':
-            return TK_SEMI;
-        case ',':
-            return TK_COMMA;
-        case '+':
-            if (*pBuffer == '+') {
-                ++pBuffer;
-                ++token_end;
-                return TK_INCREMENT;
-            } else if (*pBuffer == '=') {
-                ++pBuffer;
-                ++token_end;
-                return TK_ASSIGN_PLUS;
-            }
-            return TK_PLUS;
-        case '-': {
-            if (*pBuffer == '-') {
-                ++pBuffer;
-                ++token_end;
-                return TK_DECREMENT;
-            } else if (*pBuffer == '=') {
-                ++pBuffer;
-                ++token_end;
-                return TK_ASSIGN_MINUS;
-            }
-            return TK_HYPHEN;
+    // Operators and punctuation. Run the DFA as far as it goes, and take the longest token seen along the way.
+    int state = 0;
+    enum TK tk = TK_UNKNOWN;
+    const char *p = pBuffer;
+    const char *accepted = pBuffer + 1;     // An unknown character is consumed as a one-character token.
+    while ((state = dfa_next[state][(unsigned char)*p]) != 0) {
+        ++p;
+        if (dfa_accept[state] != TK_UNKNOWN) {
+            tk = dfa_accept[state];
+            accepted = p;
         }
-        case '*':
-            if (*pBuffer == '=') {
-                ++pBuffer;
-                ++token_end;
-                return TK_ASSIGN_MULT;
-            }
-            return TK_ASTERISK;
-        case '/':
-            if (*pBuffer == '=') {
-                ++pBuffer;
-                ++token_end;
-                return TK_ASSIGN_DIV;
-            }
-            return TK_SLASH;
-        case '%':
-            if (*pBuffer == '=') {
-                ++pBuffer;
-                ++token_end;
-                return TK_ASSIGN_MOD;
-            }
-            return TK_PERCENT;
-        case '&':
-            if (*pBuffer == '&') {
-                ++pBuffer;
-                ++token_end;
-                return TK_L_AND;
-            } else if (*pBuffer == '=') {
-                ++pBuffer;
-                ++token_end;
-                return TK_ASSIGN_AND;
-            }
-            return TK_AMPERSAND;
-        case '|':
-            if (*pBuffer == '|') {
-                ++pBuffer;
-                ++token_end;
-                return TK_L_OR;
-            } else if (*pBuffer == '=') {
-                ++pBuffer;
-                ++token_end;
-                return TK_ASSIGN_OR;
-            }
-            return TK_OR;
-        case '^':
-            if (*pBuffer == '=') {
-                ++pBuffer;
-                ++token_end;
-                return TK_ASSIGN_XOR;
-            }return TK_CARET;
-        case '!':
-            if (*pBuffer == '=') {
-                ++pBuffer;
-                ++token_end;
-                return TK_NE;
-            }
-            return TK_L_NOT;
-        case '=':
-            if (*pBuffer == '=') {
-                ++pBuffer;
-                ++token_end;
-                return TK_EQ;
-            }
-            return TK_ASSIGN;
-        case '<':
-            if (*pBuffer == '<') {
-                ++pBuffer;
-                ++token_end;
-                if (*pBuffer == '=') {
-                    ++pBuffer;
-                    ++token_end;
-                    return TK_ASSIGN_LSHIFT;
-                }
-                return TK_LSHIFT;
-            } else if (*pBuffer == '=') {
-                ++pBuffer;
-                ++token_end;
-                return TK_LE;
-            }
-            return TK_LT;
-        case '>':
-            if (*pBuffer == '>') {
-                ++pBuffer;
-                ++token_end;
-                if (*pBuffer == '=') {
-                    ++pBuffer;
-                    ++token_end;
-                    return TK_ASSIGN_RSHIFT;        // >>=
-                }
-                return TK_RSHIFT;                   // >>
-            } else if (*pBuffer == '=') {
-                ++pBuffer;
-                ++token_end;
-                return TK_GE;                       // >=
-            }
-            return TK_GT;                           // >
-        case '~':
-            return TK_TILDE;
-        case '?':
-            return TK_QUESTION;
-        case ':':
-            return TK_COLON;
-        default:
-            return TK_UNKNOWN;
     }
+    token_end = pBuffer = accepted;
+    return tk;
 }
 
 /**
@@ -360,102 +376,149 @@ static enum TK tokenizer(void) {
  * @return the TK kind.
  */
 enum TK wordToken(/*int intCh*/) {
-    while (isalnum(*pBuffer) || *pBuffer=='_') {
-        ++pBuffer;
-    }
+    pBuffer = scan_ident(pBuffer);
     token_end = pBuffer; // next character after token
 
-    // Is it a keyword?
+    // Is it a keyword? The perfect hash names the only keyword it could be.
     int token_length = (int)(token_end - token_begin);
-    for (int kwix=TK_KEYWORDS_BEGIN; kwix < TK_KEYWORDS_END; ++kwix) {
-        if (token_end-token_begin == strlen(token_names[kwix]) &&
-                memcmp(token_begin, token_names[kwix], token_length) == 0)
-            return kwix;
-    }
+    const struct keyword_slot *slot = &keyword_table[KEYWORD_HASH(token_begin[0], token_end[-1], token_length)];
+    if (slot->length == token_length && memcmp(token_begin, token_names[slot->tk], token_length) == 0)
+        return slot->tk;
 
     return TK_ID;
 }
 
 /**
- * Parse a run of decimal digits.
- * @return TK_LITERAL if a well-formed number (currently integer), and TK_UNKNOWN if the digit(s) are
- * prefix to an alpha character or '_'.
+ * Parse a run of decimal digits, and an optional 'l' or 'L' suffix. The value is accumulated as the digits
+ * are read, into token_value. Without the suffix, a value too big for an int is a long, as in C.
+ * @return TK_LITERAL or TK_LONG_LITERAL if a well-formed number (currently integer), and TK_UNKNOWN if the
+ * digit(s) are prefix to an alpha character or '_'.
  */
 enum TK numericToken(void) {
     // Only reads decimal constants.
-    while (isdigit(*pBuffer))
+    // The first character is known to be a digit.
+    uint64_t value = *pBuffer++ - '0';
+    while (char_class[(unsigned char)*pBuffer] & CC_DIGIT) {
+        unsigned int digit = *pBuffer++ - '0';
+        if (value > ((uint64_t)LONG_MAX - digit) / 10) {
+            failf("Integer constant too large at line %d", lex_line_number());
+        }
+        value = value * 10 + digit;
+    }
+    enum TK tk = value > INT_MAX ? TK_LONG_LITERAL : TK_LITERAL;
+    if (*pBuffer == 'l' || *pBuffer == 'L') {
         ++pBuffer;
+        tk = TK_LONG_LITERAL;
+    }
     token_end = pBuffer;
+    token_value = value;
 
-    if (isalpha(*pBuffer) || *pBuffer=='_') {
+    if (char_class[(unsigned char)*pBuffer] & CC_IDENT_START) {
         return TK_UNKNOWN;
     }
-    return TK_LITERAL;
+    return tk;
 }
 
-extern struct set_of_str token_strings;
-struct set_of_str token_strings;
 /**
- * Initialize the set of token_text strings.
+ * Builds the character class table, selects the scanning kernels, and builds the DFA for operators and punctuation. Any token whose text
+ * is entirely punctuation characters is recognized by the DFA, so adding one to TOKENS__ is enough.
  */
-void tokens_set_init(void) {
-    set_of_str_init(&token_strings, 101);
-}
-int tokens_set_contains(const char *str) {
-    return set_of_str_find(&token_strings, str, NULL);
-}
-const char * tokens_set_insert(const char *str) {
-    return set_of_str_insert(&token_strings, str);
+static void lex_tables_init(void) {
+    for (const char *p = " \t\n\v\f\r"; *p; ++p) char_class[(unsigned char)*p] |= CC_SPACE;
+    for (int ch = 'a'; ch <= 'z'; ++ch) char_class[ch] |= CC_IDENT_START;
+    for (int ch = 'A'; ch <= 'Z'; ++ch) char_class[ch] |= CC_IDENT_START;
+    char_class['_'] |= CC_IDENT_START;
+    for (int ch = '0'; ch <= '9'; ++ch) char_class[ch] |= CC_DIGIT;
+    scan_init(configOptScanKernel);
+    for (enum TK tk = 0; tk < NUM_TOKEN_TYPES; ++tk) {
+        token_name_ids[tk] = strpool_intern(token_names[tk]);
+    }
+
+    int num_states = 1;         // State 0 is the start state.
+    for (enum TK tk = 0; tk < NUM_TOKEN_TYPES; ++tk) {
+        const char *text = token_names[tk];
+        const char *p = text;
+        while (*p && ispunct((unsigned char)*p)) ++p;
+        if (p == text || *p) continue;  // Not an operator or punctuation token.
+        int state = 0;
+        for (p = text; *p; ++p) {
+            unsigned char ch = (unsigned char)*p;
+            if (!dfa_next[state][ch]) {
+                if (num_states == MAX_DFA_STATES) fail("Too many DFA states for operator tokens");
+                dfa_next[state][ch] = num_states++;
+            }
+            state = dfa_next[state][ch];
+        }
+        dfa_accept[state] = tk;
+    }
 }
 
 /**
- * Reads the next non-blank line from the input stream. Lines terminate with '\n' or at EOF.
- * @return non-zero if a line was read, 0 if no more lines.
+ * Maps a regular file, followed by at least one page of zeroes. The extra page guarantees a '\0' after
+ * the text even when the file size is an exact multiple of the page size.
+ * @param fd of the open file.
+ * @param size of the file, in bytes.
+ * @return non-zero if mapped, 0 if not.
  */
-static int read_next_line(void) {
-    if (atEOF) return 0;
-    char *pBuf = lineBuffer;
-    char *pEnd = lineBuffer + lineBufferSize;
-    int intCh;
-    int readAnything = 0;
-    while ((intCh=fgetc(sourceFile)) != EOF) {
-        readAnything = 1;
-        // Checking for end of line. First check for LF
-        if (intCh == '\n') {
-            ++lineNumber;
-            break;
-        } else if (intCh == '\r') {
-            ++lineNumber;
-            // If CR, look at next character.
-            intCh = fgetc(sourceFile);
-            // If not an LF, put it back. If LF, consume it as well.
-            if (intCh != '\n' && intCh != EOF) {
-                ungetc(intCh, sourceFile);
-            }
-            break;
+static int map_source(int fd, size_t size) {
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t mappedSize = (size + page - 1) / page * page + page;
+    // Reserve the whole range as zeroes, then map the file over the front of it.
+    char *base = mmap(NULL, mappedSize, PROT_READ, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) {
+        return read_source(fd);
+    }
+    if (size > 0) {
+        if (mmap(base, size, PROT_READ, MAP_PRIVATE|MAP_FIXED, fd, 0) == MAP_FAILED) {
+            munmap(base, mappedSize);
+            return read_source(fd);
         }
-        // Keep the character.
-        *pBuf++ = (char)intCh;
-        // Is buffer full now?
-        if (pBuf == pEnd) {
-            // Alocate a new buffer 2x size of old, copy data.
-            char *newBuf = malloc(lineBufferSize * 2);
-            memcpy(newBuf, lineBuffer, lineBufferSize);
-            newBuf[lineBufferSize] = '\0';
-            free(lineBuffer);
-            lineBuffer = newBuf;
-            // pBuf should point just past the old data.
-            pBuf = lineBuffer + lineBufferSize;
-            lineBufferSize += 2;
-            pEnd = lineBuffer + lineBufferSize;
+        madvise(base, size, MADV_SEQUENTIAL);
+    }
+    sourceBuffer = base;
+    sourceEnd = base + size;
+    sourceMappedSize = mappedSize;
+    return 1;
+}
+
+/**
+ * Reads the entire source from a file that can't be mapped, such as a pipe, into a heap buffer.
+ * @param fd of the open file.
+ * @return non-zero if read, 0 on a read error.
+ */
+static int read_source(int fd) {
+    size_t capacity = INITIAL_SOURCE_BUFFER_SIZE;
+    size_t length = 0;
+    char *buf = malloc(capacity + SOURCE_PADDING);
+    ssize_t nRead;
+    while ((nRead = read(fd, buf + length, capacity - length)) > 0) {
+        length += nRead;
+        if (length == capacity) {
+            capacity *= 2;
+            buf = realloc(buf, capacity + SOURCE_PADDING);
         }
     }
-    // Null terminate the line.
-    *pBuf = '\0';
-    if (intCh == EOF) {
-        atEOF = 1;
-        // If all we read was EOF, return 0. If we read anything, even an empty line, return 1.
-        return readAnything;
+    if (nRead < 0) {
+        free(buf);
+        return 0;
     }
+    memset(buf + length, 0, SOURCE_PADDING);
+    sourceBuffer = buf;
+    sourceEnd = buf + length;
+    sourceMappedSize = 0;
     return 1;
-}
\ No newline at end of file
+}
+
+/**
+ * Unmaps or frees the source text of any previously opened file.
+ */
+static void release_source(void) {
+    if (sourceBuffer == NULL) return;
+    if (sourceMappedSize) {
+        munmap((void *)sourceBuffer, sourceMappedSize);
+    } else {
+        free((void *)sourceBuffer);
+    }
+    sourceBuffer = sourceEnd = NULL;
+    sourceMappedSize = 0;
+}
@@ -5,21 +5,34 @@
 #ifndef BCC_LEXER_H
 #define BCC_LEXER_H
 
+#include <stdint.h>
+
 #include "tokens.h"
 #include "inc/list_of.h"
 
+// A token is its type and, for a literal, its value, or for anything else, the string pool id of its text;
+// see lex_token_text(). A long literal's value is kept aside, so that a token stays 8 bytes; see lex_token_value().
 struct Token {
     enum TK tk;
-    const char *text;
+    union {
+        uint32_t text_id;
+        uint32_t int_value;     // TK_LITERAL
+        uint32_t long_ix;       // TK_LONG_LITERAL, the index of its value
+    };
 };
 
-LIST_OF_ITEM_DECL(list_of_token,struct Token)
+LIST_OF_ITEM_DECL_SMALL(list_of_token,struct Token,4)
 
 extern int lex_openFile(char const *fname);
+extern int lex_line_number(void);
 
 extern struct Token lex_peek_ahead(int n);
 extern struct Token lex_peek_token(void);
 extern struct Token lex_take_token(void);
+extern void lex_prelex(void);
+extern void lex_release_consumed(void);
+extern const char *lex_token_text(struct Token token);
+extern uint64_t lex_token_value(struct Token token);
 
 extern const char *lex_token_name(enum TK token);
 extern struct Token current_token;
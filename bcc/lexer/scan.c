@@ -0,0 +1,127 @@
+//
+// Created by Bill Evans on 10/17/26.
+//
+
+#include <string.h>
+
+#include "scan.h"
+#include "inc/utils.h"
+
+#if defined(__x86_64__) && !defined(SCAN_SCALAR_ONLY)
+#define SCAN_HAVE_X86 1
+#include <immintrin.h>
+#endif
+
+unsigned char char_class[256];
+
+scan_fn scan_space;
+scan_fn scan_ident;
+static const char *kernel_name;
+
+//
+// Scalar kernels, one byte per iteration. Always available.
+//
+static const char *scan_space_scalar(const char *p) {
+    while (char_class[(unsigned char)*p] & CC_SPACE) ++p;
+    return p;
+}
+static const char *scan_ident_scalar(const char *p) {
+    while (char_class[(unsigned char)*p] & (CC_IDENT_START|CC_DIGIT)) ++p;
+    return p;
+}
+
+#if SCAN_HAVE_X86
+//
+// Vector kernels. Each computes a mask of the bytes in the run, and stops at the first byte not in it.
+// Range tests use the unsigned "(c - lo) <= (hi - lo)" form, as min_epu8(c - lo, hi - lo) == c - lo.
+//
+#define IN_RANGE_128(v, lo, hi) \
+    _mm_cmpeq_epi8(_mm_min_epu8(_mm_sub_epi8((v), _mm_set1_epi8(lo)), _mm_set1_epi8((hi)-(lo))), _mm_sub_epi8((v), _mm_set1_epi8(lo)))
+#define IN_RANGE_256(v, lo, hi) \
+    _mm256_cmpeq_epi8(_mm256_min_epu8(_mm256_sub_epi8((v), _mm256_set1_epi8(lo)), _mm256_set1_epi8((hi)-(lo))), _mm256_sub_epi8((v), _mm256_set1_epi8(lo)))
+
+static inline __m128i space_mask_128(__m128i v) {
+    return _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')), IN_RANGE_128(v, '\t', '\r'));
+}
+static inline __m128i digit_mask_128(__m128i v) {
+    return IN_RANGE_128(v, '0', '9');
+}
+static inline __m128i ident_mask_128(__m128i v) {
+    // Setting 0x20 folds upper case onto lower case, and maps no other character into 'a'..'z'.
+    __m128i alpha = IN_RANGE_128(_mm_or_si128(v, _mm_set1_epi8(0x20)), 'a', 'z');
+    __m128i under = _mm_cmpeq_epi8(v, _mm_set1_epi8('_'));
+    return _mm_or_si128(_mm_or_si128(alpha, under), digit_mask_128(v));
+}
+
+#define SCAN_128(name, mask_fn)                                                             \
+static const char *name(const char *p) {                                                    \
+    for (;;) {                                                                              \
+        unsigned int in_run = _mm_movemask_epi8(mask_fn(_mm_loadu_si128((const __m128i *)p))); \
+        if (in_run != 0xffff) return p + __builtin_ctz(~in_run);                            \
+        p += 16;                                                                            \
+    }                                                                                       \
+}
+SCAN_128(scan_space_sse2, space_mask_128)
+SCAN_128(scan_ident_sse2, ident_mask_128)
+
+#define AVX2 __attribute__((target("avx2")))
+static inline AVX2 __m256i space_mask_256(__m256i v) {
+    return _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')), IN_RANGE_256(v, '\t', '\r'));
+}
+static inline AVX2 __m256i digit_mask_256(__m256i v) {
+    return IN_RANGE_256(v, '0', '9');
+}
+static inline AVX2 __m256i ident_mask_256(__m256i v) {
+    __m256i alpha = IN_RANGE_256(_mm256_or_si256(v, _mm256_set1_epi8(0x20)), 'a', 'z');
+    __m256i under = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('_'));
+    return _mm256_or_si256(_mm256_or_si256(alpha, under), digit_mask_256(v));
+}
+
+#define SCAN_256(name, mask_fn)                                                             \
+static AVX2 const char *name(const char *p) {                                               \
+    for (;;) {                                                                              \
+        unsigned int in_run = _mm256_movemask_epi8(mask_fn(_mm256_loadu_si256((const __m256i *)p))); \
+        if (in_run != 0xffffffff) return p + __builtin_ctz(~in_run);                        \
+        p += 32;                                                                            \
+    }                                                                                       \
+}
+SCAN_256(scan_space_avx2, space_mask_256)
+SCAN_256(scan_ident_avx2, ident_mask_256)
+#endif
+
+/**
+ * Selects the scanning kernels.
+ * @param kernel to use, "scalar", "sse2" or "avx2". NULL or "auto" picks the widest one the CPU
+ *      supports. Asking for one that isn't available is an error.
+ */
+void scan_init(const char *kernel) {
+    int automatic = kernel == NULL || strcmp(kernel, "auto") == 0;
+#if SCAN_HAVE_X86
+    __builtin_cpu_init();
+    int have_avx2 = __builtin_cpu_supports("avx2");
+    if ((automatic && have_avx2) || (kernel && strcmp(kernel, "avx2") == 0)) {
+        if (!have_avx2) fail("AVX2 scanning requested, but the CPU doesn't support AVX2");
+        scan_space = scan_space_avx2;
+        scan_ident = scan_ident_avx2;
+        kernel_name = "avx2";
+        return;
+    }
+    if (automatic || strcmp(kernel, "sse2") == 0) {
+        scan_space = scan_space_sse2;
+        scan_ident = scan_ident_sse2;
+        kernel_name = "sse2";
+        return;
+    }
+#endif
+    if (!automatic && strcmp(kernel, "scalar") != 0) failf("Scanning kernel \"%s\" is not available", kernel);
+    scan_space = scan_space_scalar;
+    scan_ident = scan_ident_scalar;
+    kernel_name = "scalar";
+}
+
+/**
+ * @return the name of the selected scanning kernels, for tracing.
+ */
+const char *scan_kernel_name(void) {
+    return kernel_name;
+}
@@ -0,0 +1,28 @@
+//
+// Created by Bill Evans on 10/17/26.
+//
+
+#ifndef BCC_SCAN_H
+#define BCC_SCAN_H
+
+// Character classes, as bit flags in char_class[].
+enum CHAR_CLASS {
+    CC_SPACE        = 0x01,     // ' ', '\t', '\n', '\v', '\f', '\r'
+    CC_IDENT_START  = 0x02,     // A-Z, a-z, '_'
+    CC_DIGIT        = 0x04,     // 0-9
+};
+extern unsigned char char_class[256];
+
+// Kernels that find the end of a run of whitespace or identifier characters. Each returns a
+// pointer to the first character not in the run. The vector kernels read up to SCAN_MAX_OVERREAD bytes
+// beyond that character; the source buffer's '\0' sentinel ends every run, and the buffer must be
+// followed by at least that much readable padding.
+#define SCAN_MAX_OVERREAD 32
+typedef const char *(*scan_fn)(const char *p);
+extern scan_fn scan_space;
+extern scan_fn scan_ident;
+
+extern void scan_init(const char *kernel);
+extern const char *scan_kernel_name(void);
+
+#endif //BCC_SCAN_H
@@ -99,6 +99,7 @@ extern enum TOKEN_FLAGS TOKEN_FLAGS[];
     X(TK_ASSIGN_RSHIFT, ">>=",              TF_ASSIGNMENT|TK_BINOP(RSHIFT)),         \
     X(TK_ID,            "an identifier",    0),                                      \
     X(TK_LITERAL,       "a literal",        0),                                      \
+    X(TK_LONG_LITERAL,  "a long literal",   0),                                      \
     X(TK_EOF,           "eof",              0),
 
  enum TK {
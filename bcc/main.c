@@ -3,14 +3,19 @@
 #include <stdlib.h>
 
 #include "utils/startup.h"
+#include "utils/trace.h"
 #include "lexer/lexer.h"
 #include "parser/parser.h"
 #include "parser/ast.h"
 #include "amd64/ir2amd64.h"
+#include "amd64/emit_amd64.h"
 #include "parser/ast2ir.h"
 #include "ir/print_ir.h"
+#include "ir/ir_soa.h"
+#include "inc/strpool.h"
 
 #include "parser/print_ast.h"
+#include "parser/symtable.h"
 
 void preProcess();
 
@@ -20,11 +25,21 @@ void assembleAndLink();
 
 void cleanup();
 
+static void compile_streaming(void);
+static void remove_partial_asm(void);
+static FILE *open_dump(const char *fname);
+static void close_dump(FILE *file);
+
+int unit_tests();
+
 int main(int argc, char **argv, char **envv) {
     if (!parseConfig(argc, argv)) {
         fprintf(stderr, "Error in command line args.");
         return -1;
     }
+    if (configOptTest) {
+        return unit_tests();
+    }
     // For each file on the command line
     for (int ix=0; ix<numInputFileNames; ++ix) {
         parseInputFilename(ix);
@@ -74,57 +89,132 @@ void compile() {
     if (configOptLexOnly) {
         struct Token tk;
         while ((tk = lex_take_token()).tk != TK_EOF) {
-            printf("Token %d: %s\n", tk.tk, tk.text);
+            printf("Token %d: %s\n", tk.tk, lex_token_text(tk));
             if (tk.tk == TK_UNKNOWN) {
-                printf("Unknown token_text!\n");
+                printf("Unknown token_text at line %d!\n", lex_line_number());
                 exit(1);
             }
         }
+    } else if (!configOptParseOnly && !configOptValidateOnly && !configOptTackyOnly && !configOptCodegenOnly &&
+               !configOptDumpAst && !configOptDumpIr && !trace_enabled(TRACE_MEM)) {
+        // Only the assembly is wanted, so nothing needs the whole program at once.
+        compile_streaming();
     } else {
         struct CProgram *cProgram = c_program_parse();
+        if (trace_enabled(TRACE_MEM)) c_program_print_mem(cProgram, lex_line_number());
+        // The stage options show what was built, on stdout unless it is dumped elsewhere.
+        int show = configOptParseOnly || configOptValidateOnly || configOptTackyOnly || configOptCodegenOnly;
+        FILE *astDump = open_dump(configOptDumpAst ? configOptDumpAst : show ? "-" : NULL);
         if (configOptParseOnly) {
-            c_program_print(cProgram);
+            if (astDump) c_program_print(cProgram, astDump);
+            close_dump(astDump);
             c_program_delete(cProgram);
             return;
         }
+        analyze_program(cProgram);
+        if (astDump) c_program_print(cProgram, astDump);
+        close_dump(astDump);
         if (configOptValidateOnly) {
-            c_program_print(cProgram);
-            analyze_program(cProgram);
-            c_program_print(cProgram);
             c_program_delete(cProgram);
             return;
         }
-        analyze_program(cProgram);
         struct IrProgram *irProgram = ast2ir(cProgram);
+        FILE *irDump = open_dump(configOptDumpIr ? configOptDumpIr : show ? "-" : NULL);
+        if (irDump) print_ir(irProgram, irDump);
+        close_dump(irDump);
         if (configOptTackyOnly) {
-            c_program_print(cProgram);
-            print_ir(irProgram, stdout);
             c_program_delete(cProgram);
             IrProgram_delete(irProgram);
             return;
         }
         struct Amd64Program *asmProgram = ir2amd64(irProgram);
+        FILE *asmDump = open_dump(configOptDumpAsm ? configOptDumpAsm : show ? "-" : NULL);
         if (configOptCodegenOnly) {
-            c_program_print(cProgram);
-            print_ir(irProgram, stdout);
-            amd64_program_emit(asmProgram, stdout);
-            amd64_program_delete(asmProgram);
-            c_program_delete(cProgram);
-            return;
+            if (asmDump) amd64_program_emit(asmProgram, asmDump, NULL);
+        } else {
+            // Formatted once, written to the .s file and to any dump.
+            FILE *asmf = fopen(asmFname, "w");
+            amd64_program_emit(asmProgram, asmf, asmDump);
+            fclose(asmf);
         }
-        c_program_print(cProgram);
-        print_ir(irProgram, stdout);
-        amd64_program_emit(asmProgram, stdout);
-
-        FILE *asmf = fopen(asmFname, "w");
-        amd64_program_emit(asmProgram, asmf);
-        fclose(asmf);
+        close_dump(asmDump);
         amd64_program_delete(asmProgram);
         c_program_delete(cProgram);
     }
 
 }
 
+// A .s file that is still being written; removed if the compile fails part way.
+static const char *partialAsmFname = NULL;
+static void remove_partial_asm(void) {
+    if (partialAsmFname) remove(partialAsmFname);
+}
+
+/**
+ * Compiles the open file one function at a time: each function is parsed, analyzed, converted to IR and then
+ * to AMD64, and emitted, and its AST, IR, and AMD64 are freed before the next declaration is parsed. The
+ * static variables are emitted from the symbol table at the end; a function's automatic variables are dropped
+ * from the symbol table once it is emitted. Memory is bounded by the largest function, and the file-scope and
+ * static symbols, rather than by the size of the file.
+ */
+static void compile_streaming(void) {
+    static int atexit_registered = 0;
+    if (!atexit_registered) {
+        atexit(remove_partial_asm);
+        atexit_registered = 1;
+    }
+    struct CProgram *cProgram = c_program_parse_begin();
+    analyze_begin();
+    FILE *asmf = fopen(asmFname, "w");
+    partialAsmFname = asmFname;
+    FILE *asmDump = open_dump(configOptDumpAsm);
+    struct Amd64Emitter *emitter = amd64_emitter_new(asmf, asmDump);
+    struct CDeclaration *declaration;
+    while ((declaration = c_program_parse_next(cProgram)) != NULL) {
+        int first_symbol = get_num_symbols();
+        analyze_declaration(declaration);
+        if (declaration->decl_kind == FUNC_DECL) {
+            struct IrFunction *irFunction = ast2ir_function(declaration->func);
+            if (irFunction) {
+                struct Amd64Function *asmFunction = ir2amd64_function(irFunction);
+                IrFunction_delete(irFunction);
+                amd64_emitter_emit_function(emitter, asmFunction);
+                amd64_function_delete(asmFunction);
+            }
+        }
+        symtab_forget_locals(first_symbol);
+        c_program_clear(cProgram);
+        lex_release_consumed();
+    }
+    struct IrProgram *irProgram = ast2ir_static_vars();
+    struct Amd64Program *asmProgram = ir2amd64(irProgram);
+    amd64_emitter_emit_program(emitter, asmProgram);
+    amd64_emitter_delete(emitter);
+    fclose(asmf);
+    partialAsmFname = NULL;
+    close_dump(asmDump);
+    amd64_program_delete(asmProgram);
+    IrProgram_delete(irProgram);
+    c_program_delete(cProgram);
+}
+
+/**
+ * Opens a file to receive a dump of the AST, IR, or assembly.
+ * @param fname name of the file, "-" for stdout, or NULL for no dump.
+ * @return the file, or NULL for no dump.
+ */
+static FILE *open_dump(const char *fname) {
+    if (!fname) return NULL;
+    if (strcmp(fname, "-") == 0) return stdout;
+    FILE *file = fopen(fname, "w");
+    if (!file) failf("Can't open dump file %s", fname);
+    return file;
+}
+
+static void close_dump(FILE *file) {
+    if (file && file != stdout) fclose(file);
+}
+
 void assembleAndLink() {
     // system("gcc {asmFname} -o {executableFname")
     int rc = system(assembleAndLinkCommand);
@@ -133,3 +223,19 @@ void assembleAndLink() {
 void cleanup() {
 
 }
+
+/**
+ * Runs the compiler's built-in tests. "--test"
+ * @return 0 if all passed, 1 otherwise.
+ */
+int unit_tests() {
+    int failures = 0;
+    failures += ir2amd64_scaling_test();
+    failures += ir_soa_test();
+    failures += amd64_emit_test();
+    failures += parser_depth_test();
+    failures += parser_flow_id_test();
+    failures += strpool_concurrency_test();
+    failures += containers_test();
+    return failures ? 1 : 0;
+}
@@ -4,6 +4,7 @@
 // Created by Bill Evans on 8/28/24.
 //
 
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <printf.h>
@@ -14,30 +15,28 @@
 #include "../utils/startup.h"
 
 //region list and set definitions
-//region struct CIdentifier
-#pragma clang diagnostic push
-#pragma ide diagnostic ignored "UnusedParameter"
-void c_variable_delete(struct CIdentifier var) {}
-#pragma clang diagnostic pop
-struct list_of_CIdentifier_helpers list_of_CIdentifier_helpers = { .delete = c_variable_delete, .null = {0} };
-LIST_OF_ITEM_DEFN(list_of_CIdentifier,struct CIdentifier)
-//endregion struct CIdentifier
+// The nodes in the lists are owned by the AST arena, so the lists have nothing to delete.
+LIST_OF_ITEM_DEFN_STATIC(list_of_CIdentifier,struct CIdentifier,LIST_OF_NO_DELETE)
+
+LIST_OF_ITEM_DEFN_STATIC(list_of_CLabel,struct CLabel,LIST_OF_NO_DELETE)
 
-struct list_of_CLabel_helpers list_of_CLabel_helpers = { .delete = c_label_delete, .null = {0} };
-LIST_OF_ITEM_DEFN(list_of_CLabel,struct CLabel)
+LIST_OF_ITEM_DEFN_STATIC(list_of_CExpression,struct CExpression*,LIST_OF_NO_DELETE)
 
-struct list_of_CExpression_helpers list_of_CExpression_helpers = { .delete = c_expression_delete };
-LIST_OF_ITEM_DEFN(list_of_CExpression,struct CExpression*)
+LIST_OF_ITEM_DEFN_STATIC(list_of_CBlockItem,struct CBlockItem*,LIST_OF_NO_DELETE)
 
-struct list_of_CBlockItem_helpers list_of_CBlockItem_helpers = { .delete = c_block_item_delete };
-LIST_OF_ITEM_DEFN(list_of_CBlockItem,struct CBlockItem*)
+LIST_OF_ITEM_DEFN_STATIC(list_of_CFuncDecl,struct CFuncDecl*,LIST_OF_NO_DELETE)
 
-struct list_of_CFuncDecl_helpers list_of_CFuncDecl_helpers = { .delete = c_function_delete };
-LIST_OF_ITEM_DEFN(list_of_CFuncDecl,struct CFuncDecl*)
+LIST_OF_ITEM_DEFN_STATIC(list_of_CDeclaration,struct CDeclaration*,LIST_OF_NO_DELETE)
 //endregion list and set definitions
 
-struct list_of_CDeclaration_helpers list_of_CDeclaration_helpers = { .delete = c_declaration_delete };
-LIST_OF_ITEM_DEFN(list_of_CDeclaration,struct CDeclaration*)
+// Every node of the AST, and every list hanging off a node, is carved from the arena of the program
+// being built, in parse order. The whole tree is released at once by c_program_delete().
+#define AST_ARENA_BLOCK_SIZE (256*1024)
+static struct arena *ast_arena = NULL;
+
+static void *ast_alloc(size_t size) {
+    return arena_alloc(ast_arena, size);
+}
 
 const char * const AST_BINARY_NAMES[] = {
 #define X(a,b,c,d) b
@@ -82,23 +81,12 @@ struct CLabel c_label_new_switch_case(struct CExpression *expr) {
     label.expr = expr;
     return label;
 }
-void c_label_delete(struct CLabel label) {
-    switch (label.kind) {
-        case LABEL_CASE:
-            if (label.expr) c_expression_delete(label.expr);
-            break;
-        case LABEL_DECL:
-        case LABEL_DEFAULT:
-        case LABEL_NONE:
-            break;
-    }
-}
 //endregion
 
 //region CExpression
 static struct CExpression* c_expression_new(enum AST_EXP_KIND kind) {
-    struct CExpression* expression = malloc(sizeof(struct CExpression));
-    expression->kind = kind;
+    struct CExpression* expression = ast_alloc(sizeof(struct CExpression));
+    *expression = (struct CExpression){.kind = kind};
     return expression;
 }
 int c_expression_is_const(struct CExpression *exp) {
@@ -137,10 +125,19 @@ struct CExpression* c_expression_new_const(enum AST_CONST_TYPE const_type, int i
     expression->literal.int_val = int_val;
     return expression;
 }
-struct CExpression* c_expression_new_function_call(struct CIdentifier func) {
+/**
+ * Creates a function call expression.
+ * @param func the function being called.
+ * @param args of the call, copied into a list of exactly num_args.
+ * @param num_args number of args.
+ * @return the new expression.
+ */
+struct CExpression* c_expression_new_function_call(struct CIdentifier func, struct CExpression** args, int num_args) {
     struct CExpression* expression = c_expression_new(AST_EXP_FUNCTION_CALL);
     expression->function_call.func = func;
-    list_of_CExpression_init(&expression->function_call.args, 7);
+    list_of_CExpression_init_arena(&expression->function_call.args, num_args, ast_arena);
+    if (num_args) memcpy(expression->function_call.args.items, args, num_args * sizeof(struct CExpression*));
+    expression->function_call.args.num_items = num_args;
     return expression;
 }
 struct CExpression* c_expression_new_increment(enum AST_INCREMENT_OP op, struct CExpression* operand) {
@@ -155,19 +152,12 @@ struct CExpression* c_expression_new_unop(enum AST_UNARY_OP op, struct CExpressi
     expression->unary.operand = operand;
     return expression;
 }
-struct CExpression* c_expression_new_var(const char* name) {
+struct CExpression* c_expression_new_var(uint32_t name) {
     struct CExpression* expression = c_expression_new(AST_EXP_VAR);
     expression->var.name = name;
     expression->var.source_name = name;
     return expression;
 }
-void c_expression_function_call_add_arg(struct CExpression* call_expr, struct CExpression* arg) {
-    if (call_expr->kind != AST_EXP_FUNCTION_CALL) {
-        fprintf(stderr, "Error: c_expression_function_call_add_arg called on non-function call expression\n");
-        exit(1);
-    }
-    list_of_CExpression_append(&call_expr->function_call.args, arg);
-}
 struct CExpression* c_expression_clone(const struct CExpression* expression) {
     struct CExpression* clone = c_expression_new(expression->kind);
     switch (expression->kind) {
@@ -203,7 +193,7 @@ struct CExpression* c_expression_clone(const struct CExpression* expression) {
             break;
         case AST_EXP_FUNCTION_CALL:
             clone->function_call.func = expression->function_call.func;
-            list_of_CExpression_init(&clone->function_call.args, expression->function_call.args.num_items);
+            list_of_CExpression_init_arena(&clone->function_call.args, expression->function_call.args.num_items, ast_arena);
             for (int i = 0; i < expression->function_call.args.num_items; i++) {
                 list_of_CExpression_append(&clone->function_call.args, c_expression_clone(expression->function_call.args.items[i]));
             }
@@ -211,86 +201,43 @@ struct CExpression* c_expression_clone(const struct CExpression* expression) {
     }
     return clone;
 }
-void c_expression_delete(struct CExpression *expression) {
-    if (!expression) return;
-    if (traceAstMem) printf("Free expression @ %p\n", expression);
-    switch (expression->kind) {
-        case AST_EXP_BINOP:
-            if (expression->binop.left) c_expression_delete(expression->binop.left);
-            if (expression->binop.right) c_expression_delete(expression->binop.right);
-            break;
-        case AST_EXP_CONST:
-            // Nothing to do; strings owned by global string table.
-            break;
-        case AST_EXP_UNOP:
-            if (expression->unary.operand) c_expression_delete(expression->unary.operand);
-            break;
-        case AST_EXP_VAR:
-            break;
-        case AST_EXP_ASSIGNMENT:
-            if (expression->assign.src) c_expression_delete(expression->assign.src);
-            if (expression->assign.dst) c_expression_delete(expression->assign.dst);
-            break;
-        case AST_EXP_INCREMENT:
-            c_expression_delete(expression->increment.operand);
-            break;
-        case AST_EXP_CONDITIONAL:
-            c_expression_delete(expression->conditional.left_exp);
-            c_expression_delete(expression->conditional.middle_exp);
-            c_expression_delete(expression->conditional.right_exp);
-            break;
-        case AST_EXP_FUNCTION_CALL:
-            list_of_CExpression_delete(&expression->function_call.args);
-            break;
-    }
-    free(expression);
-}
 //endregion CExpression
 
 struct CDeclaration* c_declaration_new_var(struct CVarDecl* vardecl) {
-    struct CDeclaration* declaration = malloc(sizeof(struct CDeclaration));
+    struct CDeclaration* declaration = ast_alloc(sizeof(struct CDeclaration));
     declaration->decl_kind = VAR_DECL;
     declaration->var = vardecl;
     return declaration;
 }
 struct CDeclaration* c_declaration_new_func(struct CFuncDecl* funcdecl) {
-    struct CDeclaration* declaration = malloc(sizeof(struct CDeclaration));
+    struct CDeclaration* declaration = ast_alloc(sizeof(struct CDeclaration));
     declaration->decl_kind = FUNC_DECL;
     declaration->func = funcdecl;
     return declaration;
 }
-void c_declaration_delete(struct CDeclaration* declaration) {
-    switch (declaration->decl_kind) {
-        case FUNC_DECL:
-            c_function_delete(declaration->func);
-            break;
-        case VAR_DECL:
-            c_vardecl_delete(declaration->var);
-            break;
-    }
-    free(declaration);
-}
-
 //region CBlock
-struct CBlock* c_block_new(int is_function) {
-    struct CBlock* result = malloc(sizeof(struct CBlock));
-    list_of_CBlockItem_init(&result->items, 101);
+/**
+ * Creates a block.
+ * @param is_function non-zero if the block is a function's block.
+ * @param items of the block, copied into a list of exactly num_items.
+ * @param num_items number of items.
+ * @return the new block.
+ */
+struct CBlock* c_block_new(int is_function, struct CBlockItem** items, int num_items) {
+    struct CBlock* result = ast_alloc(sizeof(struct CBlock));
+    list_of_CBlockItem_init_arena(&result->items, num_items, ast_arena);
+    if (num_items) memcpy(result->items.items, items, num_items * sizeof(struct CBlockItem*));
+    result->items.num_items = num_items;
     result->is_function_block = is_function;
     return result;
 }
-void c_block_append_item(struct CBlock* block, struct CBlockItem* item) {
-    list_of_CBlockItem_append(&block->items, item);
-}
-void c_block_delete(struct CBlock *block) {
-    list_of_CBlockItem_delete(&block->items);
-    free(block);
-}
 //endregion
 
 //region CStatement
 static struct CStatement* c_statement_new(enum AST_STMT_KIND kind) {
-    struct CStatement* statement = malloc(sizeof(struct CStatement));
-    statement->kind = kind;
+    struct CStatement* statement = ast_alloc(sizeof(struct CStatement));
+    // Not every kind sets every field (labels, switch case_labels, ...), so start from all zeroes.
+    *statement = (struct CStatement){.kind = kind};
     return statement;
 }
 struct CStatement* c_statement_new_break(void) {
@@ -363,14 +310,16 @@ struct CStatement* c_statement_new_while(struct CExpression* condition, struct C
 int c_statement_has_labels(const struct CStatement * statement) {
     return statement->labels != NULL;
 }
-void c_statement_add_labels(struct CStatement *statement, struct list_of_CLabel newLabels) {
+void c_statement_add_labels(struct CStatement *statement, struct CLabel *labels, int num_labels) {
     if (statement->labels == NULL) {
-        statement->labels = malloc(sizeof(struct list_of_CLabel));
-        list_of_CLabel_init(statement->labels, newLabels.num_items);
+        statement->labels = ast_alloc(sizeof(struct list_of_CLabel));
+        list_of_CLabel_init_arena(statement->labels, num_labels, ast_arena);
+    } else {
+        list_of_CLabel_reserve(statement->labels, statement->labels->num_items + num_labels);
     }
-    for (int i = 0; i < newLabels.num_items; i++) {
-        list_of_CLabel_append(statement->labels, newLabels.items[i]);
-        newLabels.items[i] = (struct CLabel) {.kind = LABEL_NONE};
+    for (int i = 0; i < num_labels; i++) {
+        list_of_CLabel_append(statement->labels, labels[i]);
+        labels[i] = (struct CLabel) {.kind = LABEL_NONE};
     }
 }
 int c_statement_num_labels(const struct CStatement* statement) {
@@ -393,8 +342,8 @@ enum AST_RESULT c_statement_set_switch_has_default(struct CStatement *statement)
 }
 enum AST_RESULT c_statement_register_switch_case(struct CStatement *statement, int case_value) {
     if (statement->switch_statement.case_labels == NULL) {
-        statement->switch_statement.case_labels = malloc(sizeof(struct list_of_int));
-        list_of_int_init(statement->switch_statement.case_labels, 31);
+        statement->switch_statement.case_labels = ast_alloc(sizeof(struct list_of_int));
+        list_of_int_init_arena(statement->switch_statement.case_labels, 0, ast_arena);
     } else {
         for (int ix = 0; ix < statement->switch_statement.case_labels->num_items; ix++) {
             if (statement->switch_statement.case_labels->items[ix] == case_value) { return AST_DUPLICATE; }
@@ -404,94 +353,28 @@ enum AST_RESULT c_statement_register_switch_case(struct CStatement *statement, i
     return AST_OK;
 }
 
-void c_statement_delete(struct CStatement *statement) {
-    if (!statement) return;
-    switch (statement->kind) {
-        case STMT_BREAK:
-            // Nothing to free.
-            break;
-        case STMT_COMPOUND:
-            list_of_CBlockItem_delete(&statement->compound->items);
-            break;
-        case STMT_CONTINUE:
-            // Nothing to free.
-            break;
-        case STMT_DOWHILE:
-            c_expression_delete(statement->while_or_do_statement.condition);
-            c_statement_delete(statement->while_or_do_statement.body);
-            break;
-        case STMT_EXP:
-            c_expression_delete(statement->expression);
-            break;
-        case STMT_FOR:
-            c_for_init_delete(statement->for_statement.init);
-            c_expression_delete(statement->for_statement.condition);
-            c_expression_delete(statement->for_statement.post);
-            c_statement_delete(statement->for_statement.body);
-            break;
-        case STMT_GOTO:
-            c_expression_delete(statement->goto_statement.label);
-            break;
-        case STMT_IF:
-            c_expression_delete(statement->if_statement.condition);
-            c_statement_delete(statement->if_statement.then_statement);
-            if (statement->if_statement.else_statement) {
-                c_statement_delete(statement->if_statement.else_statement);
-            }
-            break;
-        case STMT_NULL:
-            // No-op
-            break;
-        case STMT_SWITCH:
-            c_expression_delete(statement->switch_statement.expression);
-            c_statement_delete(statement->switch_statement.body);
-            if (statement->switch_statement.case_labels) {
-                list_of_int_delete(statement->switch_statement.case_labels);
-                free(statement->switch_statement.case_labels);
-            }
-            break;
-        case STMT_WHILE:
-            c_expression_delete(statement->while_or_do_statement.condition);
-            c_statement_delete(statement->while_or_do_statement.body);
-            break;
-        case STMT_RETURN:
-        case STMT_AUTO_RETURN:
-            c_expression_delete(statement->expression);
-            break;
-    }
-    if (statement->labels) {
-        list_of_CLabel_delete(statement->labels);
-        free(statement->labels);
-    }
-    free(statement);
-}
 //endregion CStatement
 
 //region struct CVarDecl
-struct CVarDecl *c_vardecl_new(const char *identifier, enum STORAGE_CLASS storage_class) {
-    struct CVarDecl* result = malloc(sizeof(struct CVarDecl));
+struct CVarDecl *c_vardecl_new(uint32_t identifier, enum STORAGE_CLASS storage_class) {
+    struct CVarDecl* result = ast_alloc(sizeof(struct CVarDecl));
+    result->initializer = NULL;
     result->var.name = identifier;
     result->var.source_name = identifier;
     result->storage_class = storage_class;
     return result;
 }
 struct CVarDecl *
-c_vardecl_new_init(const char *identifier, struct CExpression *initializer, enum STORAGE_CLASS storage_class) {
+c_vardecl_new_init(uint32_t identifier, struct CExpression *initializer, enum STORAGE_CLASS storage_class) {
     struct CVarDecl* result = c_vardecl_new(identifier, storage_class);
     result->initializer = initializer;
     return result;
 }
-void c_vardecl_delete(struct CVarDecl* vardecl) {
-    if (!vardecl) return;
-    if (vardecl->initializer) {
-        c_expression_delete(vardecl->initializer);
-    }
-}
 //endregion struct CVarDecl
 
 //region struct CForInit
 struct CForInit* c_for_init_new(enum FOR_INIT_KIND kind) {
-    struct CForInit* result = malloc(sizeof(struct CForInit));
+    struct CForInit* result = ast_alloc(sizeof(struct CForInit));
     result->kind = kind;
     return result;
 }
@@ -505,57 +388,37 @@ struct CForInit* c_for_init_new_expression(struct CExpression* expression)  {
     result->expression = expression;
     return result;
 }
-void c_for_init_delete(struct CForInit* for_init)  {
-    if (!for_init) return;
-    if (for_init->kind == FOR_INIT_DECL) {
-        c_declaration_delete(for_init->declaration);
-    } else if (for_init->kind == FOR_INIT_EXPR) {
-        c_expression_delete(for_init->expression);
-    }
-}
 //endregion
 
 //region struct CBlockItem
 extern struct CBlockItem* c_block_item_new_decl(struct CDeclaration* declaration) {
-    struct CBlockItem* result = malloc(sizeof(struct CBlockItem));
+    struct CBlockItem* result = ast_alloc(sizeof(struct CBlockItem));
     result->kind = AST_BI_DECLARATION;
     result->declaration = declaration;
     return result;
 }
 
 struct CBlockItem* c_block_item_new_stmt(struct CStatement* statement) {
-    struct CBlockItem* result = malloc(sizeof(struct CBlockItem));
+    struct CBlockItem* result = ast_alloc(sizeof(struct CBlockItem));
     result->kind = AST_BI_STATEMENT;
     result->statement = statement;
     return result;
 }
-void c_block_item_delete(struct CBlockItem* blockItem) {
-    if (blockItem == NULL) return;
-    switch (blockItem->kind) {
-        case AST_BI_STATEMENT:
-            c_statement_delete(blockItem->statement);
-            break;
-        case AST_BI_DECLARATION:
-            c_declaration_delete(blockItem->declaration);
-            break;
-    }
-    free(blockItem);
-}
 //endregion CBlockItem
 
 //region struct CFuncDecl
-struct CFuncDecl* c_function_new(const char *name, enum STORAGE_CLASS storage_class) {
-    struct CFuncDecl* result = malloc(sizeof(struct CFuncDecl));
+struct CFuncDecl* c_function_new(uint32_t name, enum STORAGE_CLASS storage_class) {
+    struct CFuncDecl* result = ast_alloc(sizeof(struct CFuncDecl));
     result->storage_class = storage_class;
     result->name = name;
     result->body = NULL;
-    list_of_CIdentifier_init(&result->params, 7);
+    list_of_CIdentifier_init_arena(&result->params, 0, ast_arena);
     return result;
 }
-enum AST_RESULT c_function_add_param(struct CFuncDecl* function, const char* param_name) {
+enum AST_RESULT c_function_add_param(struct CFuncDecl* function, uint32_t param_name) {
     struct CIdentifier* params = function->params.items;
     for (int i = 0; i < function->params.num_items; i++) {
-        if (strcmp(params[i].name, param_name) == 0) {
+        if (params[i].name == param_name) {
             return AST_DUPLICATE;
         }
     }
@@ -568,21 +431,19 @@ enum AST_RESULT c_function_add_body(struct CFuncDecl* function, struct CBlock* b
     function->body = body;
     return AST_OK;
 }
-void c_function_delete(struct CFuncDecl *function) {
-    if (!function) return;
-    // Don't free 'name'; owned by global name table.
-    if (function->body) {
-        c_block_delete(function->body);
-    }
-    list_of_CIdentifier_delete(&function->params);
-    free(function);
-}
 //endregion CFuncDecl
 
 //region CProgram
+/**
+ * Creates a new, empty, program, with the arena that will hold its AST. Nodes created after this
+ * belong to this program.
+ * @return the new program.
+ */
 struct CProgram* c_program_new(void) {
     struct CProgram* result = malloc(sizeof(struct CProgram));
-    list_of_CDeclaration_init(&result->declarations, 57);
+    arena_init(&result->arena, AST_ARENA_BLOCK_SIZE);
+    ast_arena = &result->arena;
+    list_of_CDeclaration_init_arena(&result->declarations, 64, ast_arena);
     return result;
 }
 extern enum AST_RESULT c_program_add_decl(struct CProgram *program, struct CDeclaration *declaration) {
@@ -590,9 +451,39 @@ extern enum AST_RESULT c_program_add_decl(struct CProgram *program, struct CDecl
     return AST_OK;
 }
 
+/**
+ * Deletes a program's declarations, and their AST, keeping the program, and its arena, for the declarations
+ * that follow. Nodes created after this belong to this program.
+ * @param program to be cleared.
+ */
+void c_program_clear(struct CProgram *program) {
+    arena_reset(&program->arena);
+    ast_arena = &program->arena;
+    list_of_CDeclaration_init_arena(&program->declarations, 64, ast_arena);
+}
+
+/**
+ * Prints the memory used by the AST: the number of nodes and lists, and the number of mallocs it took
+ * to hold them, also as a rate per thousand lines of source.
+ * @param program whose AST is to be described.
+ * @param num_lines in the source of the program.
+ */
+void c_program_print_mem(const struct CProgram *program, int num_lines) {
+    const struct arena *arena = &program->arena;
+    double kloc = num_lines > 0 ? num_lines / 1000.0 : 1.0;
+    printf("AST memory: %d lines, %zu allocations (%.1f per KLOC), %zu bytes, %zu mallocs (%.1f per KLOC)\n",
+           num_lines, arena->num_allocs, arena->num_allocs / kloc, arena->num_bytes,
+           arena->num_blocks, arena->num_blocks / kloc);
+}
+
+/**
+ * Deletes a program and its whole AST, in one shot.
+ * @param program to be deleted.
+ */
 void c_program_delete(struct CProgram *program) {
     if (!program) return;
-    list_of_CDeclaration_delete(&program->declarations);
+    if (ast_arena == &program->arena) ast_arena = NULL;
+    arena_release(&program->arena);
     free(program);
 }
 //endregion CProgram
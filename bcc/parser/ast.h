@@ -6,6 +6,7 @@
 #define BCC_AST_H
 #include "../ir/ir.h"
 #include "inc/utils.h"
+#include "inc/strpool.h"
 
 /*
  *  Current AST:
@@ -191,13 +192,14 @@ extern const int AST_TO_IR_BINARY[];
 
 //region struct CIdentifier
 /**
- * Holds the declared name and the uniqufied name for a variable, including labels.
+ * Holds the declared name and the uniqufied name for a variable, including labels. Both are string pool ids.
  */
 struct CIdentifier {
-    const char* name;
-    const char* source_name;
+    uint32_t name;
+    uint32_t source_name;
 };
-LIST_OF_ITEM_DECL(list_of_CIdentifier, struct CIdentifier)
+// A function's parameters; most functions have few enough to keep them in the list itself.
+LIST_OF_ITEM_DECL_SMALL(list_of_CIdentifier, struct CIdentifier, 6)
 //endregion CIdentifier
    
 //region struct CLabel
@@ -212,9 +214,8 @@ struct CExpression;
 extern struct CLabel c_label_new_label(struct CIdentifier identifier);
 extern struct CLabel c_label_new_switch_default();
 extern struct CLabel c_label_new_switch_case(struct CExpression *expr);
-extern void c_label_delete(struct CLabel label);
 
-LIST_OF_ITEM_DECL(list_of_CLabel, struct CLabel)
+LIST_OF_ITEM_DECL_SMALL(list_of_CLabel, struct CLabel, 2)
 //endregion struct CLabel
 
 //region struct CExpression
@@ -264,13 +265,11 @@ extern struct CExpression* c_expression_new_assign(struct CExpression* src, stru
 extern struct CExpression* c_expression_new_binop(enum AST_BINARY_OP op, struct CExpression* left, struct CExpression* right);
 extern struct CExpression* c_expression_new_conditional(struct CExpression* left_exp, struct CExpression* middle_exp, struct CExpression* right_exp);
 extern struct CExpression* c_expression_new_const(enum AST_CONST_TYPE const_type, int int_val);
-extern struct CExpression* c_expression_new_function_call(struct CIdentifier func);
+extern struct CExpression* c_expression_new_function_call(struct CIdentifier func, struct CExpression** args, int num_args);
 extern struct CExpression* c_expression_new_increment(enum AST_INCREMENT_OP op, struct CExpression* operand);
 extern struct CExpression* c_expression_new_unop(enum AST_UNARY_OP op, struct CExpression* operand);
-extern struct CExpression* c_expression_new_var(const char* name);
-extern void c_expression_function_call_add_arg(struct CExpression* call_expr, struct CExpression* arg);
+extern struct CExpression* c_expression_new_var(uint32_t name);
 extern struct CExpression* c_expression_clone(const struct CExpression* expression);
-extern void c_expression_delete(struct CExpression* expression);
 //endregion CExpression
 
 //region struct CDeclaration
@@ -283,7 +282,6 @@ struct CDeclaration {
 };
 extern struct CDeclaration* c_declaration_new_var(struct CVarDecl* vardecl);
 extern struct CDeclaration* c_declaration_new_func(struct CFuncDecl* funcdecl);
-extern void c_declaration_delete(struct CDeclaration* declaration);
 LIST_OF_ITEM_DECL(list_of_CDeclaration,struct CDeclaration*)
 //endregion CDeclaration
 
@@ -293,9 +291,8 @@ struct CVarDecl {
     struct CIdentifier var;
     struct CExpression* initializer;
 };
-extern struct CVarDecl* c_vardecl_new(const char* identifier, enum STORAGE_CLASS storage_class);
-extern struct CVarDecl* c_vardecl_new_init(const char* identifier, struct CExpression* initializer, enum STORAGE_CLASS storage_class);
-extern void c_vardecl_delete(struct CVarDecl* vardecl);
+extern struct CVarDecl* c_vardecl_new(uint32_t identifier, enum STORAGE_CLASS storage_class);
+extern struct CVarDecl* c_vardecl_new_init(uint32_t identifier, struct CExpression* initializer, enum STORAGE_CLASS storage_class);
 //endregion CVarDecl
 
 //region struct CForInit
@@ -308,7 +305,6 @@ struct CForInit {
 };
 extern struct CForInit* c_for_init_new_vardecl(struct CDeclaration *declaration);
 extern struct CForInit* c_for_init_new_expression(struct CExpression* expression);
-extern void c_for_init_delete(struct CForInit* for_init);
 //endregion  CForInit
 
 //region struct CBlockItem
@@ -322,8 +318,6 @@ struct CBlockItem {
 extern struct CBlockItem* c_block_item_new_decl(struct CDeclaration* declaration);
 
 extern struct CBlockItem* c_block_item_new_stmt(struct CStatement* statement);
-extern void c_block_item_delete(struct CBlockItem* blockItem);
-extern void CBlockItem_delete(struct CBlockItem* blockItem);  // actually used in c_blockitem_helpers
 // Implementation of List<CBlockItem> (?list_of_CBlockItem")
 LIST_OF_ITEM_DECL(list_of_CBlockItem, struct CBlockItem*)
 //endregion CBlockItem
@@ -333,9 +327,7 @@ struct CBlock {
     struct list_of_CBlockItem items;
     int is_function_block;
 };
-extern struct CBlock* c_block_new(int is_function);
-extern void c_block_append_item(struct CBlock* block, struct CBlockItem* item);
-extern void c_block_delete(struct CBlock* block);
+extern struct CBlock* c_block_new(int is_function, struct CBlockItem** items, int num_items);
 //endregion CBlock
 
 //region struct CStatement
@@ -386,35 +378,36 @@ extern struct CStatement* c_statement_new_return(struct CExpression* expression)
 extern struct CStatement* c_statement_new_switch(struct CExpression* expression, struct CStatement* body);
 extern struct CStatement* c_statement_new_while(struct CExpression* condition, struct CStatement* body);
 extern int c_statement_has_labels(const struct CStatement* statement);
-extern void c_statement_add_labels(struct CStatement* pStatement, struct list_of_CLabel labels);
+extern void c_statement_add_labels(struct CStatement* pStatement, struct CLabel *labels, int num_labels);
 extern struct CLabel* c_statement_get_labels(const struct CStatement* statement);
 extern int c_statement_num_labels(const struct CStatement* statement);
 extern enum AST_RESULT c_statement_set_flow_id(struct CStatement* statement, int flow_id);
 extern enum AST_RESULT c_statement_set_switch_has_default(struct CStatement* statement);
 extern enum AST_RESULT c_statement_register_switch_case(struct CStatement* statement, int case_value);
-extern void c_statement_delete(struct CStatement* statement);
 //endregion CStatement
 
 //region struct CFuncDecl
 struct CFuncDecl {
     enum STORAGE_CLASS storage_class;
-    const char* name;
+    uint32_t name;
     struct CBlock* body;
     struct list_of_CIdentifier params;
 };
 LIST_OF_ITEM_DECL(list_of_CFuncDecl, struct CFuncDecl*)
-extern struct CFuncDecl* c_function_new(const char* name, enum STORAGE_CLASS storage_class);
-extern enum AST_RESULT c_function_add_param(struct CFuncDecl* function, const char* param_name);
+extern struct CFuncDecl* c_function_new(uint32_t name, enum STORAGE_CLASS storage_class);
+extern enum AST_RESULT c_function_add_param(struct CFuncDecl* function, uint32_t param_name);
 extern enum AST_RESULT c_function_add_body(struct CFuncDecl* function, struct CBlock* body);
-extern void c_function_delete(struct CFuncDecl* function);
 //endregion CFuncDecl
 
 //region struct CProgram
 struct CProgram {
     struct list_of_CDeclaration declarations;
+    struct arena arena;     // Owns every node of the program's AST.
 };
 extern struct CProgram* c_program_new(void);
 extern enum AST_RESULT c_program_add_decl(struct CProgram *program, struct CDeclaration *declaration);
+extern void c_program_clear(struct CProgram *program);
+extern void c_program_print_mem(const struct CProgram *program, int num_lines);
 
 extern void c_program_delete(struct CProgram* program);
 //endregion CProgram
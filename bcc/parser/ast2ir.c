@@ -10,27 +10,134 @@
 #include "idtable.h"
 #include "inc/constant.h"
 
-static void tmp_vars_init(void);
-
 static void convert_symbols_to_ir(struct IrProgram *program);
 static struct IrFunction *compile_function(const struct CFuncDecl *cFunction);
-static void compile_block(const struct list_of_CBlockItem *block, struct IrFunction *irFunction);
+static void compile_body(const struct list_of_CBlockItem *body, struct IrFunction *function);
+static void push_block_items(const struct list_of_CBlockItem *block);
 static void compile_vardecl(const struct CDeclaration *declaration, struct IrFunction *function);
 
 static void compile_statement(const struct CStatement *statement, struct IrFunction *function);
+static void compile_if(const struct CStatement *if_statement, struct IrFunction *function);
+static void compile_loop_end(const struct CStatement *statement, struct IrFunction *function);
+static void compile_labels(const struct CStatement *statement, struct IrFunction *function);
 
 struct IrValue compile_expression(struct CExpression *cExpression, struct IrFunction *irFunction);
 
-static struct IrValue make_temporary(const struct IrFunction *function);
+static struct IrValue make_var(struct IrFunction *function, uint32_t name);
+static struct IrValue make_temporary(struct IrFunction *function);
+static struct IrValue make_decl_label(struct IrFunction *function, uint32_t name);
 
-static void make_conditional_labels(const struct IrFunction *function, struct IrValue *t, struct IrValue *f,
+static void make_conditional_labels(struct IrFunction *function, struct IrValue *t, struct IrValue *f,
                                     struct IrValue *e);
-static void make_loop_labels (const struct IrFunction *function, int flow_id, struct IrValue *s, struct IrValue *b, struct IrValue *c);
-static void make_case_label(const struct IrFunction *function, int flow_id, int case_id, struct IrValue *label);
-static void make_default_label(const struct IrFunction *function, int flow_id, struct IrValue *label);
+static void make_loop_labels (struct IrFunction *function, int flow_id, struct IrValue *s, struct IrValue *b, struct IrValue *c);
+static void make_case_label(struct IrFunction *function, int flow_id, int case_id, struct IrValue *label);
+static void make_default_label(struct IrFunction *function, int flow_id, struct IrValue *label);
+
+/*
+ * While a function is compiled, the index of each of its named variables, by name, and of each of its labels
+ * that may be referred to more than once (source labels, and those of loops and switches), by description.
+ */
+struct var_index_item {
+    uint32_t name;
+    int var;
+};
+static inline unsigned long var_index_item_hash(struct var_index_item item) {
+    return item.name * 2654435761u;
+}
+static inline int var_index_item_cmp(struct var_index_item l, struct var_index_item r) {
+    return (l.name > r.name) - (l.name < r.name);
+}
+static inline int var_index_item_is_null(struct var_index_item item) {
+    return item.name == 0;
+}
+SET_OF_ITEM_DECL(set_of_var_index, struct var_index_item)
+SET_OF_ITEM_DEFN_STATIC(set_of_var_index, struct var_index_item, var_index_item_hash, var_index_item_cmp,
+                        SET_OF_NO_DUP, SET_OF_NO_DELETE, var_index_item_is_null)
+
+struct label_index_item {
+    struct IrLabel label;
+    int index;
+};
+static inline unsigned long label_index_item_hash(struct label_index_item item) {
+    return ((item.label.name * 31u + item.label.id) * 31u + item.label.case_value) * 31u + item.label.kind;
+}
+static inline int label_index_item_cmp(struct label_index_item l, struct label_index_item r) {
+    if (l.label.kind != r.label.kind) return l.label.kind < r.label.kind ? -1 : 1;
+    if (l.label.name != r.label.name) return l.label.name < r.label.name ? -1 : 1;
+    if (l.label.id != r.label.id) return l.label.id < r.label.id ? -1 : 1;
+    return (l.label.case_value > r.label.case_value) - (l.label.case_value < r.label.case_value);
+}
+static inline int label_index_item_is_null(struct label_index_item item) {
+    return item.label.kind == IR_LABEL_DECL && item.label.name == 0;
+}
+SET_OF_ITEM_DECL(set_of_label_index, struct label_index_item)
+SET_OF_ITEM_DEFN_STATIC(set_of_label_index, struct label_index_item, label_index_item_hash, label_index_item_cmp,
+                        SET_OF_NO_DUP, SET_OF_NO_DELETE, label_index_item_is_null)
+
+static struct set_of_var_index var_index;
+static struct set_of_label_index label_index;
+
+/*
+ * An expression being compiled by compile_expression(), its state (how many of its operands have been
+ * compiled), and what it must remember between its operands: its result, and the labels it jumps to.
+ */
+struct CompileFrame {
+    struct CExpression *exp;
+    int state;
+    struct IrValue dst;
+    struct IrValue label;
+    struct IrValue end_label;
+};
+LIST_OF_ITEM_DECL(list_of_compile_frame, struct CompileFrame)
+LIST_OF_ITEM_DEFN_STATIC(list_of_compile_frame, struct CompileFrame, LIST_OF_NO_DELETE)
+static struct list_of_compile_frame compile_frames;
+// The values of compiled operands, not yet taken by their expressions.
+static struct list_of_IrValue compile_values;
+
+/*
+ * Statements are compiled from a work stack rather than by recursion, so that no nesting of blocks, ifs, or
+ * loops can exhaust the C stack. A statement emits what comes before its body, then pushes what comes after
+ * its body, then the body itself, so that the body is compiled first:
+ * - WORK_STATEMENT:   a statement,
+ * - WORK_DECLARATION: a block-scope declaration,
+ * - WORK_LABEL:       a label to be emitted, such as the end of an if,
+ * - WORK_JUMP:        a jump to a label, such as from the end of an if's then to its end,
+ * - WORK_LOOP_END:    the rest of a loop or switch, after its body.
+ */
+enum COMPILE_WORK_KIND {
+    WORK_STATEMENT,
+    WORK_DECLARATION,
+    WORK_LABEL,
+    WORK_JUMP,
+    WORK_LOOP_END,
+};
+struct CompileWork {
+    enum COMPILE_WORK_KIND kind;
+    union {
+        const struct CStatement *statement;     // WORK_STATEMENT, WORK_LOOP_END
+        const struct CDeclaration *declaration; // WORK_DECLARATION
+        struct IrValue label;                   // WORK_LABEL, WORK_JUMP
+    };
+};
+LIST_OF_ITEM_DECL(list_of_compile_work, struct CompileWork)
+LIST_OF_ITEM_DEFN_STATIC(list_of_compile_work, struct CompileWork, LIST_OF_NO_DELETE)
+static struct list_of_compile_work compile_work;
+
+static void initialize_ast2ir(void) {
+    static int initialized = 0;
+    if (!initialized) {
+        list_of_compile_frame_init(&compile_frames, 64);
+        list_of_IrValue_init(&compile_values, 64);
+        list_of_compile_work_init(&compile_work, 64);
+        initialized = 1;
+    }
+}
+
+static void push_compile_frame(struct CExpression *exp) {
+    list_of_compile_frame_append(&compile_frames, (struct CompileFrame){.exp = exp});
+}
 
 struct IrProgram *ast2ir(const struct CProgram *cProgram) {
-    tmp_vars_init();
     struct IrProgram *program = ir_program_new();
     struct IrFunction* function;
     for (int ix = 0; ix < cProgram->declarations.num_items; ix++) {
@@ -51,6 +158,26 @@ struct IrProgram *ast2ir(const struct CProgram *cProgram) {
     return program;
 }
 
+/**
+ * Compiles one function, for compiling a program a function at a time.
+ * @param cFunction the analyzed function.
+ * @return the IR of the function, or NULL if it is only a declaration.
+ */
+struct IrFunction *ast2ir_function(const struct CFuncDecl *cFunction) {
+    return compile_function(cFunction);
+}
+
+/**
+ * Compiles the static variables of a program from the symbol table, once every declaration of the
+ * program has been analyzed.
+ * @return a program with just the static variables.
+ */
+struct IrProgram *ast2ir_static_vars(void) {
+    struct IrProgram *program = ir_program_new();
+    convert_symbols_to_ir(program);
+    return program;
+}
+
 void convert_symbols_to_ir(struct IrProgram *program) {
     struct Symbol *pSymbol;
     for (int ix=0; ix<get_num_symbols(); ix++) {
@@ -77,22 +204,63 @@ void convert_symbols_to_ir(struct IrProgram *program) {
 
 }
 
-static void compile_block(const struct list_of_CBlockItem *block, struct IrFunction *irFunction) {
-    for (int ix = 0; ix < block->num_items; ix++) {
+static void push_compile_work(struct CompileWork work) {
+    list_of_compile_work_append(&compile_work, work);
+}
+
+static void push_statement(const struct CStatement *statement) {
+    push_compile_work((struct CompileWork){.kind = WORK_STATEMENT, .statement = statement});
+}
+
+// Pushes the items of a block, last first, so that they are compiled in order.
+static void push_block_items(const struct list_of_CBlockItem *block) {
+    for (int ix = block->num_items - 1; ix >= 0; ix--) {
         struct CBlockItem *bi = block->items[ix];
-        switch (bi->kind) {
-            case AST_BI_STATEMENT:
-                compile_statement(bi->statement, irFunction);
+        if (bi->kind == AST_BI_STATEMENT) {
+            push_statement(bi->statement);
+        } else {
+            push_compile_work((struct CompileWork){.kind = WORK_DECLARATION, .declaration = bi->declaration});
+        }
+    }
+}
+
+static void compile_declaration(const struct CDeclaration *declaration, struct IrFunction *function) {
+    switch (declaration->decl_kind) {
+        case FUNC_DECL:
+            compile_function(declaration->func);
+            break;
+        case VAR_DECL:
+            compile_vardecl(declaration, function);
+            break;
+    }
+}
+
+/**
+ * Compiles the body of a function, taking its statements and declarations, and what remains to be emitted
+ * after each loop and if, from the work stack until it is back where it started.
+ * @param body of the function.
+ * @param function receiving the instructions.
+ */
+static void compile_body(const struct list_of_CBlockItem *body, struct IrFunction *function) {
+    int base = compile_work.num_items;
+    push_block_items(body);
+    while (compile_work.num_items > base) {
+        struct CompileWork work = list_of_compile_work_pop(&compile_work);
+        switch (work.kind) {
+            case WORK_STATEMENT:
+                compile_statement(work.statement, function);
                 break;
-            case AST_BI_DECLARATION:
-                switch (bi->declaration->decl_kind) {
-                    case FUNC_DECL:
-                        compile_function(bi->declaration->func);
-                        break;
-                    case VAR_DECL:
-                        compile_vardecl(bi->declaration, irFunction);
-                        break;
-                }
+            case WORK_DECLARATION:
+                compile_declaration(work.declaration, function);
+                break;
+            case WORK_LABEL:
+                ir_function_append_instruction(function, ir_instruction_new_label(work.label));
+                break;
+            case WORK_JUMP:
+                ir_function_append_instruction(function, ir_instruction_new_jump(work.label));
+                break;
+            case WORK_LOOP_END:
+                compile_loop_end(work.statement, function);
                 break;
         }
     }
@@ -104,19 +272,26 @@ struct IrFunction *compile_function(const struct CFuncDecl *cFunction) {
     bool global = false;
     struct Symbol symbol;
     if (find_symbol_by_name(cFunction->name, &symbol) != SYMTAB_OK) {
-        failf("Function '%s' is not defined.", cFunction->name);
+        failf("Function '%s' is not defined.", strpool_str(cFunction->name));
     }
     global = SYMBOL_IS_GLOBAL(symbol.attrs);
     struct IrFunction *function = ir_function_new(cFunction->name, global);
+    initialize_ast2ir();
+    set_of_var_index_init(&var_index, 16);
+    set_of_label_index_init(&label_index, 16);
     for (int ix = 0; ix < cFunction->params.num_items; ix++) {
-        IrFunction_add_param(function, cFunction->params.items[ix].name);
+        IrFunction_add_param(function, make_var(function, cFunction->params.items[ix].name).var);
     }
-    compile_block(&cFunction->body->items, function);
+    compile_body(&cFunction->body->items, function);
 
     // Add return instruction, in case the source didn't include one.
     struct IrValue zero = ir_value_new_int(0);
-    struct IrInstruction* inst = ir_instruction_new_ret(zero);
+    struct IrInstruction inst = ir_instruction_new_ret(zero);
     ir_function_append_instruction(function, inst);
+    // The body is complete; give back the unused part of its last growth.
+    list_of_IrInstruction_shrink_to_fit(&function->body);
+    set_of_var_index_delete(&var_index);
+    set_of_label_index_delete(&label_index);
 
     return function;
 }
@@ -129,8 +304,8 @@ void compile_vardecl(const struct CDeclaration *declaration, struct IrFunction *
     if (vardecl->storage_class == SC_EXTERN || vardecl->storage_class == SC_STATIC) {
         return; // extern and static handled later.
     }
-    struct IrValue var = ir_value_new_id(vardecl->var.name);
-    struct IrInstruction *inst = ir_instruction_new_var(var);
+    struct IrValue var = make_var(function, vardecl->var.name);
+    struct IrInstruction inst = ir_instruction_new_var(var);
     ir_function_append_instruction(function, inst);
     if (vardecl->initializer) {
         struct IrValue initializer = compile_expression(vardecl->initializer, function);
@@ -139,27 +314,24 @@ void compile_vardecl(const struct CDeclaration *declaration, struct IrFunction *
     }
 }
 
+// Pushes the body of a loop or switch, to be compiled before the rest of the statement.
+static void push_loop_body(const struct CStatement *statement, const struct CStatement *body) {
+    push_compile_work((struct CompileWork){.kind = WORK_LOOP_END, .statement = statement});
+    push_statement(body);
+}
+
 static void compile_do_while(const struct CStatement *do_statement, struct IrFunction *function) {
     struct IrValue start_label;
     struct IrValue break_label;
     struct IrValue continue_label;
+    // All of the loop's labels are made here, before its body's, though only the start label is used yet.
     make_loop_labels(function, do_statement->flow_id, &start_label, &break_label, &continue_label);
 
     // emit start label
-    struct IrInstruction *inst = ir_instruction_new_label(start_label);
-    ir_function_append_instruction(function, inst);
-    // emit body
-    compile_statement(do_statement->while_or_do_statement.body, function);
-    // emit continue label
-    inst = ir_instruction_new_label(continue_label);
-    ir_function_append_instruction(function, inst);
-    // emit condition and jnz
-    struct IrValue condition = compile_expression(do_statement->while_or_do_statement.condition, function);
-    inst = ir_instruction_new_jumpnz(condition, start_label);
-    ir_function_append_instruction(function, inst);
-    // emit break label
-    inst = ir_instruction_new_label(break_label);
+    struct IrInstruction inst = ir_instruction_new_label(start_label);
     ir_function_append_instruction(function, inst);
+    // emit body, then the rest
+    push_loop_body(do_statement, do_statement->while_or_do_statement.body);
 }
 
 static void compile_while(const struct CStatement *while_statement, struct IrFunction *function) {
@@ -168,20 +340,14 @@ static void compile_while(const struct CStatement *while_statement, struct IrFun
     make_loop_labels(function, while_statement->flow_id, NULL, &break_label, &continue_label);
 
     // emit continue label(also the start label)
-    struct IrInstruction *inst = ir_instruction_new_label(continue_label);
+    struct IrInstruction inst = ir_instruction_new_label(continue_label);
     ir_function_append_instruction(function, inst);
     // emit condition and jz
     struct IrValue condition = compile_expression(while_statement->while_or_do_statement.condition, function);
     inst = ir_instruction_new_jumpz(condition, break_label);
     ir_function_append_instruction(function, inst);
-    // emit body
-    compile_statement(while_statement->while_or_do_statement.body, function);
-    // jump back to start, ie, continue
-    inst = ir_instruction_new_jump(continue_label);
-    ir_function_append_instruction(function, inst);
-    // emit break label
-    inst = ir_instruction_new_label(break_label);
-    ir_function_append_instruction(function, inst);
+    // emit body, then the rest
+    push_loop_body(while_statement, while_statement->while_or_do_statement.body);
 }
 
 static void compile_for(const struct CStatement *for_statement, struct IrFunction *function) {
@@ -201,7 +367,7 @@ static void compile_for(const struct CStatement *for_statement, struct IrFunctio
         }
     }
     // emit start label
-    struct IrInstruction *inst = ir_instruction_new_label(start_label);
+    struct IrInstruction inst = ir_instruction_new_label(start_label);
     ir_function_append_instruction(function, inst);
     // emit condition and "jz break", if present
     if (for_statement->for_statement.condition) {
@@ -209,24 +375,12 @@ static void compile_for(const struct CStatement *for_statement, struct IrFunctio
         inst = ir_instruction_new_jumpz(condition, break_label);
         ir_function_append_instruction(function, inst);
     }
-    // body
-    compile_statement(for_statement->for_statement.body, function);
-    // emit continue label
-    inst = ir_instruction_new_label(continue_label);
-    ir_function_append_instruction(function, inst);
-    // post, if present
-    if (for_statement->for_statement.post) {
-        compile_expression(for_statement->for_statement.post, function);
-    }
-    inst = ir_instruction_new_jump(start_label);
-    ir_function_append_instruction(function, inst);
-    // emit break label
-    inst = ir_instruction_new_label(break_label);
-    ir_function_append_instruction(function, inst);
+    // body, then the rest
+    push_loop_body(for_statement, for_statement->for_statement.body);
 }
 
 static void compile_switch(const struct CStatement *switch_statement, struct IrFunction *function) {
-    struct IrInstruction* inst;
+    struct IrInstruction inst;
     struct IrValue break_label;
     struct IrValue label;
     make_loop_labels(function, switch_statement->flow_id, NULL, &break_label, NULL);
@@ -251,16 +405,64 @@ static void compile_switch(const struct CStatement *switch_statement, struct IrF
     inst = ir_instruction_new_jump(label);
     ir_function_append_instruction(function, inst);
 
-    // emit body
-    compile_statement(switch_statement->switch_statement.body, function);
-    // emit break label (which is also the "default" label, if there's no statement labelled "default:"
+    // emit body, then the break label
+    push_loop_body(switch_statement, switch_statement->switch_statement.body);
+}
+
+/**
+ * Emits what follows the body of a loop or switch: for a loop, its continue label and its way back to the
+ * start, then the break label (which, for a switch, is also the "default" label, if there's no statement
+ * labelled "default:").
+ * @param statement the loop or switch, whose body has been compiled.
+ * @param function receiving the instructions.
+ */
+static void compile_loop_end(const struct CStatement *statement, struct IrFunction *function) {
+    struct IrInstruction inst;
+    struct IrValue start_label;
+    struct IrValue break_label;
+    struct IrValue continue_label;
+    struct IrValue condition;
+    switch (statement->kind) {
+        case STMT_DOWHILE:
+            make_loop_labels(function, statement->flow_id, &start_label, &break_label, &continue_label);
+            // emit continue label
+            inst = ir_instruction_new_label(continue_label);
+            ir_function_append_instruction(function, inst);
+            // emit condition and jnz
+            condition = compile_expression(statement->while_or_do_statement.condition, function);
+            inst = ir_instruction_new_jumpnz(condition, start_label);
+            ir_function_append_instruction(function, inst);
+            break;
+        case STMT_WHILE:
+            make_loop_labels(function, statement->flow_id, NULL, &break_label, &continue_label);
+            // jump back to start, ie, continue
+            inst = ir_instruction_new_jump(continue_label);
+            ir_function_append_instruction(function, inst);
+            break;
+        case STMT_FOR:
+            make_loop_labels(function, statement->flow_id, &start_label, &break_label, &continue_label);
+            // emit continue label
+            inst = ir_instruction_new_label(continue_label);
+            ir_function_append_instruction(function, inst);
+            // post, if present
+            if (statement->for_statement.post) {
+                compile_expression(statement->for_statement.post, function);
+            }
+            inst = ir_instruction_new_jump(start_label);
+            ir_function_append_instruction(function, inst);
+            break;
+        default:
+            make_loop_labels(function, statement->flow_id, NULL, &break_label, NULL);
+            break;
+    }
+    // emit break label
     inst = ir_instruction_new_label(break_label);
     ir_function_append_instruction(function, inst);
 }
 
 static void compile_labels(const struct CStatement *statement, struct IrFunction *function) {
     if (!c_statement_has_labels(statement)) return;
-    struct IrInstruction *inst;
+    struct IrInstruction inst;
     struct IrValue label;
     int num_labels = c_statement_num_labels(statement);
     struct CLabel *labels = c_statement_get_labels(statement);
@@ -275,21 +477,48 @@ static void compile_labels(const struct CStatement *statement, struct IrFunction
             inst = ir_instruction_new_label(label);
             ir_function_append_instruction(function, inst);
         } else if (labels[i].kind == LABEL_DECL) {
-            label = ir_value_new_label(labels[i].identifier.name);
+            label = make_decl_label(function, labels[i].identifier.name);
             inst = ir_instruction_new_label(label);
             ir_function_append_instruction(function, inst);
         }
     }
 }
 
-void compile_statement(const struct CStatement *statement, struct IrFunction *function) {
-    struct IrValue src;
-    struct IrValue condition;
-    struct IrInstruction *inst;
-    struct IrValue label;
+/**
+ * Emits the condition of an if statement, and pushes its then and else statements with the jump and labels
+ * around them. Each if of an else-if ladder is compiled in turn from the work stack, so a ladder doesn't
+ * recurse; the end labels are emitted after the last else, innermost first.
+ * @param if_statement whose own labels have been emitted.
+ * @param function receiving the instructions.
+ */
+static void compile_if(const struct CStatement *if_statement, struct IrFunction *function) {
     struct IrValue else_label;
     struct IrValue end_label;
-    int has_else;
+    int has_else = if_statement->if_statement.else_statement != NULL;
+    make_conditional_labels(function, NULL, has_else ? &else_label : NULL, &end_label);
+    // Condition
+    struct IrValue condition = compile_expression(if_statement->if_statement.condition, function);
+    struct IrInstruction inst = ir_instruction_new_jumpz(condition, has_else ? else_label : end_label);
+    ir_function_append_instruction(function, inst);
+    // Then statement, then "jmp end", the else label, and the else statement, if any, then the end label.
+    push_compile_work((struct CompileWork){.kind = WORK_LABEL, .label = end_label});
+    if (has_else) {
+        push_statement(if_statement->if_statement.else_statement);
+        push_compile_work((struct CompileWork){.kind = WORK_LABEL, .label = else_label});
+        push_compile_work((struct CompileWork){.kind = WORK_JUMP, .label = end_label});
+    }
+    push_statement(if_statement->if_statement.then_statement);
+}
+
+/**
+ * Compiles a statement, up to any statements it encloses, which are pushed to be compiled next.
+ * @param statement to be compiled.
+ * @param function receiving the instructions.
+ */
+static void compile_statement(const struct CStatement *statement, struct IrFunction *function) {
+    struct IrValue src;
+    struct IrInstruction inst;
+    struct IrValue label;
 
     // Emit any labels that target this statement.
     compile_labels(statement, function);
@@ -308,33 +537,15 @@ void compile_statement(const struct CStatement *statement, struct IrFunction *fu
         case STMT_NULL:
             break;
         case STMT_IF:
-            has_else = statement->if_statement.else_statement != NULL;
-            make_conditional_labels(function, NULL, has_else ? &else_label : NULL, &end_label);
-        // Condition
-            condition = compile_expression(statement->if_statement.condition, function);
-            inst = ir_instruction_new_jumpz(condition, has_else ? else_label : end_label);
-            ir_function_append_instruction(function, inst);
-        // Then statement
-            compile_statement(statement->if_statement.then_statement, function);
-            if (has_else) {
-                inst = ir_instruction_new_jump(end_label);
-                ir_function_append_instruction(function, inst);
-                // Else statement
-                inst = ir_instruction_new_label(else_label);
-                ir_function_append_instruction(function, inst);
-                compile_statement(statement->if_statement.else_statement, function);
-            }
-        // end
-            inst = ir_instruction_new_label(end_label);
-            ir_function_append_instruction(function, inst);
+            compile_if(statement, function);
             break;
         case STMT_GOTO:
-            label = ir_value_new_label(statement->goto_statement.label->var.name);
+            label = make_decl_label(function, statement->goto_statement.label->var.name);
             inst = ir_instruction_new_jump(label);
             ir_function_append_instruction(function, inst);
             break;
         case STMT_COMPOUND:
-            compile_block(&statement->compound->items, function);
+            push_block_items(&statement->compound->items);
             break;
         case STMT_BREAK:
             make_loop_labels(function, statement->flow_id, NULL, &label, NULL);
@@ -364,259 +575,347 @@ void compile_statement(const struct CStatement *statement, struct IrFunction *fu
 /**
  * Emits IR instructions to evaluate the given expression. Returns an IrValue containing the location
  * of where the computed result is stored.
+ *
+ * The expression is walked with an explicit stack of frames rather than by recursion, so that no expression,
+ * however deep, can exhaust the C stack. Each frame's state is the number of its operands compiled so far;
+ * the value of each compiled operand is left on compile_values, for its parent to take.
+ *
  * @param cExpression An AST expression to be evaluated.
  * @param irFunction The IrFunction in which the expression appears, and which will receive the instructions
  *      to evaluate the expression.
  * @return An IrValue with the location of where the computed int_value is stored.
  */
 struct IrValue compile_expression(struct CExpression *cExpression, struct IrFunction *irFunction) {
-    // NOLINT(*-no-recursion)
     struct IrValue src;
     struct IrValue src2;
-    struct IrValue dst = {};
+    struct IrValue dst;
     struct IrValue tmp;
-    struct IrValue target;
+    uint32_t target;
     struct IrValue condition;
-    struct IrValue false_label;
-    struct IrValue true_label;
-    struct IrValue end_label;
-    struct IrInstruction *inst;
+    struct IrInstruction inst;
     enum IR_UNARY_OP unary_op;
     enum IR_BINARY_OP binary_op;
     struct list_of_IrValue arg_list;
-    switch (cExpression->kind) {
-        case AST_EXP_CONST:
-            switch (cExpression->literal.type) {
-                case AST_CONST_INT:
-                    return ir_value_new_int(cExpression->literal.int_val);
-            }
-            break;
-        case AST_EXP_UNOP:
-            unary_op = AST_TO_IR_UNARY[cExpression->unary.op];
-            src = compile_expression(cExpression->unary.operand, irFunction);
-            dst = make_temporary(irFunction);
-            inst = ir_instruction_new_unary(unary_op, src, dst);
-            ir_function_append_instruction(irFunction, inst);
-            return dst;
-        case AST_EXP_BINOP:
-            switch (cExpression->binop.op) {
-                case AST_BINARY_MULTIPLY:
-                case AST_BINARY_DIVIDE:
-                case AST_BINARY_REMAINDER:
-                case AST_BINARY_ADD:
-                case AST_BINARY_SUBTRACT:
-                case AST_BINARY_OR:
-                case AST_BINARY_AND:
-                case AST_BINARY_XOR:
-                case AST_BINARY_LSHIFT:
-                case AST_BINARY_RSHIFT:
-                case AST_BINARY_LT:
-                case AST_BINARY_LE:
-                case AST_BINARY_GT:
-                case AST_BINARY_GE:
-                case AST_BINARY_EQ:
-                case AST_BINARY_NE:
-                    binary_op = AST_TO_IR_BINARY[cExpression->binop.op];
-                    src = compile_expression(cExpression->binop.left, irFunction);
-                    src2 = compile_expression(cExpression->binop.right, irFunction);
-                    dst = make_temporary(irFunction);
-                    inst = ir_instruction_new_binary(binary_op, src, src2, dst);
-                    ir_function_append_instruction(irFunction, inst);
-                    return dst;
-                case AST_BINARY_L_AND:
-                    dst = make_temporary(irFunction);
-                    make_conditional_labels(irFunction, NULL, &false_label, &end_label);
-                // Evaluate left-hand side of && and, if false, jump to false_label.
-                    src = compile_expression(cExpression->binop.left, irFunction);
-                    inst = ir_instruction_new_jumpz(src, false_label);
-                    ir_function_append_instruction(irFunction, inst);
-                // Otherwise, evaluate right-hand side of && and, if false, jump to false_label.
-                    src2 = compile_expression(cExpression->binop.right, irFunction);
-                    inst = ir_instruction_new_jumpz(src2, false_label);
-                    ir_function_append_instruction(irFunction, inst);
-                // Not false, so result is 1, then jump to end label.
-                    inst = ir_instruction_new_copy(ir_value_new_int(1), dst);
-                    ir_function_append_instruction(irFunction, inst);
-                    inst = ir_instruction_new_jump(end_label);
-                    ir_function_append_instruction(irFunction, inst);
-                // False, result is 0
-                    inst = ir_instruction_new_label(false_label);
-                    ir_function_append_instruction(irFunction, inst);
-                    inst = ir_instruction_new_copy(ir_value_new_int(0), dst);
-                    ir_function_append_instruction(irFunction, inst);
-                // End label
-                    inst = ir_instruction_new_label(end_label);
-                    ir_function_append_instruction(irFunction, inst);
-                    break;
-                case AST_BINARY_L_OR:
-                    dst = make_temporary(irFunction);
-                    make_conditional_labels(irFunction, &true_label, NULL, &end_label);
-                // Evaluate left-hand side of || and, if true, jump to true_label.
-                    src = compile_expression(cExpression->binop.left, irFunction);
-                    inst = ir_instruction_new_jumpnz(src, true_label);
-                    ir_function_append_instruction(irFunction, inst);
-                // Otherwise, evaluate right-hand side of || and, if true, jump to true_label.
-                    src2 = compile_expression(cExpression->binop.right, irFunction);
-                    inst = ir_instruction_new_jumpnz(src2, true_label);
-                    ir_function_append_instruction(irFunction, inst);
-                // Not true, so result is 0, then jump to end label.
-                    inst = ir_instruction_new_copy(ir_value_new_int(0), dst);
-                    ir_function_append_instruction(irFunction, inst);
-                    inst = ir_instruction_new_jump(end_label);
-                    ir_function_append_instruction(irFunction, inst);
-                // True, result is 1
-                    inst = ir_instruction_new_label(true_label);
-                    ir_function_append_instruction(irFunction, inst);
-                    inst = ir_instruction_new_copy(ir_value_new_int(1), dst);
-                    ir_function_append_instruction(irFunction, inst);
-                // End label
-                    inst = ir_instruction_new_label(end_label);
-                    ir_function_append_instruction(irFunction, inst);
-                    break;
-                case AST_BINARY_ASSIGN:
-                // This branch is only here to make the compiler happy.
-                case AST_BINARY_QUESTION:
-                    // Same.
-                    break;
-            }
-            break;
-        case AST_EXP_VAR:
-            src = ir_value_new_id(cExpression->var.name);
-//            inst = ir_instruction_new_var(src);
-//            ir_function_append_instruction(irFunction, inst);
-            dst = src;
-            break;
-        case AST_EXP_ASSIGNMENT:
-            src = compile_expression(cExpression->assign.src, irFunction);
-            dst = compile_expression(cExpression->assign.dst, irFunction);
-            inst = ir_instruction_new_copy(src, dst);
-            ir_function_append_instruction(irFunction, inst);
-            break;
-        case AST_EXP_INCREMENT:
-            switch (cExpression->increment.op) {
-                case AST_PRE_INCR:
-                case AST_PRE_DECR:
-                    binary_op = (cExpression->increment.op == AST_PRE_INCR) ? IR_BINARY_ADD : IR_BINARY_SUBTRACT;
-                    src = compile_expression(cExpression->increment.operand, irFunction);
-                    tmp = make_temporary(irFunction);
-                    inst = ir_instruction_new_binary(binary_op, src, ir_value_new_int(1), tmp);
-                    ir_function_append_instruction(irFunction, inst);
-                    inst = ir_instruction_new_copy(tmp, src);
+    int num_args;
+    int base = compile_frames.num_items;
+    push_compile_frame(cExpression);
+    while (compile_frames.num_items > base) {
+        struct CompileFrame *frame = &compile_frames.items[compile_frames.num_items - 1];
+        cExpression = frame->exp;
+        int state = frame->state++;
+        dst = (struct IrValue){};
+        switch (cExpression->kind) {
+            case AST_EXP_CONST:
+                switch (cExpression->literal.type) {
+                    case AST_CONST_INT:
+                        dst = ir_value_new_int(cExpression->literal.int_val);
+                        break;
+                }
+                break;
+            case AST_EXP_UNOP:
+                if (state == 0) {
+                    push_compile_frame(cExpression->unary.operand);
+                    continue;
+                }
+                unary_op = AST_TO_IR_UNARY[cExpression->unary.op];
+                src = list_of_IrValue_pop(&compile_values);
+                dst = make_temporary(irFunction);
+                inst = ir_instruction_new_unary(unary_op, src, dst);
+                ir_function_append_instruction(irFunction, inst);
+                break;
+            case AST_EXP_BINOP:
+                switch (cExpression->binop.op) {
+                    case AST_BINARY_MULTIPLY:
+                    case AST_BINARY_DIVIDE:
+                    case AST_BINARY_REMAINDER:
+                    case AST_BINARY_ADD:
+                    case AST_BINARY_SUBTRACT:
+                    case AST_BINARY_OR:
+                    case AST_BINARY_AND:
+                    case AST_BINARY_XOR:
+                    case AST_BINARY_LSHIFT:
+                    case AST_BINARY_RSHIFT:
+                    case AST_BINARY_LT:
+                    case AST_BINARY_LE:
+                    case AST_BINARY_GT:
+                    case AST_BINARY_GE:
+                    case AST_BINARY_EQ:
+                    case AST_BINARY_NE:
+                        if (state < 2) {
+                            push_compile_frame(state == 0 ? cExpression->binop.left : cExpression->binop.right);
+                            continue;
+                        }
+                        binary_op = AST_TO_IR_BINARY[cExpression->binop.op];
+                        src2 = list_of_IrValue_pop(&compile_values);
+                        src = list_of_IrValue_pop(&compile_values);
+                        dst = make_temporary(irFunction);
+                        inst = ir_instruction_new_binary(binary_op, src, src2, dst);
+                        ir_function_append_instruction(irFunction, inst);
+                        break;
+                    case AST_BINARY_L_AND:
+                        if (state == 0) {
+                            frame->dst = make_temporary(irFunction);
+                            make_conditional_labels(irFunction, NULL, &frame->label, &frame->end_label);
+                        // Evaluate left-hand side of && and, if false, jump to false_label.
+                            push_compile_frame(cExpression->binop.left);
+                            continue;
+                        }
+                        if (state == 1) {
+                            src = list_of_IrValue_pop(&compile_values);
+                            inst = ir_instruction_new_jumpz(src, frame->label);
+                            ir_function_append_instruction(irFunction, inst);
+                        // Otherwise, evaluate right-hand side of && and, if false, jump to false_label.
+                            push_compile_frame(cExpression->binop.right);
+                            continue;
+                        }
+                        src2 = list_of_IrValue_pop(&compile_values);
+                        inst = ir_instruction_new_jumpz(src2, frame->label);
+                        ir_function_append_instruction(irFunction, inst);
+                    // Not false, so result is 1, then jump to end label.
+                        dst = frame->dst;
+                        inst = ir_instruction_new_copy(ir_value_new_int(1), dst);
+                        ir_function_append_instruction(irFunction, inst);
+                        inst = ir_instruction_new_jump(frame->end_label);
+                        ir_function_append_instruction(irFunction, inst);
+                    // False, result is 0
+                        inst = ir_instruction_new_label(frame->label);
+                        ir_function_append_instruction(irFunction, inst);
+                        inst = ir_instruction_new_copy(ir_value_new_int(0), dst);
+                        ir_function_append_instruction(irFunction, inst);
+                    // End label
+                        inst = ir_instruction_new_label(frame->end_label);
+                        ir_function_append_instruction(irFunction, inst);
+                        break;
+                    case AST_BINARY_L_OR:
+                        if (state == 0) {
+                            frame->dst = make_temporary(irFunction);
+                            make_conditional_labels(irFunction, &frame->label, NULL, &frame->end_label);
+                        // Evaluate left-hand side of || and, if true, jump to true_label.
+                            push_compile_frame(cExpression->binop.left);
+                            continue;
+                        }
+                        if (state == 1) {
+                            src = list_of_IrValue_pop(&compile_values);
+                            inst = ir_instruction_new_jumpnz(src, frame->label);
+                            ir_function_append_instruction(irFunction, inst);
+                        // Otherwise, evaluate right-hand side of || and, if true, jump to true_label.
+                            push_compile_frame(cExpression->binop.right);
+                            continue;
+                        }
+                        src2 = list_of_IrValue_pop(&compile_values);
+                        inst = ir_instruction_new_jumpnz(src2, frame->label);
+                        ir_function_append_instruction(irFunction, inst);
+                    // Not true, so result is 0, then jump to end label.
+                        dst = frame->dst;
+                        inst = ir_instruction_new_copy(ir_value_new_int(0), dst);
+                        ir_function_append_instruction(irFunction, inst);
+                        inst = ir_instruction_new_jump(frame->end_label);
+                        ir_function_append_instruction(irFunction, inst);
+                    // True, result is 1
+                        inst = ir_instruction_new_label(frame->label);
+                        ir_function_append_instruction(irFunction, inst);
+                        inst = ir_instruction_new_copy(ir_value_new_int(1), dst);
+                        ir_function_append_instruction(irFunction, inst);
+                    // End label
+                        inst = ir_instruction_new_label(frame->end_label);
+                        ir_function_append_instruction(irFunction, inst);
+                        break;
+                    case AST_BINARY_ASSIGN:
+                    // This branch is only here to make the compiler happy.
+                    case AST_BINARY_QUESTION:
+                        // Same.
+                        break;
+                }
+                break;
+            case AST_EXP_VAR:
+                dst = make_var(irFunction, cExpression->var.name);
+                break;
+            case AST_EXP_ASSIGNMENT:
+                if (state < 2) {
+                    push_compile_frame(state == 0 ? cExpression->assign.src : cExpression->assign.dst);
+                    continue;
+                }
+                dst = list_of_IrValue_pop(&compile_values);
+                src = list_of_IrValue_pop(&compile_values);
+                inst = ir_instruction_new_copy(src, dst);
+                ir_function_append_instruction(irFunction, inst);
+                break;
+            case AST_EXP_INCREMENT:
+                switch (cExpression->increment.op) {
+                    case AST_PRE_INCR:
+                    case AST_PRE_DECR:
+                        if (state == 0) {
+                            push_compile_frame(cExpression->increment.operand);
+                            continue;
+                        }
+                        binary_op = (cExpression->increment.op == AST_PRE_INCR) ? IR_BINARY_ADD : IR_BINARY_SUBTRACT;
+                        src = list_of_IrValue_pop(&compile_values);
+                        tmp = make_temporary(irFunction);
+                        inst = ir_instruction_new_binary(binary_op, src, ir_value_new_int(1), tmp);
+                        ir_function_append_instruction(irFunction, inst);
+                        inst = ir_instruction_new_copy(tmp, src);
+                        ir_function_append_instruction(irFunction, inst);
+                        dst = src;
+                        break;
+                    case AST_POST_INCR:
+                    case AST_POST_DECR:
+                        if (state == 0) {
+                            frame->dst = make_temporary(irFunction);
+                            push_compile_frame(cExpression->increment.operand);
+                            continue;
+                        }
+                        binary_op = (cExpression->increment.op == AST_POST_INCR) ? IR_BINARY_ADD : IR_BINARY_SUBTRACT;
+                        dst = frame->dst;
+                        src = list_of_IrValue_pop(&compile_values);
+                        inst = ir_instruction_new_copy(src, dst);
+                        ir_function_append_instruction(irFunction, inst);
+                        tmp = make_temporary(irFunction);
+                        inst = ir_instruction_new_binary(binary_op, src, ir_value_new_int(1), tmp);
+                        ir_function_append_instruction(irFunction, inst);
+                        inst = ir_instruction_new_copy(tmp, src);
+                        ir_function_append_instruction(irFunction, inst);
+                        break;
+                }
+                break;
+            case AST_EXP_CONDITIONAL:
+                if (state == 0) {
+                    make_conditional_labels(irFunction, NULL, &frame->label, &frame->end_label);
+                    frame->dst = make_temporary(irFunction);
+                // Condition ("left") expression
+                    push_compile_frame(cExpression->conditional.left_exp);
+                    continue;
+                }
+                if (state == 1) {
+                    condition = list_of_IrValue_pop(&compile_values);
+                    inst = ir_instruction_new_jumpz(condition, frame->label);
                     ir_function_append_instruction(irFunction, inst);
-                    dst = src;
-                    break;
-                case AST_POST_INCR:
-                case AST_POST_DECR:
-                    binary_op = (cExpression->increment.op == AST_POST_INCR) ? IR_BINARY_ADD : IR_BINARY_SUBTRACT;
-                    dst = make_temporary(irFunction);
-                    src = compile_expression(cExpression->increment.operand, irFunction);
-                    inst = ir_instruction_new_copy(src, dst);
+                // True ("middle") expression
+                    push_compile_frame(cExpression->conditional.middle_exp);
+                    continue;
+                }
+                if (state == 2) {
+                    tmp = list_of_IrValue_pop(&compile_values);
+                    inst = ir_instruction_new_copy(tmp, frame->dst);
                     ir_function_append_instruction(irFunction, inst);
-                    tmp = make_temporary(irFunction);
-                    inst = ir_instruction_new_binary(binary_op, src, ir_value_new_int(1), tmp);
+                    inst = ir_instruction_new_jump(frame->end_label);
                     ir_function_append_instruction(irFunction, inst);
-                    inst = ir_instruction_new_copy(tmp, src);
+                // False ("right") expression
+                    inst = ir_instruction_new_label(frame->label);
                     ir_function_append_instruction(irFunction, inst);
-                    break;
-            }
-            break;
-        case AST_EXP_CONDITIONAL:
-            make_conditional_labels(irFunction, NULL, &false_label, &end_label);
-            dst = make_temporary(irFunction);
-        // Condition ("left") expression
-            condition = compile_expression(cExpression->conditional.left_exp, irFunction);
-            inst = ir_instruction_new_jumpz(condition, false_label);
-            ir_function_append_instruction(irFunction, inst);
-        // True ("middle") expression
-            tmp = compile_expression(cExpression->conditional.middle_exp, irFunction);
-            inst = ir_instruction_new_copy(tmp, dst);
-            ir_function_append_instruction(irFunction, inst);
-            inst = ir_instruction_new_jump(end_label);
-            ir_function_append_instruction(irFunction, inst);
-        // False ("right") expression
-            inst = ir_instruction_new_label(false_label);
-            ir_function_append_instruction(irFunction, inst);
-            tmp = compile_expression(cExpression->conditional.right_exp, irFunction);
-            inst = ir_instruction_new_copy(tmp, dst);
-            ir_function_append_instruction(irFunction, inst);
-        // exit
-            inst = ir_instruction_new_label(end_label);
-            ir_function_append_instruction(irFunction, inst);
-            break;
-        case AST_EXP_FUNCTION_CALL:
-            dst = make_temporary(irFunction);
-            target = ir_value_new_id(cExpression->function_call.func.name);
-            list_of_IrValue_init(&arg_list, cExpression->function_call.args.num_items);
-            for (int i=0; i<cExpression->function_call.args.num_items; ++i) {
-                struct CExpression *arg = cExpression->function_call.args.items[i];
-                struct IrValue arg_val = compile_expression(arg, irFunction);
-                list_of_IrValue_append(&arg_list, arg_val);
-            }
-            inst = ir_instruction_new_funcall(target, &arg_list, dst);
-            ir_function_append_instruction(irFunction, inst);
-            list_of_IrValue_delete(&arg_list);
-            break;
+                    push_compile_frame(cExpression->conditional.right_exp);
+                    continue;
+                }
+                dst = frame->dst;
+                tmp = list_of_IrValue_pop(&compile_values);
+                inst = ir_instruction_new_copy(tmp, dst);
+                ir_function_append_instruction(irFunction, inst);
+            // exit
+                inst = ir_instruction_new_label(frame->end_label);
+                ir_function_append_instruction(irFunction, inst);
+                break;
+            case AST_EXP_FUNCTION_CALL:
+                num_args = cExpression->function_call.args.num_items;
+                if (state == 0) {
+                    frame->dst = make_temporary(irFunction);
+                }
+                if (state < num_args) {
+                    push_compile_frame(cExpression->function_call.args.items[state]);
+                    continue;
+                }
+                dst = frame->dst;
+                target = cExpression->function_call.func.name;
+                list_of_IrValue_init(&arg_list, num_args);
+                for (int i = compile_values.num_items - num_args; i < compile_values.num_items; ++i) {
+                    list_of_IrValue_append(&arg_list, compile_values.items[i]);
+                }
+                compile_values.num_items -= num_args;
+                inst = ir_instruction_new_funcall(target, ir_function_add_call_args(irFunction, &arg_list),
+                                                  arg_list.num_items, dst);
+                ir_function_append_instruction(irFunction, inst);
+                list_of_IrValue_delete(&arg_list);
+                break;
+        }
+        // The expression is compiled; hand its value to the enclosing one.
+        --compile_frames.num_items;
+        list_of_IrValue_append(&compile_values, dst);
     }
-    return dst;
+    return list_of_IrValue_pop(&compile_values);
 }
 
 /** //////////////////////////////////////////////////////////////////////////////
 //
-// Temporary variables. Temporary variables have unique, non-c names, and
-// global, permanent scope.
-//
-// TODO: Maybe we can delete a function's temporaries after the function if
-//      completely compiled.
+// Variables and labels. Each is an index into its function's vars or labels,
+// dense from 0. Temporaries and generated labels aren't named until they are
+// printed or emitted.
 */
-static const char *tmp_vars_insert(const char *str);
+static struct IrValue make_var(struct IrFunction *function, uint32_t name) {
+    struct var_index_item key = {.name = name};
+    struct var_index_item *found = set_of_var_index_lookup(&var_index, key);
+    if (!found) {
+        // First use in this function; decide, once, where the variable lives.
+        struct Symbol symbol;
+        enum IR_VAR_STORAGE storage = IR_VAR_LOCAL;
+        if (find_symbol_by_name(name, &symbol) == SYMTAB_OK && SYMBOL_IS_STATIC_VAR(symbol.attrs)) {
+            storage = IR_VAR_STATIC;
+        }
+        key.var = ir_function_new_var(function, name, storage);
+        found = &key;
+        set_of_var_index_insert(&var_index, key);
+    }
+    return ir_value_new_var(found->var);
+}
 
-static struct IrValue make_temporary(const struct IrFunction *function) {
-    const char *name_buf = uniquify_name("%.100s.tmp.%d", function->name);
-    const char *tmp_name = tmp_vars_insert(name_buf);
-    struct IrValue result = ir_value_new_id(tmp_name);
-    return result;
+static struct IrValue make_temporary(struct IrFunction *function) {
+    return ir_value_new_var(ir_function_new_var(function, 0, IR_VAR_TEMPORARY));
 }
 
-static void make_unique_label(const char *context, const char *tag, int uniquifier, struct IrValue *label) {
-    if (!label) return;
-    char name_buf[120];
-    sprintf(name_buf, "%.100s.%s.%d", context, tag, uniquifier);
-    const char *tmp_name = tmp_vars_insert(name_buf);
-    *label = ir_value_new_label(tmp_name);
+// The label with the given description, the same one each time it is asked for.
+static struct IrValue find_or_make_label(struct IrFunction *function, struct IrLabel label) {
+    struct label_index_item key = {.label = label};
+    struct label_index_item *found = set_of_label_index_lookup(&label_index, key);
+    if (!found) {
+        key.index = ir_function_new_label(function, label);
+        found = &key;
+        set_of_label_index_insert(&label_index, key);
+    }
+    return ir_value_new_label(found->index);
 }
 
-static void make_conditional_labels(const struct IrFunction *function, struct IrValue *t, struct IrValue *f, struct IrValue *e) {
-    int uniquifier = next_uniquifier();
-    make_unique_label(function->name, "true", uniquifier, t);
-    make_unique_label(function->name, "false", uniquifier, f);
-    make_unique_label(function->name, "end", uniquifier, e);
+static struct IrValue make_decl_label(struct IrFunction *function, uint32_t name) {
+    struct IrLabel label = {.kind = IR_LABEL_DECL, .name = name};
+    return find_or_make_label(function, label);
 }
-static void make_loop_labels (const struct IrFunction *function, int flow_id, struct IrValue *s, struct IrValue *b, struct IrValue *c) {
-    make_unique_label(function->name, "start", flow_id, s);
-    make_unique_label(function->name, "break", flow_id, b);
-    make_unique_label(function->name, "continue", flow_id, c);
+
+static void make_conditional_labels(struct IrFunction *function, struct IrValue *t, struct IrValue *f, struct IrValue *e) {
+    // The labels of one conditional share a number, unique in the function.
+    struct IrLabel label = {.id = function->labels.num_items};
+    if (t) {
+        label.kind = IR_LABEL_TRUE;
+        *t = ir_value_new_label(ir_function_new_label(function, label));
+    }
+    if (f) {
+        label.kind = IR_LABEL_FALSE;
+        *f = ir_value_new_label(ir_function_new_label(function, label));
+    }
+    if (e) {
+        label.kind = IR_LABEL_END;
+        *e = ir_value_new_label(ir_function_new_label(function, label));
+    }
 }
-static void make_case_label(const struct IrFunction *function, int flow_id, int case_id, struct IrValue *label) {
-    char name_buf[120];
-    sprintf(name_buf, "%.100s.switch.%d.case.%d", function->name, flow_id, case_id);
-    const char *tmp_name = tmp_vars_insert(name_buf);
-    *label = ir_value_new_label(tmp_name);
+static void make_loop_label(struct IrFunction *function, enum IR_LABEL_KIND kind, int flow_id, struct IrValue *label) {
+    if (!label) return;
+    struct IrLabel key = {.kind = kind, .id = flow_id};
+    *label = find_or_make_label(function, key);
 }
-static void make_default_label(const struct IrFunction *function, int flow_id, struct IrValue *label) {
-    char name_buf[120];
-    sprintf(name_buf, "%.100s.switch.%d.default", function->name, flow_id);
-    const char *tmp_name = tmp_vars_insert(name_buf);
-    *label = ir_value_new_label(tmp_name);
+static void make_loop_labels (struct IrFunction *function, int flow_id, struct IrValue *s, struct IrValue *b, struct IrValue *c) {
+    make_loop_label(function, IR_LABEL_START, flow_id, s);
+    make_loop_label(function, IR_LABEL_BREAK, flow_id, b);
+    make_loop_label(function, IR_LABEL_CONTINUE, flow_id, c);
 }
-
-struct set_of_str tmp_vars;
-/**
- * Initialize the set of token_text strings.
- */
-void tmp_vars_init(void) {
-    set_of_str_init(&tmp_vars, 101);
+static void make_case_label(struct IrFunction *function, int flow_id, int case_id, struct IrValue *label) {
+    struct IrLabel key = {.kind = IR_LABEL_CASE, .id = flow_id, .case_value = case_id};
+    *label = find_or_make_label(function, key);
 }
-
-const char *tmp_vars_insert(const char *str) {
-    return set_of_str_insert(&tmp_vars, str);
+static void make_default_label(struct IrFunction *function, int flow_id, struct IrValue *label) {
+    make_loop_label(function, IR_LABEL_DEFAULT, flow_id, label);
 }
@@ -9,5 +9,7 @@
 #include "../ir/ir.h"
 
 extern struct IrProgram *ast2ir(const struct CProgram *cProgram);
+extern struct IrFunction *ast2ir_function(const struct CFuncDecl *cFunction);
+extern struct IrProgram *ast2ir_static_vars(void);
 
 #endif //BCC_AST2IR_H
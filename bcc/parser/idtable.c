@@ -10,14 +10,17 @@
  *
  * Both the original (source) name and the uniquified, decorated name are saved, making it possible to query
  * "What is the uniquified name for this source name, in the current scope?" The semantic analysis uses
- * push_id_context() and pop_id_context() as it enters and leaves lexical scopes. Symbol lookup starts in
- * the current scope, and examines successive enclosing scopes until the symbol is found, or the search
- * is not found in the global scope.
+ * push_id_context() and pop_id_context() as it enters and leaves lexical scopes.
+ *
+ * All scopes share one hash table, which holds the innermost visible declaration of each name, so a lookup
+ * is a single probe however deeply the scopes are nested. Declaring a name that shadows one from an
+ * enclosing scope saves the shadowed declaration on an undo log; popping a scope replays the log back to
+ * where the scope began, restoring shadowed declarations and removing the scope's own. So a push costs
+ * nothing, and a pop costs only the names declared in the scope.
  *
  * Labels are scoped differently in two ways. First, there are no global labels; all labels are within a
- * function definition. Then the entire function is the scope of the label. Therefore, only a single table
- * is needed for label resolution. When semantic analysis calls push_id_context() upon starting the analysis
- * of a function, the new context is remembered, and labels are added to and looked up in that context.
+ * function definition. Then the entire function is the scope of the label. Labels therefore never shadow
+ * one another; they are kept in the same table, and removed when the function's context is popped.
  *
  */
 
@@ -29,7 +32,9 @@
 #include "symtable.h"
 #include "inc/utils.h"
 #include "inc/set_of.h"
+#include "inc/strpool.h"
 #include "../utils/startup.h"
+#include "../utils/trace.h"
 
 /**
  * Entries in the id table.
@@ -37,82 +42,59 @@
  * has_linkage: function, file-scope variable, or extern variable.
  * source_name: the name of the variable, function, function parameter, or label, as given in the source
  * mapped_name: the uniquified name of a local variable, parameter, or label
+ * depth:       the depth of the scope of the declaration; 0 is file scope.
+ * Both names are string pool ids. The key is kind and source_name.
  */
 struct identifier_item {
     enum IDENTIFIER_KIND kind;
     bool has_linkage;
-    const char* source_name;
-    const char* mapped_name;
+    uint32_t source_name;
+    uint32_t mapped_name;
+    int depth;
 };
-unsigned long identifier_item_hash(struct identifier_item item) {
-    return hash_str(item.source_name) + item.kind;
-}
-int identifier_item_cmp(struct identifier_item l, struct identifier_item r) {
-    if (l.kind < r.kind) return -1;
-    else if (l.kind > r.kind) return 1;
-    return strcmp(l.source_name, r.source_name);
+static inline unsigned long identifier_item_hash(struct identifier_item item) {
+    return item.source_name * 2654435761u + item.kind;
 }
-#pragma clang diagnostic push
-#pragma ide diagnostic ignored "UnusedParameter"
-void identifier_item_delete(struct identifier_item item) {
-#pragma clang diagnostic pop
-    // Don't do anything because the struct doesn't own the strings.
+static inline int identifier_item_cmp(struct identifier_item l, struct identifier_item r) {
+    if (l.kind != r.kind) return l.kind < r.kind ? -1 : 1;
+    if (l.source_name != r.source_name) return l.source_name < r.source_name ? -1 : 1;
+    return 0;
 }
-struct identifier_item identifier_item_dup(struct identifier_item item) {
-    return item;
-}
-int identifier_item_is_null(struct identifier_item item) {
-    return item.source_name == NULL;
+static inline int identifier_item_is_null(struct identifier_item item) {
+    return item.source_name == 0;
 }
 
 /*
- * Declare a set of identifier_item, keyed by source_name and kind.
+ * Declare a set of identifier_item, keyed by source_name and kind. The items don't own their names (they are
+ * string pool ids), so there is nothing to copy or to free.
  */
 SET_OF_ITEM_DECL(set_of_identifier_item, struct identifier_item)
-SET_OF_ITEM_DEFN(set_of_identifier_item, struct identifier_item)
-struct set_of_identifier_item_helpers set_of_identifier_item_helpers = {
-        .hash = identifier_item_hash,
-        .cmp = identifier_item_cmp,
-        .dup = identifier_item_dup,
-        .delete = identifier_item_delete,
-        .null = {},
-        .is_null = identifier_item_is_null
-};
-
-/*
- * A scoped identifier table. 'prev' points to any containing scope. 'push_id_context' allocates
- * a new one of these, and links it to the previous one.
- */
-struct identifier_table {
-    struct identifier_table* prev;
-    struct set_of_identifier_item ids;
-};
-// Allocate and initialize an identifier table.
-static struct identifier_table* identifier_table_new(struct identifier_table* prev) {
-    struct identifier_table* table = malloc(sizeof(struct identifier_table));
-    table->prev = prev;
-    set_of_identifier_item_init(&table->ids, 5);
-    return table;
-}
-// Clean up and free an identifier table.
-void identifier_table_delete(struct identifier_table* table) {
-    set_of_identifier_item_delete(&table->ids);
-    free(table);
-}
-
-// The complete, segmented symbol table, as a linked list. Each prev-> is a containing scope.
-struct identifier_table* identifier_table = NULL;
-struct identifier_table* function_identifier_table = NULL;
-
-// This holds long-lifetime strings, for the mapped (uniquified) variable names, like "a.0".
-struct set_of_str mapped_vars;
+SET_OF_ITEM_DEFN_STATIC(set_of_identifier_item, struct identifier_item, identifier_item_hash, identifier_item_cmp,
+                        SET_OF_NO_DUP, SET_OF_NO_DELETE, identifier_item_is_null)
+LIST_OF_ITEM_DECL(list_of_identifier_item, struct identifier_item)
+LIST_OF_ITEM_DEFN_STATIC(list_of_identifier_item, struct identifier_item, LIST_OF_NO_DELETE)
+
+// The innermost visible declaration of every name.
+static struct set_of_identifier_item identifiers;
+// For every declaration in an open scope, in order, what it replaced in 'identifiers': the shadowed
+// declaration, or, with a mapped_name of 0, just the key of a name that had none.
+static struct list_of_identifier_item undo_log;
+// For every open scope, the length of undo_log when the scope was pushed.
+static struct list_of_int scope_marks;
+// The labels of the current function, to be removed with the function's context.
+static struct list_of_identifier_item function_labels;
+// The depth of the current scope, and of the current function's scope (-1 outside of a function).
+static int scope_depth = 0;
+static int function_depth = -1;
 
 /**
- * Initialize the identifier table.
+ * Initialize the identifier table, with only the file scope open.
  */
 void idtable_init() {
-    identifier_table = identifier_table_new(NULL);
-    set_of_str_init(&mapped_vars, 101);
+    set_of_identifier_item_init(&identifiers, 1024);
+    list_of_identifier_item_init(&undo_log, 256);
+    list_of_int_init(&scope_marks, 0);
+    list_of_identifier_item_init(&function_labels, 0);
 }
 
 static const char* tag_for(enum IDENTIFIER_KIND kind) {
@@ -124,17 +106,6 @@ static const char* tag_for(enum IDENTIFIER_KIND kind) {
         assert("Unknown identifier kind" && 0);
 }
 
-static struct set_of_identifier_item* id_set_for(enum IDENTIFIER_KIND kind) {
-    if (kind == IDENTIFIER_ID) {
-        assert(identifier_table != NULL);
-        return &identifier_table->ids;
-    } else if (kind == IDENTIFIER_LABEL) {
-        assert(function_identifier_table != NULL);
-        return &function_identifier_table->ids;
-    } else
-        assert("Unknown identifier kind" && 0);
-}
-
 /**
  * Adds an identifier to the identifier table. Only checks for duplicates in the current id scope (function
  * for labels, block for other ids).
@@ -145,112 +116,117 @@ static struct set_of_identifier_item* id_set_for(enum IDENTIFIER_KIND kind) {
  * @return The uniquified name. It is a syntax error if the item already exists without linkage. If the
  *      item exists with linkage, the existing name is returned.
  */
-const char *add_identifier(enum IDENTIFIER_KIND kind, const char *source_name, bool has_linkage) {
+uint32_t add_identifier(enum IDENTIFIER_KIND kind, uint32_t source_name, bool has_linkage) {
     const char* tag = tag_for(kind);
-    struct set_of_identifier_item* table = id_set_for(kind);
-    // The key for find()
+    assert(kind != IDENTIFIER_LABEL || function_depth >= 0);
+    // The key for lookup()
     struct identifier_item item = {
             .kind = kind,
             .has_linkage = (bool)has_linkage,
             .source_name = source_name,
+            .depth = kind == IDENTIFIER_LABEL ? function_depth : scope_depth,
     };
-    struct identifier_item found = {0};
-    int was_found = set_of_identifier_item_find(table, item, &found);
-    if (was_found) {
-        if (has_linkage && found.has_linkage) {
+    struct identifier_item* found = set_of_identifier_item_lookup(&identifiers, item);
+    // Labels are only ever in the table for the current function.
+    if (found && (kind == IDENTIFIER_LABEL || found->depth == scope_depth)) {
+        if (has_linkage && found->has_linkage) {
             // Duplicate declaration of extern symbol is OK.
-            return found.mapped_name;
+            return found->mapped_name;
         }
         // Was found; duplicate declaration.
-        failf("Duplicate %s: \"%s\"\n", tag, source_name);
+        failf("Duplicate %s: \"%s\"\n", tag, strpool_str(source_name));
     }
-    const char* name_buf;
+    uint32_t mapped_name;
     if (has_linkage) {
         // Don't decorate externs; they're named the same everywhere.
-        name_buf = source_name;
+        mapped_name = source_name;
     } else {
-        // name_buf points to a shared buffer after this call.
-        name_buf = uniquify_name("%.100s.%d", source_name);
-        // Add to global string pool. Returns the long-lifetime copy.
-        name_buf = set_of_str_insert(&mapped_vars, name_buf);
-        if (traceResolution) {
-            printf("assigning %s for %s %s\n", name_buf, tag, source_name);
-        }
+        // Add to global string pool.
+        mapped_name = strpool_intern(uniquify_name("%.100s.%d", strpool_str(source_name)));
+        TRACE(TRACE_RESOLUTION, "assigning %s for %s %s\n", strpool_str(mapped_name), tag, strpool_str(source_name));
+    }
+    // save the mapping, and how to undo it.
+    item.mapped_name = mapped_name;
+    if (kind == IDENTIFIER_LABEL) {
+        list_of_identifier_item_append(&function_labels, item);
+        set_of_identifier_item_insert(&identifiers, item);
+    } else if (found) {
+        // Shadows a declaration from an enclosing scope.
+        list_of_identifier_item_append(&undo_log, *found);
+        *found = item;
+    } else {
+        struct identifier_item key = item;
+        key.mapped_name = 0;
+        list_of_identifier_item_append(&undo_log, key);
+        set_of_identifier_item_insert(&identifiers, item);
     }
-    // save the mapping.
-    item.mapped_name = name_buf;
-    set_of_identifier_item_insert(table, item);
     // return the uniquified name
-    return name_buf;
+    return mapped_name;
 }
 
-const char *lookup_identifier(enum IDENTIFIER_KIND kind, const char *source_name, bool *pHas_linkage, bool *pCurrent_scope) {
-    struct identifier_table* table = identifier_table;
-    struct set_of_identifier_item* id_set = id_set_for(kind);
-    // The key for find()
+uint32_t lookup_identifier(enum IDENTIFIER_KIND kind, uint32_t source_name, bool *pHas_linkage, bool *pCurrent_scope) {
+    // The key for lookup()
     struct identifier_item item = {
             .kind = kind,
             .source_name = source_name,
     };
-    // Look in local scope, then walk global-wards if not found.
-    do {
-        // Result, if found.
-        struct identifier_item found;
-        int was_found = set_of_identifier_item_find(id_set, item, &found);
-        if (was_found) {
-            // Found it; return mapped name.
-            if (pHas_linkage) {
-                *pHas_linkage = (int)found.has_linkage;
-            }
-            if (pCurrent_scope) {
-                *pCurrent_scope = table == identifier_table;
-            }
-            return found.mapped_name;
-        }
-        // Not found, look in containing scope.
-        table = table->prev;
-        if (table) {
-            id_set = &table->ids;
-        }
-    } while (table != NULL);
-    return NULL;
-
+    struct identifier_item* found = set_of_identifier_item_lookup(&identifiers, item);
+    if (!found) return 0;
+    if (pHas_linkage) {
+        *pHas_linkage = (int)found->has_linkage;
+    }
+    if (pCurrent_scope) {
+        *pCurrent_scope = kind == IDENTIFIER_LABEL || found->depth == scope_depth;
+    }
+    return found->mapped_name;
 }
 
 /**
  * Called by the semantic analysis when beginning a new scope (ie, a function, a compound statement, a for statement).
- * A new symbol table segment is allocated and linked to the previous segment.
+ * Marks where the new scope's declarations begin on the undo log.
  *
- * If the new context is for a function, the new context is saved so that labels can be added and looked up in the
+ * If the new context is for a function, its depth is saved so that labels can be added and looked up in the
  * scope of the entire function.
  *
  * @param is_function_context If the new context is for a function, should be true, otherwise false.
  */
 void push_id_context(int is_function_context) {
-    printf("push_id_context: %s function context\n", is_function_context?"":"not ");
-    identifier_table = identifier_table_new(identifier_table);
+    TRACE(TRACE_SCOPES, "push_id_context: %s function context\n", is_function_context?"":"not ");
+    list_of_int_append(&scope_marks, undo_log.num_items);
+    ++scope_depth;
     if (is_function_context) {
-        function_identifier_table = identifier_table;
+        function_depth = scope_depth;
     }
 }
 
 /**
  * Called by the semantic analysis when processing of a scope is complete, and the context is no longer needed.
- * If the context being popped is the function-scope context, semantic analysis is done with the function, and
- * the function-scope context is no longer needed.
+ * Undoes the scope's declarations, newest first. If the context being popped is the function-scope context,
+ * semantic analysis is done with the function, and the function's labels are removed too.
  */
 void pop_id_context(void) {
-    printf("pop_id_context\n");
-    struct identifier_table* old = identifier_table;
-    identifier_table = old->prev;
-    identifier_table_delete(old);
-    if (old == function_identifier_table) {
-        function_identifier_table = NULL;
+    TRACE(TRACE_SCOPES, "pop_id_context\n");
+    assert(scope_depth > 0);
+    int mark = list_of_int_pop(&scope_marks);
+    while (undo_log.num_items > mark) {
+        struct identifier_item previous = list_of_identifier_item_pop(&undo_log);
+        if (previous.mapped_name == 0) {
+            set_of_identifier_item_remove(&identifiers, previous);
+        } else {
+            *set_of_identifier_item_lookup(&identifiers, previous) = previous;
+        }
+    }
+    if (scope_depth == function_depth) {
+        while (function_labels.num_items > 0) {
+            set_of_identifier_item_remove(&identifiers, list_of_identifier_item_pop(&function_labels));
+        }
+        function_depth = -1;
     }
+    --scope_depth;
 }
 
 const char* uniquify_name(const char* fmt, const char* name) {
-    static char name_buf[120];
+    static _Thread_local char name_buf[120];
     sprintf(name_buf, fmt, name, next_uniquifier());
     return name_buf;
 }
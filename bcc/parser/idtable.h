@@ -15,8 +15,8 @@ enum IDENTIFIER_KIND {
 
 extern void idtable_init(void);
 
-extern const char *add_identifier(enum IDENTIFIER_KIND kind, const char *source_name, bool has_linkage);
-extern const char *lookup_identifier(enum IDENTIFIER_KIND kind, const char *source_name, bool *pHas_linkage, bool *pCurrent_scope);
+extern uint32_t add_identifier(enum IDENTIFIER_KIND kind, uint32_t source_name, bool has_linkage);
+extern uint32_t lookup_identifier(enum IDENTIFIER_KIND kind, uint32_t source_name, bool *pHas_linkage, bool *pCurrent_scope);
 
 extern void push_id_context(int is_function_context);
 extern void pop_id_context(void);
@@ -27,8 +27,8 @@ extern void pop_id_context(void);
  * @param fmt The format to use to create the unique symbol. Should contain a "%s",
  *          a "%d", and a '.'. May also contain fixed text, eg.: "%s.tmp.%d".
  * @param context A string to help make the resulting string human readable (and understandable).
- * @return A pointer to the generated string. NOTE: the generated string is in a global buffer,
-*           and will ony be valid until the next call to uniquify_name().
+ * @return A pointer to the generated string. NOTE: the generated string is in a per-thread buffer,
+*           and will ony be valid until the thread's next call to uniquify_name().
 */
 extern const char* uniquify_name(const char* fmt, const char* context);
 
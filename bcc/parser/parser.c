@@ -4,6 +4,7 @@
 // Created by Bill Evans on 8/28/24.
 //
 
+#include <assert.h>
 #include <stdlib.h>
 #include "ast.h"
 #include "parser.h"
@@ -16,15 +17,7 @@
 
 // List of un-owned strings ("persistent strings" aka "pstr")
 LIST_OF_ITEM_DECL(list_of_pstr, const char*)
-#pragma clang diagnostic push
-#pragma ide diagnostic ignored "UnusedParameter"
-void no_op(const char * x) {}
-#pragma clang diagnostic pop
-struct list_of_pstr_helpers list_of_pstr_helpers = {
-        .delete = no_op,
-        .null = NULL,
-};
-LIST_OF_ITEM_DEFN(list_of_pstr,const char*)
+LIST_OF_ITEM_DEFN_STATIC(list_of_pstr,const char*,LIST_OF_NO_DELETE)
 
 static struct CProgram * parse_program(void);
 static struct CDeclaration *parse_declaration(void);
@@ -34,33 +27,151 @@ static struct CBlockItem* parse_block_item(void);
 static struct CVarDecl *parse_vardecl(struct Token idToken, enum STORAGE_CLASS sc, int type);
 static struct CStatement * parse_statement(void);
 static struct CExpression * parse_expression(int minimum_precedence);
-static struct CExpression * parse_factor(void);
 
 static struct Token expect(enum TK expected);
 
 struct list_of_token specifier_list;
+// Stacks on which the parser gathers the args of a function call and the items of a block, before handing them
+// to the AST constructor, which copies them into a list of exactly that many. Nested calls and blocks push
+// above their enclosing ones, and pop back off when done.
+static struct list_of_CExpression arg_stack;
+static struct list_of_CBlockItem block_item_stack;
+
+/*
+ * Expressions are parsed by operator precedence in a loop, not by recursion, so that no expression, however
+ * long its chain of operators or deep its nesting, can exhaust the C stack. Whatever is waiting for an operand
+ * to be finished is pushed on frame_stack:
+ * - FRAME_BASE:     the whole expression of one parse_expression() call,
+ * - FRAME_PREFIX:   a prefix operator, "-", "~", "!", "++" or "--",
+ * - FRAME_BINOP:    a binary operator and its left operand,
+ * - FRAME_ASSIGN:   a simple or compound assignment and its lvalue (right associative),
+ * - FRAME_COND_MIDDLE and FRAME_COND_RIGHT: a conditional, waiting for its middle, then its right operand,
+ * - FRAME_PARENS:   an opening parenthesis,
+ * - FRAME_CALL:     a function call, whose args are gathered on arg_stack.
+ * An operator continues the operand of the top frame if it binds at least as tightly as the frame's
+ * min_precedence; otherwise the operand completes the top frame, which is popped.
+ */
+enum PARSE_FRAME_KIND {
+    FRAME_BASE,
+    FRAME_PREFIX,
+    FRAME_BINOP,
+    FRAME_ASSIGN,
+    FRAME_COND_MIDDLE,
+    FRAME_COND_RIGHT,
+    FRAME_PARENS,
+    FRAME_CALL,
+};
+struct ParseFrame {
+    enum PARSE_FRAME_KIND kind;
+    int min_precedence;
+    enum TK tk;                     // FRAME_PREFIX, FRAME_ASSIGN
+    enum AST_BINARY_OP op;          // FRAME_BINOP, FRAME_ASSIGN
+    int precedence;                 // FRAME_COND_MIDDLE: precedence of the right operand
+    struct CExpression *left;       // FRAME_BINOP, FRAME_ASSIGN, FRAME_COND_*
+    struct CExpression *middle;     // FRAME_COND_RIGHT
+    uint32_t name;                  // FRAME_CALL
+    int arg_base;                   // FRAME_CALL
+};
+LIST_OF_ITEM_DECL(list_of_parse_frame, struct ParseFrame)
+LIST_OF_ITEM_DEFN_STATIC(list_of_parse_frame, struct ParseFrame, LIST_OF_NO_DELETE)
+static struct list_of_parse_frame frame_stack;
+
+/*
+ * Statements are likewise parsed in a loop, so that no nesting of blocks, ifs or loops can exhaust the C stack.
+ * A statement that encloses others is pushed on statement_frames while they are parsed:
+ * - SFRAME_BLOCK:   a compound statement, whose items are gathered on block_item_stack,
+ * - SFRAME_THEN:    an if, or the latest if of an else-if ladder, waiting for its then statement,
+ * - SFRAME_ELSE:    the last if of a ladder, waiting for its else statement,
+ * - SFRAME_WHILE, SFRAME_DO, SFRAME_FOR and SFRAME_SWITCH: a loop or switch, waiting for its body.
+ * The labels before each statement are gathered on label_stack, and applied when the statement is complete.
+ */
+enum STATEMENT_FRAME_KIND {
+    SFRAME_BLOCK,
+    SFRAME_THEN,
+    SFRAME_ELSE,
+    SFRAME_WHILE,
+    SFRAME_DO,
+    SFRAME_FOR,
+    SFRAME_SWITCH,
+};
+struct StatementFrame {
+    enum STATEMENT_FRAME_KIND kind;
+    int label_base;
+    int item_base;                  // SFRAME_BLOCK
+    struct CExpression *condition;  // SFRAME_THEN, SFRAME_WHILE, SFRAME_FOR, SFRAME_SWITCH
+    struct CForInit *for_init;      // SFRAME_FOR
+    struct CExpression *post;       // SFRAME_FOR
+    struct CStatement *first_if;    // SFRAME_THEN, SFRAME_ELSE: the head of the ladder
+    struct CStatement *last_if;     // SFRAME_THEN, SFRAME_ELSE: the latest if of the ladder, if any
+};
+LIST_OF_ITEM_DECL(list_of_statement_frame, struct StatementFrame)
+LIST_OF_ITEM_DEFN_STATIC(list_of_statement_frame, struct StatementFrame, LIST_OF_NO_DELETE)
+static struct list_of_statement_frame statement_frames;
+static struct list_of_CLabel label_stack;
 
 static void initialize_parser(void) {
     static int initialized = 0;
     if (!initialized) {
-        list_of_token_init(&specifier_list, 3);
+        list_of_token_init(&specifier_list, 0);
+        list_of_CExpression_init(&arg_stack, 16);
+        list_of_CBlockItem_init(&block_item_stack, 64);
+        list_of_parse_frame_init(&frame_stack, 64);
+        list_of_statement_frame_init(&statement_frames, 64);
+        list_of_CLabel_init(&label_stack, 16);
         initialized = 1;
     } else {
         list_of_token_clear(&specifier_list);
+        list_of_CExpression_clear(&arg_stack);
+        list_of_CBlockItem_clear(&block_item_stack);
+        list_of_parse_frame_clear(&frame_stack);
+        list_of_statement_frame_clear(&statement_frames);
+        list_of_CLabel_clear(&label_stack);
     }
 }
 
 
 struct CProgram * c_program_parse(void) {
     initialize_parser();
+    // Tokenize the whole file up front, so lookahead is just indexing.
+    lex_prelex();
     struct CProgram *program = parse_program();
     return program;
 }
 
+/**
+ * Begins parsing the open file one declaration at a time, with c_program_parse_next(). The file is tokenized
+ * as it is parsed, rather than up front, so memory doesn't grow with the size of the file.
+ * @return an empty program, to hold each declaration as it is parsed.
+ */
+struct CProgram *c_program_parse_begin(void) {
+    initialize_parser();
+    return c_program_new();
+}
+
+/**
+ * Parses the next file-scope declaration, and adds it to the program.
+ * @param program from c_program_parse_begin().
+ * @return the declaration, or NULL at the end of the file.
+ */
+struct CDeclaration *c_program_parse_next(struct CProgram *program) {
+    if (lex_peek_token().tk == TK_EOF) return NULL;
+    struct CDeclaration *declaration = parse_declaration();
+    c_program_add_decl(program, declaration);
+    return declaration;
+}
+
 void analyze_program(const struct CProgram* program) {
     semantic_analysis(program);
 }
 
+void analyze_begin(void) {
+    semantic_analysis_begin();
+}
+
+void analyze_declaration(struct CDeclaration *declaration) {
+    semantic_analysis_declaration(declaration);
+}
+
 struct CProgram *parse_program() {
     struct Token token = lex_peek_token();
     struct CProgram *program = c_program_new();
@@ -141,7 +252,7 @@ struct CDeclaration *parse_declaration(void) {
 
 struct CFuncDecl *parse_funcdecl(struct Token idToken, enum STORAGE_CLASS sc, int type) {
     expect(TK_L_PAREN);
-    struct CFuncDecl* function = c_function_new(idToken.text, sc);
+    struct CFuncDecl* function = c_function_new(idToken.text_id, sc);
 
     struct Token token = lex_peek_token();
     if (token.tk == TK_VOID && lex_peek_ahead(2).tk == TK_R_PAREN) {
@@ -156,7 +267,7 @@ struct CFuncDecl *parse_funcdecl(struct Token idToken, enum STORAGE_CLASS sc, in
             expect(TK_INT);
             // parse name [todo: optional if declaration]
             token = lex_take_token();
-            c_function_add_param(function, token.text);
+            c_function_add_param(function, token.text_id);
             // optional comma, if more params
             token = lex_peek_token();
         }
@@ -179,16 +290,16 @@ struct CFuncDecl *parse_funcdecl(struct Token idToken, enum STORAGE_CLASS sc, in
 struct CVarDecl *parse_vardecl(struct Token idToken, enum STORAGE_CLASS sc, int type) {
     struct CVarDecl* result;
     if (idToken.tk != TK_ID) {
-        fprintf(stderr, "Expected id: %s\n", idToken.text);
+        fprintf(stderr, "Expected id: %s\n", lex_token_text(idToken));
         exit(1);
     }
     struct Token init = lex_peek_token();
     if (init.tk == TK_ASSIGN) {
         lex_take_token();
         struct CExpression* initializer = parse_expression(0);
-        result = c_vardecl_new_init(idToken.text, initializer, sc);
+        result = c_vardecl_new_init(idToken.text_id, initializer, sc);
     } else {
-        result = c_vardecl_new(idToken.text, sc);
+        result = c_vardecl_new(idToken.text_id, sc);
     }
     expect(TK_SEMI);
     return result;
@@ -203,14 +314,16 @@ struct CVarDecl *parse_vardecl(struct Token idToken, enum STORAGE_CLASS sc, int
  * @return a pointer to the new block object.
  */
 struct CBlock* parse_block(int is_function) {
-    struct CBlock* result = c_block_new(is_function);
+    int base = block_item_stack.num_items;
     struct Token token = lex_peek_token();
     while (token.tk != TK_R_BRACE) {
         struct CBlockItem *item = parse_block_item();
-        c_block_append_item(result, item);
+        list_of_CBlockItem_append(&block_item_stack, item);
         token = lex_peek_token();
     }
     lex_take_token(); // TK_R_BRACE
+    struct CBlock* result = c_block_new(is_function, block_item_stack.items + base, block_item_stack.num_items - base);
+    while (block_item_stack.num_items > base) list_of_CBlockItem_pop(&block_item_stack);
     return result;
 }
 
@@ -272,9 +385,64 @@ struct CExpression * parse_optional_expression(enum TK tk) {
     return result;
 }
 
-struct CStatement *parse_statement() {
-    struct list_of_CLabel labels;
-    int have_labels = 0;
+static void push_statement_frame(struct StatementFrame frame) {
+    list_of_statement_frame_append(&statement_frames, frame);
+}
+
+static struct StatementFrame *top_statement_frame(void) {
+    return &statement_frames.items[statement_frames.num_items - 1];
+}
+
+// Applies the labels gathered since label_base to a statement, which is now complete.
+static struct CStatement *apply_labels(struct CStatement *statement, int label_base) {
+    if (label_stack.num_items > label_base) {
+        c_statement_add_labels(statement, label_stack.items + label_base, label_stack.num_items - label_base);
+        while (label_stack.num_items > label_base) list_of_CLabel_pop(&label_stack);
+    }
+    return statement;
+}
+
+// Pops the top frame, whose statement is now complete, and applies the labels that preceded it.
+static struct CStatement *pop_statement_frame(struct CStatement *statement) {
+    struct StatementFrame frame = list_of_statement_frame_pop(&statement_frames);
+    return apply_labels(statement, frame.label_base);
+}
+
+// Parses "if (condition)" into the top frame, which then waits for the then statement.
+static void parse_if_condition(void) {
+    lex_take_token(); // TK_IF
+    expect(TK_L_PAREN);
+    struct CExpression* condition = parse_expression(0);
+    expect(TK_R_PAREN);
+    top_statement_frame()->condition = condition;
+}
+
+/**
+ * Parses the declarations of the block on top of the frame stack, up to its next statement or its end.
+ * @return the compound statement, if the block has ended, or NULL if a statement of the block is next.
+ */
+static struct CStatement *parse_block_declarations(void) {
+    struct Token token = lex_peek_token();
+    while (is_specifier(token)) {
+        struct CDeclaration *decl = parse_declaration();
+        list_of_CBlockItem_append(&block_item_stack, c_block_item_new_decl(decl));
+        token = lex_peek_token();
+    }
+    if (token.tk != TK_R_BRACE) return NULL;
+    lex_take_token(); // TK_R_BRACE
+    int base = top_statement_frame()->item_base;
+    struct CBlock* block = c_block_new(0 /* is_function */, block_item_stack.items + base, block_item_stack.num_items - base);
+    while (block_item_stack.num_items > base) list_of_CBlockItem_pop(&block_item_stack);
+    return pop_statement_frame(c_statement_new_compound(block));
+}
+
+/**
+ * Begins a statement, with any labels before it. A statement that encloses others is pushed on the frame
+ * stack, to wait for them.
+ * @return the statement, if it is complete, or NULL if a statement that it encloses is next.
+ */
+static struct CStatement *begin_statement(void) {
+    struct StatementFrame frame = {.label_base = label_stack.num_items};
     struct CStatement* result = NULL;
     struct CExpression* dst = NULL;
     struct Token next_token = lex_peek_token();
@@ -293,72 +461,61 @@ struct CStatement *parse_statement() {
             label = c_label_new_switch_default();
         } else {
             lex_take_token();   // identifier name (TK_ID)
-            label = c_label_new_label((struct CIdentifier){.name = next_token.text, .source_name = next_token.text});
+            label = c_label_new_label((struct CIdentifier){.name = next_token.text_id, .source_name = next_token.text_id});
         }
         expect(TK_COLON);
-        if (!have_labels) {
-            list_of_CLabel_init(&labels, 3);
-            have_labels = 1;
-        }
-        list_of_CLabel_append(&labels, label);
+        list_of_CLabel_append(&label_stack, label);
         next_token = lex_peek_token();
     }
 
     if (next_token.tk == TK_L_BRACE) {
         lex_take_token();
-        struct CBlock* block = parse_block(0 /* is_function */);
-        result = c_statement_new_compound(block);
+        frame.kind = SFRAME_BLOCK;
+        frame.item_base = block_item_stack.num_items;
+        push_statement_frame(frame);
+        return parse_block_declarations();
     }
     else if (next_token.tk == TK_IF) {
-        struct CStatement* else_statement = NULL;
-        lex_take_token();
-        expect(TK_L_PAREN);
-        struct CExpression* condition = parse_expression(0);
-        expect(TK_R_PAREN);
-        struct CStatement* then_statement = parse_statement();
-        next_token = lex_peek_token();
-        if (next_token.tk == TK_ELSE) {
-            lex_take_token();
-            else_statement = parse_statement();
-        }
-        result = c_statement_new_if(condition, then_statement, else_statement);
+        frame.kind = SFRAME_THEN;
+        push_statement_frame(frame);
+        parse_if_condition();
+        return NULL;
     }
     else if (next_token.tk == TK_WHILE) {
         lex_take_token();
         expect(TK_L_PAREN);
-        struct CExpression* condition = parse_expression(0);
+        frame.kind = SFRAME_WHILE;
+        frame.condition = parse_expression(0);
         expect(TK_R_PAREN);
-        struct CStatement* body = parse_statement();
-        result = c_statement_new_while(condition, body);
+        push_statement_frame(frame);
+        return NULL;
     }
     else if (next_token.tk == TK_DO) {
         lex_take_token();
-        struct CStatement* body = parse_statement();
-        expect(TK_WHILE);
-        expect(TK_L_PAREN);
-        struct CExpression* condition = parse_expression(0);
-        expect(TK_R_PAREN);
-        expect(TK_SEMI);
-        result = c_statement_new_do(body, condition);
+        frame.kind = SFRAME_DO;
+        push_statement_frame(frame);
+        return NULL;
     }
     else if (next_token.tk == TK_FOR) {
         lex_take_token();
         expect(TK_L_PAREN);
-        struct CForInit* for_init = parse_for_init();
-        struct CExpression* condition = parse_optional_expression(TK_SEMI);
+        frame.kind = SFRAME_FOR;
+        frame.for_init = parse_for_init();
+        frame.condition = parse_optional_expression(TK_SEMI);
         expect(TK_SEMI);
-        struct CExpression* post = parse_optional_expression(TK_R_PAREN);
+        frame.post = parse_optional_expression(TK_R_PAREN);
         expect(TK_R_PAREN);
-        struct CStatement* body = parse_statement();
-        result = c_statement_new_for(for_init, condition, post, body);
+        push_statement_frame(frame);
+        return NULL;
     }
     else if (next_token.tk == TK_SWITCH) {
         lex_take_token();
         expect(TK_L_PAREN);
-        struct CExpression* condition = parse_expression(0);
+        frame.kind = SFRAME_SWITCH;
+        frame.condition = parse_expression(0);
         expect(TK_R_PAREN);
-        struct CStatement* body = parse_statement();
-        result = c_statement_new_switch(condition, body);
+        push_statement_frame(frame);
+        return NULL;
     }
     else if (next_token.tk == TK_BREAK) {
         lex_take_token();
@@ -380,7 +537,7 @@ struct CStatement *parse_statement() {
     else if (next_token.tk == TK_GOTO) {
         lex_take_token();
         next_token = expect(TK_ID);
-        dst = c_expression_new_var(next_token.text);
+        dst = c_expression_new_var(next_token.text_id);
         expect(TK_SEMI);
         result = c_statement_new_goto(dst);
     }
@@ -395,15 +552,72 @@ struct CStatement *parse_statement() {
     }
 
     // Apply labels from above.
-    if (have_labels) {
-        c_statement_add_labels(result, labels);
-        list_of_CLabel_delete(&labels);
-    }
+    return apply_labels(result, frame.label_base);
+}
 
-    // Don't do this; any production that expects a ';' should itself code for it.
-    // next_token = lex_peek_token();
-    // if (next_token.tk == TK_SEMI) { lex_take_token(); }
-    return result;
+/**
+ * Hands a completed statement to the frame on top of the stack, which encloses it.
+ * @param statement that was just completed.
+ * @return the statement of the frame, if that is now complete, or NULL if another enclosed statement is next.
+ */
+static struct CStatement *finish_enclosed_statement(struct CStatement *statement) {
+    struct StatementFrame *frame = top_statement_frame();
+    struct CExpression* condition;
+    switch (frame->kind) {
+        case SFRAME_BLOCK:
+            list_of_CBlockItem_append(&block_item_stack, c_block_item_new_stmt(statement));
+            return parse_block_declarations();
+        case SFRAME_THEN: {
+            // An "else if" ladder is parsed in one frame, hanging each if on the else of the one before.
+            struct CStatement* if_statement = c_statement_new_if(frame->condition, statement, NULL);
+            if (frame->last_if) {
+                frame->last_if->if_statement.else_statement = if_statement;
+            } else {
+                frame->first_if = if_statement;
+            }
+            frame->last_if = if_statement;
+            if (lex_peek_token().tk != TK_ELSE) return pop_statement_frame(frame->first_if);
+            lex_take_token();
+            if (lex_peek_token().tk == TK_IF) {
+                parse_if_condition();
+            } else {
+                frame->kind = SFRAME_ELSE;
+            }
+            return NULL;
+        }
+        case SFRAME_ELSE:
+            frame->last_if->if_statement.else_statement = statement;
+            return pop_statement_frame(frame->first_if);
+        case SFRAME_WHILE:
+            return pop_statement_frame(c_statement_new_while(frame->condition, statement));
+        case SFRAME_DO:
+            expect(TK_WHILE);
+            expect(TK_L_PAREN);
+            condition = parse_expression(0);
+            expect(TK_R_PAREN);
+            expect(TK_SEMI);
+            return pop_statement_frame(c_statement_new_do(statement, condition));
+        case SFRAME_FOR:
+            return pop_statement_frame(c_statement_new_for(frame->for_init, frame->condition, frame->post, statement));
+        case SFRAME_SWITCH:
+            return pop_statement_frame(c_statement_new_switch(frame->condition, statement));
+    }
+    return NULL;
+}
+
+/**
+ * Parses a statement, with any preceding labels, and every statement it encloses, from the frame stack.
+ * @return the statement.
+ */
+struct CStatement *parse_statement() {
+    int base = statement_frames.num_items;
+    for (;;) {
+        struct CStatement *statement = begin_statement();
+        while (statement) {
+            if (statement_frames.num_items == base) return statement;
+            statement = finish_enclosed_statement(statement);
+        }
+    }
 }
 
 
@@ -419,123 +633,173 @@ static int get_binop_precedence(struct Token token) {
 static enum AST_BINARY_OP parse_binop() {
     struct Token token = lex_take_token();
     if (!TK_IS_BINOP(token.tk)) {
-        failf("Expected binop-op but got %s", token.text);
+        failf("Expected binop-op but got %s", lex_token_text(token));
     }
     enum AST_BINARY_OP binop = TK_GET_BINOP(token.tk);
     return binop;
 }
 
-struct CExpression *parse_conditional_middle() {
-    lex_take_token(); // the '?'
-    struct CExpression* middle_exp = parse_expression(0);
-    expect(TK_COLON);
-    return middle_exp;
+static void push_frame(struct ParseFrame frame) {
+    list_of_parse_frame_append(&frame_stack, frame);
 }
 
-struct CExpression* parse_function_call(const char *name) {
-    struct CIdentifier func = { .name = name, .source_name = name};
-    struct CExpression* function_call = c_expression_new_function_call(func);
-    expect(TK_L_PAREN);
-    struct Token token = lex_peek_token();
-    int num_args = 0;
-    while (token.tk != TK_R_PAREN) {
-        if (num_args++ > 0) {
-            expect(TK_COMMA);
-        }
-        // gather args; here TK_COMMA is arg separator, not comma-operator!
-        struct CExpression* arg = parse_expression(0);
-        c_expression_function_call_add_arg(function_call, arg);
-        token = lex_peek_token();
+static struct CExpression *parse_postfix(struct CExpression *operand) {
+    struct Token next_token = lex_peek_token();
+    while (next_token.tk == TK_INCREMENT || next_token.tk == TK_DECREMENT) {
+        lex_take_token();
+        operand = c_expression_new_increment((next_token.tk == TK_INCREMENT) ? AST_POST_INCR : AST_POST_DECR, operand);
+        next_token = lex_peek_token();
     }
-    lex_take_token(); // TK_R_PAREN
+    return operand;
+}
+
+static struct CExpression *apply_prefix(const struct ParseFrame *frame, struct CExpression *operand) {
+    switch (frame->tk) {
+        case TK_HYPHEN:
+            return c_expression_new_unop(AST_UNARY_NEGATE, operand);
+        case TK_TILDE:
+            return c_expression_new_unop(AST_UNARY_COMPLEMENT, operand);
+        case TK_L_NOT:
+            return c_expression_new_unop(AST_UNARY_L_NOT, operand);
+        default:
+            return c_expression_new_increment((frame->tk == TK_INCREMENT) ? AST_PRE_INCR : AST_PRE_DECR, operand);
+    }
+}
+
+static struct CExpression *finish_call(const struct ParseFrame *frame) {
+    struct CIdentifier func = { .name = frame->name, .source_name = frame->name};
+    struct CExpression* function_call = c_expression_new_function_call(func, arg_stack.items + frame->arg_base,
+                                                                       arg_stack.num_items - frame->arg_base);
+    while (arg_stack.num_items > frame->arg_base) list_of_CExpression_pop(&arg_stack);
     return function_call;
 }
 
-struct CExpression *parse_expression(int minimum_precedence) {
-    struct CExpression* left_exp = parse_factor();
-    struct Token next_token = lex_peek_token();
-    int op_precedence;
-    while (TK_IS_BINOP(next_token.tk) && (op_precedence=get_binop_precedence(next_token)) >= minimum_precedence) {
-        if (TK_IS_ASSIGNMENT(next_token.tk)) {
-            enum AST_BINARY_OP binary_op = parse_binop();
-            struct CExpression *right_exp = parse_expression(op_precedence);
-            if (next_token.tk == TK_ASSIGN) {
-                // simple assignment; assign right_exp to lvalue_exp.
-                left_exp = c_expression_new_assign(right_exp, left_exp);
-            } else {
-                // compound assignment; perform binop op on lvalue_exp op right_exp, then assign result to lvalue_exp
-                struct CExpression* op_result_exp = c_expression_new_binop(binary_op, c_expression_clone(left_exp), right_exp);
-                left_exp = c_expression_new_assign(op_result_exp, left_exp);
-            }
-        } else if (next_token.tk == TK_QUESTION) {
-            struct CExpression* middle_exp = parse_conditional_middle();
-            struct CExpression* right_exp = parse_expression(op_precedence);
-            left_exp = c_expression_new_conditional(left_exp, middle_exp, right_exp);
-        }
-        else {
-            enum AST_BINARY_OP binary_op = parse_binop();
-            struct CExpression *right_exp = parse_expression(op_precedence + 1);
-            left_exp = c_expression_new_binop(binary_op, left_exp, right_exp);
+/**
+ * Parses prefix operators, pushing a frame for each, up to a primary expression: a literal, a variable, or a
+ * function call without args. Returns NULL if, instead, it pushed a frame for a '(' or for a call's first arg;
+ * the operand is then whatever expression follows.
+ */
+static struct CExpression *parse_operand(void) {
+    struct Token next_token;
+    for (;;) {
+        next_token = lex_take_token();
+        switch (next_token.tk) {
+            case TK_LITERAL:
+            case TK_LONG_LITERAL:
+                // There are no long constants yet; a long literal is converted to int.
+                return c_expression_new_const(AST_CONST_INT, (int)lex_token_value(next_token));
+            case TK_HYPHEN:
+            case TK_TILDE:
+            case TK_L_NOT:
+            case TK_INCREMENT:
+            case TK_DECREMENT:
+                push_frame((struct ParseFrame){.kind = FRAME_PREFIX, .tk = next_token.tk});
+                break;
+            case TK_PLUS:
+                // "+x" is simply "x". Skip the '+'.
+                break;
+            case TK_L_PAREN:
+                push_frame((struct ParseFrame){.kind = FRAME_PARENS, .min_precedence = 0});
+                return NULL;
+            case TK_ID:
+                if (lex_peek_token().tk != TK_L_PAREN) {
+                    return c_expression_new_var(next_token.text_id);
+                }
+                lex_take_token(); // TK_L_PAREN
+                push_frame((struct ParseFrame){.kind = FRAME_CALL, .min_precedence = 0,
+                                               .name = next_token.text_id, .arg_base = arg_stack.num_items});
+                if (lex_peek_token().tk != TK_R_PAREN) {
+                    // gather args; here TK_COMMA is arg separator, not comma-operator!
+                    return NULL;
+                }
+                lex_take_token(); // TK_R_PAREN
+                return finish_call(&frame_stack.items[--frame_stack.num_items]);
+            default:
+                failf("Malformed factor, token = '%s'", lex_token_text(next_token));
+                break;
         }
-        next_token = lex_peek_token();
     }
-    return left_exp;
 }
 
-static struct CExpression* parse_factor() {
-    struct CExpression *result;
-    struct Token next_token = lex_take_token();
-    if (next_token.tk == TK_LITERAL) {
-        result = c_expression_new_const(AST_CONST_INT, atoi(next_token.text));
-    }
-    else if (next_token.tk == TK_HYPHEN) {
-        struct CExpression *operand = parse_factor();
-        result = c_expression_new_unop(AST_UNARY_NEGATE, operand);
-    }
-    else if (next_token.tk == TK_TILDE) {
-        struct CExpression *operand = parse_factor();
-        result = c_expression_new_unop(AST_UNARY_COMPLEMENT, operand);
-    }
-    else if (next_token.tk == TK_PLUS) {
-        // "+x" is simply "x". Skip the '+' and return the factor.
-        result = parse_factor();
-    }
-    else if (next_token.tk == TK_L_NOT) {
-        struct CExpression *operand = parse_factor();
-        result = c_expression_new_unop(AST_UNARY_L_NOT, operand);
-    }
-    else if (next_token.tk == TK_L_PAREN) {
-        result = parse_expression(0);
-        expect(TK_R_PAREN);
-    }
-    else if (next_token.tk == TK_ID) {
-        if (lex_peek_token().tk == TK_L_PAREN) {
-            result = parse_function_call(next_token.text);
-        } else {
-            result = c_expression_new_var(next_token.text);
+struct CExpression *parse_expression(int minimum_precedence) {
+    int base = frame_stack.num_items;
+    push_frame((struct ParseFrame){.kind = FRAME_BASE, .min_precedence = minimum_precedence});
+    for (;;) {
+        struct CExpression *operand = parse_operand();
+        if (!operand) continue;
+        operand = parse_postfix(operand);
+        // Complete frames with the operand until an operator continues it, or another operand is needed.
+        for (;;) {
+            struct ParseFrame *frame = &frame_stack.items[frame_stack.num_items - 1];
+            if (frame->kind == FRAME_PREFIX) {
+                operand = apply_prefix(frame, operand);
+                --frame_stack.num_items;
+                continue;
+            }
+            struct Token next_token = lex_peek_token();
+            int op_precedence;
+            if (TK_IS_BINOP(next_token.tk) && (op_precedence=get_binop_precedence(next_token)) >= frame->min_precedence) {
+                if (TK_IS_ASSIGNMENT(next_token.tk)) {
+                    enum AST_BINARY_OP binary_op = parse_binop();
+                    push_frame((struct ParseFrame){.kind = FRAME_ASSIGN, .min_precedence = op_precedence,
+                                                   .tk = next_token.tk, .op = binary_op, .left = operand});
+                } else if (next_token.tk == TK_QUESTION) {
+                    lex_take_token(); // the '?'
+                    push_frame((struct ParseFrame){.kind = FRAME_COND_MIDDLE, .min_precedence = 0,
+                                                   .precedence = op_precedence, .left = operand});
+                } else {
+                    enum AST_BINARY_OP binary_op = parse_binop();
+                    push_frame((struct ParseFrame){.kind = FRAME_BINOP, .min_precedence = op_precedence + 1,
+                                                   .op = binary_op, .left = operand});
+                }
+                break;
+            }
+            if (frame->kind == FRAME_BASE) {
+                --frame_stack.num_items;
+                assert(frame_stack.num_items == base);
+                return operand;
+            } else if (frame->kind == FRAME_BINOP) {
+                operand = c_expression_new_binop(frame->op, frame->left, operand);
+            } else if (frame->kind == FRAME_ASSIGN) {
+                if (frame->tk == TK_ASSIGN) {
+                    // simple assignment; assign right_exp to lvalue_exp.
+                    operand = c_expression_new_assign(operand, frame->left);
+                } else {
+                    // compound assignment; perform binop op on lvalue_exp op right_exp, then assign result to lvalue_exp
+                    struct CExpression* op_result_exp = c_expression_new_binop(frame->op, c_expression_clone(frame->left), operand);
+                    operand = c_expression_new_assign(op_result_exp, frame->left);
+                }
+            } else if (frame->kind == FRAME_COND_MIDDLE) {
+                expect(TK_COLON);
+                frame->kind = FRAME_COND_RIGHT;
+                frame->min_precedence = frame->precedence;
+                frame->middle = operand;
+                break;
+            } else if (frame->kind == FRAME_COND_RIGHT) {
+                operand = c_expression_new_conditional(frame->left, frame->middle, operand);
+            } else if (frame->kind == FRAME_PARENS) {
+                expect(TK_R_PAREN);
+                --frame_stack.num_items;
+                operand = parse_postfix(operand);
+                continue;
+            } else if (frame->kind == FRAME_CALL) {
+                list_of_CExpression_append(&arg_stack, operand);
+                if (lex_peek_token().tk != TK_R_PAREN) {
+                    expect(TK_COMMA);
+                    break;
+                }
+                lex_take_token(); // TK_R_PAREN
+                operand = parse_postfix(finish_call(frame));
+            }
+            --frame_stack.num_items;
         }
     }
-    else if (next_token.tk == TK_INCREMENT || next_token.tk == TK_DECREMENT) {
-        struct CExpression *operand = parse_factor();
-        result = c_expression_new_increment((next_token.tk == TK_INCREMENT) ? AST_PRE_INCR : AST_PRE_DECR, operand);
-    }
-    else {
-        result = NULL;
-        failf("Malformed factor, token = '%s'", next_token.text);
-    }
-    next_token = lex_peek_token();
-    while (next_token.tk == TK_INCREMENT || next_token.tk == TK_DECREMENT) {
-        lex_take_token();
-        result = c_expression_new_increment((next_token.tk == TK_INCREMENT) ? AST_POST_INCR : AST_POST_DECR, result);
-        next_token = lex_peek_token();
-    }
-    return result;
 }
 
 static struct Token expect(enum TK expected) {
     struct Token token = lex_take_token();
     if (token.tk != expected) {
-        failf("Expected %s but got %s", lex_token_name(expected), token.text);
+        failf("Expected %s but got %s", lex_token_name(expected), lex_token_text(token));
     }
     return token;
 }
@@ -8,4 +8,13 @@
 extern struct CProgram *c_program_parse(void);
 extern void analyze_program(const struct CProgram* program);
 
+// One declaration at a time.
+extern struct CProgram *c_program_parse_begin(void);
+extern struct CDeclaration *c_program_parse_next(struct CProgram *program);
+extern void analyze_begin(void);
+extern void analyze_declaration(struct CDeclaration *declaration);
+
+extern int parser_depth_test(void);
+extern int parser_flow_id_test(void);
+
 #endif //BCC_PARSER_H
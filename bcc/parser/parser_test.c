@@ -0,0 +1,197 @@
+//
+// Created by Bill Evans on 10/17/26.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "ast.h"
+#include "ast2ir.h"
+#include "parser.h"
+#include "symtable.h"
+#include "../lexer/lexer.h"
+#include "../amd64/amd64.h"
+#include "../amd64/ir2amd64.h"
+
+// How deeply the generated expressions and statements nest.
+#define DEPTH_TEST_DEPTH 1000000
+
+/*
+ * A generated function: head, then DEPTH_TEST_DEPTH copies of open, then middle, then DEPTH_TEST_DEPTH
+ * copies of close, then tail.
+ */
+struct depth_case {
+    const char *name;
+    const char *head;
+    const char *open;
+    const char *middle;
+    const char *close;
+    const char *tail;
+};
+#define RETURN_HEAD "int f(int x) { return x; }\nint main(void) {\n    int a = 1;\n    return "
+#define RETURN_TAIL ";\n}\n"
+#define STATEMENT_HEAD "int main(void) {\n    int a = 1;\n"
+#define STATEMENT_TAIL "    return a;\n}\n"
+static const struct depth_case depth_cases[] = {
+    {"left-associative chain",  RETURN_HEAD, "",         "a", " + a",   RETURN_TAIL},
+    {"logical and chain",       RETURN_HEAD, "",         "a", " && a",  RETURN_TAIL},
+    {"assignment chain",        RETURN_HEAD, "a = ",     "1", "",       RETURN_TAIL},
+    {"compound assignment",     RETURN_HEAD, "a += ",    "1", "",       RETURN_TAIL},
+    {"prefix operators",        RETURN_HEAD, "-~!",      "a", "",       RETURN_TAIL},
+    {"parentheses",             RETURN_HEAD, "(a - ",    "a", ")",      RETURN_TAIL},
+    {"conditional, else",       RETURN_HEAD, "a ? 1 : ", "0", "",       RETURN_TAIL},
+    {"conditional, then",       RETURN_HEAD, "a ? ",     "1", " : 0",   RETURN_TAIL},
+    {"function calls",          RETURN_HEAD, "f(",       "a", ")",      RETURN_TAIL},
+    {"else-if ladder",          "int main(void) {\n    int a = 1;\n",
+                                             "    if (a) a = a + 1;\n    else ",
+                                                         "a = 0;\n", "", "    return a;\n}\n"},
+    {"nested blocks",           STATEMENT_HEAD, "{ int b = a; a = a + b;\n", "", "}\n", STATEMENT_TAIL},
+    {"nested ifs",              STATEMENT_HEAD, "if (a) ",   "a = a + 1;\n", "",             STATEMENT_TAIL},
+    {"nested ifs with else",    STATEMENT_HEAD, "if (a) ",   "a = a + 1;\n", "else a = 0;\n", STATEMENT_TAIL},
+    {"nested loops",            STATEMENT_HEAD, "while (a) do ", "a = 0;\n", "while (a);\n", STATEMENT_TAIL},
+};
+
+static void write_repeated(FILE *file, const char *text) {
+    if (!*text) return;
+    for (int ix = 0; ix < DEPTH_TEST_DEPTH; ix++) {
+        fputs(text, file);
+    }
+}
+
+/**
+ * Compiles a generated file a function at a time, as a normal compile does, emitting to /dev/null.
+ * @param fname of the file.
+ * @return the number of AMD64 instructions of the largest function.
+ */
+static int compile_depth_case(const char *fname) {
+    int max_instructions = 0;
+    lex_openFile(fname);
+    struct CProgram *program = c_program_parse_begin();
+    analyze_begin();
+    FILE *null = fopen("/dev/null", "w");
+    struct Amd64Emitter *emitter = amd64_emitter_new(null, NULL);
+    struct CDeclaration *declaration;
+    while ((declaration = c_program_parse_next(program)) != NULL) {
+        int first_symbol = get_num_symbols();
+        analyze_declaration(declaration);
+        if (declaration->decl_kind == FUNC_DECL) {
+            struct IrFunction *irFunction = ast2ir_function(declaration->func);
+            if (irFunction) {
+                struct Amd64Function *asmFunction = ir2amd64_function(irFunction);
+                IrFunction_delete(irFunction);
+                if (asmFunction->instructions.num_items > max_instructions) {
+                    max_instructions = asmFunction->instructions.num_items;
+                }
+                amd64_emitter_emit_function(emitter, asmFunction);
+                amd64_function_delete(asmFunction);
+            }
+        }
+        symtab_forget_locals(first_symbol);
+        c_program_clear(program);
+    }
+    amd64_emitter_delete(emitter);
+    fclose(null);
+    c_program_delete(program);
+    return max_instructions;
+}
+
+/**
+ * Compiles expressions and statements nested a million deep, each of a different shape, all the way to
+ * assembly. Any of them would overflow the C stack, were the parser, the semantic analysis, or the IR
+ * generation to recurse once per level.
+ * @return the number of failures.
+ */
+int parser_depth_test(void) {
+    int failures = 0;
+    printf("Nesting depth %d:\n", DEPTH_TEST_DEPTH);
+    char fname[] = "/tmp/bcc_depth_test.XXXXXX";
+    int fd = mkstemp(fname);
+    close(fd);
+    for (size_t ix = 0; ix < sizeof(depth_cases) / sizeof(depth_cases[0]); ix++) {
+        const struct depth_case *test = &depth_cases[ix];
+        FILE *file = fopen(fname, "w");
+        fputs(test->head, file);
+        write_repeated(file, test->open);
+        fputs(test->middle, file);
+        write_repeated(file, test->close);
+        fputs(test->tail, file);
+        fclose(file);
+
+        double start = now_seconds();
+        int num_instructions = compile_depth_case(fname);
+        double t = now_seconds() - start;
+        printf("  %-24s %9d AMD64 instructions, %7.1f ms\n", test->name, num_instructions, t * 1e3);
+        if (num_instructions < DEPTH_TEST_DEPTH) {
+            printf("FAIL: %s: only %d instructions\n", test->name, num_instructions);
+            ++failures;
+        }
+    }
+    remove(fname);
+    return test_result("nesting depth", failures);
+}
+
+/*
+ * Programs whose first loop or switch gets flow id 0, which must still be taken as enclosing its break
+ * or continue, and programs with a break or continue outside any loop, which must not compile.
+ */
+struct flow_id_case {
+    const char *source;
+    int exit_status;
+};
+static const struct flow_id_case flow_id_cases[] = {
+    {"int main(void) { while (1) { int y = 0; break; } return 0; }\n", 0},
+    {"int main(void) { do { int y = 0; continue; } while (0); return 0; }\n", 0},
+    {"int main(void) { switch (2) { case 2: { int y = 0; } break; } return 0; }\n", 0},
+    {"int main(void) { break; return 0; }\n", 1},
+    {"int main(void) { switch (1) { default: continue; } return 0; }\n", 1},
+};
+
+/**
+ * Compiles a file in a child process, with uniquifiers numbered from 0, as in a fresh compile. A compile that
+ * fails, or crashes, doesn't end the tests; its output is discarded.
+ * @param fname of the file.
+ * @return the child's exit status, or -1 if it was killed by a signal.
+ */
+static int compile_in_child(const char *fname) {
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        freopen("/dev/null", "w", stdout);
+        freopen("/dev/null", "w", stderr);
+        set_uniquifier_range(0, INT_MAX);
+        compile_depth_case(fname);
+        exit(0);
+    }
+    int status;
+    waitpid(pid, &status, 0);
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+/**
+ * Checks that break and continue statements are matched with their loops and switches, whatever flow ids
+ * those get.
+ * @return the number of failures.
+ */
+int parser_flow_id_test(void) {
+    int failures = 0;
+    char fname[] = "/tmp/bcc_flow_id_test.XXXXXX";
+    int fd = mkstemp(fname);
+    close(fd);
+    for (size_t ix = 0; ix < sizeof(flow_id_cases) / sizeof(flow_id_cases[0]); ix++) {
+        const struct flow_id_case *test = &flow_id_cases[ix];
+        FILE *file = fopen(fname, "w");
+        fputs(test->source, file);
+        fclose(file);
+        int status = compile_in_child(fname);
+        if (status != test->exit_status) {
+            printf("FAIL: compile exited with %d, not %d: %s", status, test->exit_status, test->source);
+            ++failures;
+        }
+    }
+    remove(fname);
+    return test_result("break and continue flow ids", failures);
+}
@@ -10,213 +10,213 @@
 #include "ast.h"
 #include "print_ast.h"
 
-static void print_ast_block(const struct CBlock *block, int depth);
-static void print_ast_funcdecl(const struct CFuncDecl *function);
-static void print_ast_vardecl(struct CVarDecl *vardecl, int depth);
-static void print_ast_statement(struct CStatement *statement, int depth);
-static void print_ast_expression(const struct CExpression *expression, int depth);
-void c_program_print(const struct CProgram *program) {
-    printf("\n\nAST:\nProgram(\n");
+static void print_ast_block(const struct CBlock *block, int depth, FILE *file);
+static void print_ast_funcdecl(const struct CFuncDecl *function, FILE *file);
+static void print_ast_vardecl(struct CVarDecl *vardecl, int depth, FILE *file);
+static void print_ast_statement(struct CStatement *statement, int depth, FILE *file);
+static void print_ast_expression(const struct CExpression *expression, int depth, FILE *file);
+void c_program_print(const struct CProgram *program, FILE *file) {
+    fprintf(file, "\n\nAST:\nProgram(\n");
     for (int ix=0; ix<program->declarations.num_items; ix++) {
-        if (ix > 0) printf("\n");
+        if (ix > 0) fprintf(file, "\n");
         struct CDeclaration* decl = program->declarations.items[ix];
         switch (decl->decl_kind) {
             case FUNC_DECL:
-                print_ast_funcdecl(decl->func);
+                print_ast_funcdecl(decl->func, file);
                 break;
             case VAR_DECL:
-                print_ast_vardecl(decl->var, 0);
-                printf(";");
+                print_ast_vardecl(decl->var, 0, file);
+                fprintf(file, ";");
                 break;
         }
     }
 }
-static void print_ast_funcdecl(const struct CFuncDecl *function) {
+static void print_ast_funcdecl(const struct CFuncDecl *function, FILE *file) {
     switch (function->storage_class) {
         case SC_NONE:
             break;
         case SC_STATIC:
-            printf("static ");
+            fprintf(file, "static ");
             break;
         case SC_EXTERN:
-            printf("extern ");
+            fprintf(file, "extern ");
             break;
     }
-    printf("int %s(", function->name);
+    fprintf(file, "int %s(", strpool_str(function->name));
     if (function->params.num_items == 0) {
-        printf("void");
+        fprintf(file, "void");
     } else {
         for (int ix = 0; ix < function->params.num_items; ix++) {
-            if (ix > 0) printf(", ");
-            printf("int %s(%s)", function->params.items[ix].name, function->params.items[ix].source_name);
+            if (ix > 0) fprintf(file, ", ");
+            fprintf(file, "int %s(%s)", strpool_str(function->params.items[ix].name), strpool_str(function->params.items[ix].source_name));
         }
     }
     if (!function->body) {
-        printf(");\n");
+        fprintf(file, ");\n");
     } else {
-        printf(") ");
-        print_ast_block(function->body, 0);
+        fprintf(file, ") ");
+        print_ast_block(function->body, 0, file);
     }
 }
 
-static void indent4(int n) {
-    for (int i=0; i<=n; ++i) printf("    ");
+static void indent4(int n, FILE *file) {
+    for (int i=0; i<=n; ++i) fprintf(file, "    ");
 }
 
-static void print_ast_vardecl(struct CVarDecl *vardecl, int depth) {
+static void print_ast_vardecl(struct CVarDecl *vardecl, int depth, FILE *file) {
     if (!vardecl) return;
-//    indent4(depth);
+//    indent4(depth, file);
     switch (vardecl->storage_class) {
         case SC_NONE:
             break;
         case SC_STATIC:
-            printf("static ");
+            fprintf(file, "static ");
             break;
         case SC_EXTERN:
-            printf("extern ");
+            fprintf(file, "extern ");
             break;
     }
-    printf("int %s", vardecl->var.source_name);
+    fprintf(file, "int %s", strpool_str(vardecl->var.source_name));
     if (vardecl->initializer) {
-        printf(" = ");
-        print_ast_expression(vardecl->initializer, depth);
+        fprintf(file, " = ");
+        print_ast_expression(vardecl->initializer, depth, file);
     }
-//    printf(";");
+//    fprintf(file, ";");
 }
 
-void print_ast_forinit(struct CForInit * init) {
+void print_ast_forinit(struct CForInit * init, FILE *file) {
     if (!init) return;
     switch (init->kind) {
         case FOR_INIT_DECL:
-            print_ast_vardecl(init->declaration->var, -1);
+            print_ast_vardecl(init->declaration->var, -1, file);
             break;
         case FOR_INIT_EXPR:
-            print_ast_expression(init->expression, 0);
+            print_ast_expression(init->expression, 0, file);
             break;
     }
 }
 
-static void print_ast_block(const struct CBlock *block, int depth) {
-    indent4(depth-1);
-    printf("{\n");
+static void print_ast_block(const struct CBlock *block, int depth, FILE *file) {
+    indent4(depth-1, file);
+    fprintf(file, "{\n");
     for (int ix=0; ix<block->items.num_items; ix++) {
         struct CBlockItem* bi = block->items.items[ix];
         switch (bi->kind) {
             case AST_BI_STATEMENT:
-                print_ast_statement(bi->statement, depth);
+                print_ast_statement(bi->statement, depth, file);
                 break;
             case AST_BI_DECLARATION:
-                indent4(depth);
+                indent4(depth, file);
                 switch (bi->declaration->decl_kind) {
                     case FUNC_DECL:
-                        print_ast_funcdecl(bi->declaration->func);
+                        print_ast_funcdecl(bi->declaration->func, file);
                         break;
                     case VAR_DECL:
-                        print_ast_vardecl(bi->declaration->var, depth);
-                        printf(";\n");
+                        print_ast_vardecl(bi->declaration->var, depth, file);
+                        fprintf(file, ";\n");
                         break;
                 }
                 break;
         }
     }
-    indent4(depth-1);
-    printf("}\n");
+    indent4(depth-1, file);
+    fprintf(file, "}\n");
 }
 
-static void print_ast_statement(struct CStatement *statement, int depth) {
+static void print_ast_statement(struct CStatement *statement, int depth, FILE *file) {
     if (!statement) return;
     if (c_statement_has_labels(statement)) {
         struct CLabel * labels = c_statement_get_labels(statement);
         for (int i=0; i<c_statement_num_labels(statement); ++i) {
-            indent4(depth-1);
+            indent4(depth-1, file);
             if (labels[i].kind == LABEL_DECL)
-                printf("%s:\n", labels[i].identifier.source_name);
+                fprintf(file, "%s:\n", strpool_str(labels[i].identifier.source_name));
             else if (labels[i].kind == LABEL_DEFAULT)
-                printf("default:\n");
+                fprintf(file, "default:\n");
             else if (labels[i].kind == LABEL_CASE) {
-                printf("case ");
-                print_ast_expression(labels[i].expr, 0);
-                printf(":\n");
+                fprintf(file, "case ");
+                print_ast_expression(labels[i].expr, 0, file);
+                fprintf(file, ":\n");
             }
         }
     }
     switch (statement->kind) {
         case STMT_RETURN:
         case STMT_AUTO_RETURN:
-            indent4(depth);
-            printf("return%s", statement->expression ? " " : "");
-            print_ast_expression(statement->expression, depth);
-            printf(" ;\n");
+            indent4(depth, file);
+            fprintf(file, "return%s", statement->expression ? " " : "");
+            print_ast_expression(statement->expression, depth, file);
+            fprintf(file, " ;\n");
             break;
         case STMT_EXP:
-            indent4(depth);
-            print_ast_expression(statement->expression, 0);
-            printf(" ;\n");
+            indent4(depth, file);
+            print_ast_expression(statement->expression, 0, file);
+            fprintf(file, " ;\n");
             break;
         case STMT_NULL:
             break;
         case STMT_GOTO:
-            indent4(depth);
-            printf("goto ");
-            print_ast_expression(statement->goto_statement.label, 0);
-            printf(";\n");
+            indent4(depth, file);
+            fprintf(file, "goto ");
+            print_ast_expression(statement->goto_statement.label, 0, file);
+            fprintf(file, ";\n");
             break;
         case STMT_IF:
-            indent4(depth);
-            printf("if (");
-            print_ast_expression(statement->if_statement.condition, 0);
-            printf(")\n");
-            print_ast_statement(statement->if_statement.then_statement, depth + 1);
+            indent4(depth, file);
+            fprintf(file, "if (");
+            print_ast_expression(statement->if_statement.condition, 0, file);
+            fprintf(file, ")\n");
+            print_ast_statement(statement->if_statement.then_statement, depth + 1, file);
             if (statement->if_statement.else_statement) {
-                indent4(depth);
-                printf("else\n");
-                print_ast_statement(statement->if_statement.else_statement, depth + 1);
+                indent4(depth, file);
+                fprintf(file, "else\n");
+                print_ast_statement(statement->if_statement.else_statement, depth + 1, file);
             }
             break;
         case STMT_COMPOUND:
-            print_ast_block(statement->compound, depth);
+            print_ast_block(statement->compound, depth, file);
             break;
         case STMT_BREAK:
-            indent4(depth);
-            printf("break;\n");
+            indent4(depth, file);
+            fprintf(file, "break;\n");
             break;
         case STMT_CONTINUE:
-            indent4(depth);
-            printf("continue;\n");
+            indent4(depth, file);
+            fprintf(file, "continue;\n");
             break;
         case STMT_DOWHILE:
-            indent4(depth);
-            printf("do\n");
-            print_ast_statement(statement->while_or_do_statement.body, depth + 1);
-            indent4(depth);
-            printf("while (");
-            print_ast_expression(statement->while_or_do_statement.condition, 0);
-            printf(" )");
+            indent4(depth, file);
+            fprintf(file, "do\n");
+            print_ast_statement(statement->while_or_do_statement.body, depth + 1, file);
+            indent4(depth, file);
+            fprintf(file, "while (");
+            print_ast_expression(statement->while_or_do_statement.condition, 0, file);
+            fprintf(file, " )");
             break;
         case STMT_FOR:
-            indent4(depth);
-            printf("for (");
-            print_ast_forinit(statement->for_statement.init);
-            printf(" ; ");
-            print_ast_expression(statement->for_statement.condition, 0);
-            printf(" ; ");
-            print_ast_expression(statement->for_statement.post, 0);
-            printf(" )\n");
-            print_ast_statement(statement->for_statement.body, depth + 1);
+            indent4(depth, file);
+            fprintf(file, "for (");
+            print_ast_forinit(statement->for_statement.init, file);
+            fprintf(file, " ; ");
+            print_ast_expression(statement->for_statement.condition, 0, file);
+            fprintf(file, " ; ");
+            print_ast_expression(statement->for_statement.post, 0, file);
+            fprintf(file, " )\n");
+            print_ast_statement(statement->for_statement.body, depth + 1, file);
             break;
         case STMT_SWITCH:
-            indent4(depth);
-            printf("switch (");
-            print_ast_expression(statement->switch_statement.expression, 0);
-            printf(")\n");
-            print_ast_statement(statement->switch_statement.body, depth + 1);
+            indent4(depth, file);
+            fprintf(file, "switch (");
+            print_ast_expression(statement->switch_statement.expression, 0, file);
+            fprintf(file, ")\n");
+            print_ast_statement(statement->switch_statement.body, depth + 1, file);
             break;
         case STMT_WHILE:
-            indent4(depth);
-            printf("while (");
-            print_ast_expression(statement->while_or_do_statement.condition, 0);
-            printf(")\n");
-            print_ast_statement(statement->while_or_do_statement.body, depth + 1);
+            indent4(depth, file);
+            fprintf(file, "while (");
+            print_ast_expression(statement->while_or_do_statement.condition, 0, file);
+            fprintf(file, ")\n");
+            print_ast_statement(statement->while_or_do_statement.body, depth + 1, file);
             break;
     }
 }
@@ -229,65 +229,65 @@ static int expression_needs_parens(const struct CExpression *pExpression) {
     return 0;
 }
 
-static void print_ast_expression(const struct CExpression *expression, int depth) {
+static void print_ast_expression(const struct CExpression *expression, int depth, FILE *file) {
     if (!expression) return;
     int needs_parens;
     int has_binop;
     switch (expression->kind) {
         case AST_EXP_CONST:
-            printf("%d", expression->literal.int_val);
+            fprintf(file, "%d", expression->literal.int_val);
             break;
         case AST_EXP_UNOP:
             // Is the target of the unary operator a binop operation? If so, parenthesize.
             has_binop = expression->unary.operand->kind == AST_EXP_BINOP;
-            printf("%s", AST_UNARY_NAMES[expression->unary.op]);
-            if (has_binop) { printf("("); }
-            print_ast_expression(expression->unary.operand, depth + 1);
-            if (has_binop) { printf(")"); }
+            fprintf(file, "%s", AST_UNARY_NAMES[expression->unary.op]);
+            if (has_binop) { fprintf(file, "("); }
+            print_ast_expression(expression->unary.operand, depth + 1, file);
+            if (has_binop) { fprintf(file, ")"); }
             break;
         case AST_EXP_BINOP:
             needs_parens = expression_needs_parens(expression);
-            if (needs_parens) printf("(");
-            print_ast_expression(expression->binop.left, depth + 1);
-            printf(" %s ", AST_BINARY_NAMES[expression->binop.op]);
-            print_ast_expression(expression->binop.right, depth + 1);
-            if (needs_parens) printf(")");
+            if (needs_parens) fprintf(file, "(");
+            print_ast_expression(expression->binop.left, depth + 1, file);
+            fprintf(file, " %s ", AST_BINARY_NAMES[expression->binop.op]);
+            print_ast_expression(expression->binop.right, depth + 1, file);
+            if (needs_parens) fprintf(file, ")");
             break;
         case AST_EXP_VAR:
-            printf("%s", expression->var.source_name);
+            fprintf(file, "%s", strpool_str(expression->var.source_name));
             break;
         case AST_EXP_ASSIGNMENT:
-            if (depth > 0) { printf("("); }
-            print_ast_expression(expression->assign.dst, depth + 1);
-            printf(" = ");
-            print_ast_expression(expression->assign.src, depth + 1);
-            if (depth > 0) { printf(")"); }
+            if (depth > 0) { fprintf(file, "("); }
+            print_ast_expression(expression->assign.dst, depth + 1, file);
+            fprintf(file, " = ");
+            print_ast_expression(expression->assign.src, depth + 1, file);
+            if (depth > 0) { fprintf(file, ")"); }
             break;
         case AST_EXP_INCREMENT:
             if (expression->increment.op == AST_PRE_INCR || expression->increment.op == AST_PRE_DECR) {
-                printf("%s", (expression->increment.op == AST_PRE_INCR) ? "++" : "--");
+                fprintf(file, "%s", (expression->increment.op == AST_PRE_INCR) ? "++" : "--");
             }
-            print_ast_expression(expression->increment.operand, depth + 1);
+            print_ast_expression(expression->increment.operand, depth + 1, file);
             if (expression->increment.op == AST_POST_INCR || expression->increment.op == AST_POST_DECR) {
-                printf("%s", (expression->increment.op == AST_POST_INCR) ? "++" : "--");
+                fprintf(file, "%s", (expression->increment.op == AST_POST_INCR) ? "++" : "--");
             }
             break;
         case AST_EXP_CONDITIONAL:
-            printf("(");
-            print_ast_expression(expression->conditional.left_exp, depth + 1);
-            printf(" ? ");
-            print_ast_expression(expression->conditional.middle_exp, depth + 1);
-            printf(" : ");
-            print_ast_expression(expression->conditional.right_exp, depth + 1);
-            printf(")");
+            fprintf(file, "(");
+            print_ast_expression(expression->conditional.left_exp, depth + 1, file);
+            fprintf(file, " ? ");
+            print_ast_expression(expression->conditional.middle_exp, depth + 1, file);
+            fprintf(file, " : ");
+            print_ast_expression(expression->conditional.right_exp, depth + 1, file);
+            fprintf(file, ")");
             break;
         case AST_EXP_FUNCTION_CALL:
-            printf("%s(", expression->function_call.func.source_name);
+            fprintf(file, "%s(", strpool_str(expression->function_call.func.source_name));
             for (int ix=0; ix<expression->function_call.args.num_items; ix++) {
-                if (ix > 0) printf(", ");
-                print_ast_expression(expression->function_call.args.items[ix], depth + 1);
+                if (ix > 0) fprintf(file, ", ");
+                print_ast_expression(expression->function_call.args.items[ix], depth + 1, file);
             }
-            printf(")");
+            fprintf(file, ")");
             break;
     }
 }
@@ -5,6 +5,8 @@
 #ifndef BCC_PRINT_AST_H
 #define BCC_PRINT_AST_H
 
-extern void c_program_print(const struct CProgram *program);
+#include <stdio.h>
+
+extern void c_program_print(const struct CProgram *program, FILE *file);
 
 #endif //BCC_PRINT_AST_H
@@ -3,6 +3,16 @@
 //
 // Created by Bill Evans on 11/19/24.
 //
+// Semantic analysis visits each function once. As it goes, it
+// - resolves identifiers: gives every local variable and label a unique name, and maps each use of a name
+//   to the declaration it refers to,
+// - labels loops and switches: gives each a "flow id", and marks every break, continue, case and default
+//   with the flow id of the statement it belongs to, and
+// - type checks: enters every declaration in the symbol table, and checks every use of an identifier
+//   against it.
+// A goto may jump forward to a label not yet seen, so gotos are set aside as they are visited, and resolved
+// once the whole function has been.
+//
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -13,186 +23,126 @@
 #include "idtable.h"
 #include "symtable.h"
 #include "../utils/startup.h"
+#include "../utils/trace.h"
 
 struct LoopLabelContext {
     struct CStatement *enclosing_switch;
     int enclosing_break_id;
     int enclosing_continue_id;
 };
+// The enclosing break or continue id outside of any loop or switch. Flow ids come from next_uniquifier(),
+// which may give 0 to the first loop of the file.
+#define NO_FLOW_ID (-1)
+
+/*
+ * Expressions and statements are walked with explicit stacks rather than by recursion, so that no nesting,
+ * however deep, can exhaust the C stack. What a node encloses is pushed last first, so it is visited in
+ * source order.
+ */
+static struct list_of_CExpression expression_stack;
+
+/*
+ * Pending work of analyze_body(): a statement to be analyzed in a context, a block-scope declaration, or the
+ * end of a scope, whose id context is then popped.
+ */
+enum ANALYZE_WORK_KIND {
+    WORK_STATEMENT,
+    WORK_DECLARATION,
+    WORK_END_SCOPE,
+};
+struct AnalyzeWork {
+    enum ANALYZE_WORK_KIND kind;
+    union {
+        struct CStatement *statement;
+        struct CDeclaration *declaration;
+    };
+    struct LoopLabelContext context;    // WORK_STATEMENT
+};
+LIST_OF_ITEM_DECL(list_of_analyze_work, struct AnalyzeWork)
+LIST_OF_ITEM_DEFN_STATIC(list_of_analyze_work, struct AnalyzeWork, LIST_OF_NO_DELETE)
+static struct list_of_analyze_work analyze_work;
 
+// The goto statements of the function being analyzed, resolved when the function's labels are all known.
+LIST_OF_ITEM_DECL(list_of_goto, const struct CStatement*)
+LIST_OF_ITEM_DEFN_STATIC(list_of_goto, const struct CStatement*, LIST_OF_NO_DELETE)
+static struct list_of_goto pending_gotos;
 
 static void analyze_function(struct CFuncDecl *function);
-static void resolve_file_scope_vardecl(struct CDeclaration *decl);
-static void resolve_expression(struct CExpression *exp);
-static void resolve_forinit(struct CForInit *for_init);
-
-static void resolve_block(const struct CBlock *block);
-static void resolve_statement(const struct CStatement *statement);
-static void resolve_goto(const struct CStatement *statement);
-static void resolve_vardecl(struct CVarDecl *vardecl);
-static void resolve_funcdecl(struct CFuncDecl *function);
-static void label_block_loops(const struct CBlock *block, struct LoopLabelContext context);
-static void label_statement_loops(struct CStatement *statement, struct LoopLabelContext context);
-
-static void typecheck_program(const struct CProgram *program);
-static void typecheck_function(struct CFuncDecl *function);
+static void analyze_body(const struct CBlock *body, struct LoopLabelContext context);
+static void push_block_items(const struct CBlock *block, struct LoopLabelContext context);
+static void push_statement(struct CStatement *statement, struct LoopLabelContext context);
+static void analyze_block_declaration(struct CDeclaration *declaration);
+static void analyze_statement(struct CStatement *statement, struct LoopLabelContext context);
+static void analyze_statement_labels(struct CStatement *statement, struct LoopLabelContext context);
+static void analyze_forinit(struct CForInit *for_init);
+static void analyze_vardecl(struct CVarDecl *vardecl);
+static void analyze_expression(struct CExpression *exp);
+static void resolve_gotos(int first);
+
+static void typecheck_funcdecl(struct CFuncDecl *function);
 static void typecheck_file_scope_vardecl(struct CVarDecl *vardecl);
-static void typecheck_block(struct CBlock* block);
-static void typecheck_statement(const struct CStatement *statement);
-static void typecheck_block_scope_vardecl(struct CVarDecl *vardecl);
-static void typecheck_expression(struct CExpression *exp);
+
+static void initialize_semantics(void) {
+    static int initialized = 0;
+    if (!initialized) {
+        list_of_CExpression_init(&expression_stack, 64);
+        list_of_analyze_work_init(&analyze_work, 64);
+        list_of_goto_init(&pending_gotos, 16);
+        initialized = 1;
+    } else {
+        list_of_CExpression_clear(&expression_stack);
+        list_of_analyze_work_clear(&analyze_work);
+        list_of_goto_clear(&pending_gotos);
+    }
+}
 
 void semantic_analysis(const struct CProgram *program) {
+    initialize_semantics();
     symtab_init();
     for (int ix=0; ix<program->declarations.num_items; ix++) {
-        struct CDeclaration *decl = program->declarations.items[ix];
-        switch (decl->decl_kind) {
-            case FUNC_DECL:
-                analyze_function(decl->func);
-                break;
-            case VAR_DECL:
-                resolve_file_scope_vardecl(decl);
-                break;
-        }
+        semantic_analysis_declaration(program->declarations.items[ix]);
     }
-    typecheck_program(program);
-}
-
-//region uniquify and resolve
-static void resolve_file_scope_vardecl(struct CDeclaration *decl) {
-    if (!decl) return;
-    struct CVarDecl *vardecl = decl->var;
-    vardecl->var.name =  add_identifier(IDENTIFIER_ID, vardecl->var.source_name, true /*has_linkage*/);
 }
 
-static void analyze_function(struct CFuncDecl *function) {
-    if (!function) return;
-    resolve_funcdecl(function);
-    if (function->body) {
-        label_block_loops(function->body, (struct LoopLabelContext) {0});
-    }
+/**
+ * Begins the semantic analysis of a program one file-scope declaration at a time.
+ */
+void semantic_analysis_begin(void) {
+    initialize_semantics();
+    symtab_init();
 }
 
-static void resolve_block(const struct CBlock *block) {
-    for (int ix = 0; ix < block->items.num_items; ix++) {
-        struct CBlockItem *bi = block->items.items[ix];
-        switch( bi->kind ) {
-            case AST_BI_STATEMENT:
-                resolve_statement(bi->statement);
-                break;
-            case AST_BI_DECLARATION:
-                switch (bi->declaration->decl_kind) {
-                    case FUNC_DECL:
-                        if (bi->declaration->func->body) {
-                            failf("Nested function definitions are not supported: %s\n", bi->declaration->func->name);
-                        }
-                        resolve_funcdecl(bi->declaration->func);
-                        if (bi->declaration->func->storage_class == SC_STATIC) {
-                            failf("Block-scope static functions are not supported: %s\n", bi->declaration->func->name);
-                        }
-                        break;
-                    case VAR_DECL:
-                        resolve_vardecl(bi->declaration->var);
-                        break;
-                }
-                break;
-        }
-    }
-    if (block->is_function_block) {
-        for (int ix = 0; ix < block->items.num_items; ix++) {
-            struct CBlockItem *bi = block->items.items[ix];
-            if (bi->kind == AST_BI_STATEMENT) {
-                resolve_goto(bi->statement);
-            }
-        }
+/**
+ * Analyzes the next file-scope declaration of a program. Each declaration is analyzed in turn, so this gives
+ * the same result as semantic_analysis() of the whole program.
+ * @param declaration to be analyzed.
+ */
+void semantic_analysis_declaration(struct CDeclaration *declaration) {
+    switch (declaration->decl_kind) {
+        case FUNC_DECL:
+            analyze_function(declaration->func);
+            break;
+        case VAR_DECL:
+            declaration->var->var.name =  add_identifier(IDENTIFIER_ID, declaration->var->var.source_name, true /*has_linkage*/);
+            typecheck_file_scope_vardecl(declaration->var);
+            break;
     }
 }
 
-static const char *resolve_label(const char *source_name) {
+//region analyze
+static uint32_t resolve_label(uint32_t source_name) {
     return lookup_identifier(IDENTIFIER_LABEL, source_name, NULL, NULL);
 }
 
-static const char *resolve_var(const char *source_name) {
+static uint32_t resolve_var(uint32_t source_name) {
     return lookup_identifier(IDENTIFIER_ID, source_name, NULL, NULL);
 }
 
-static void resolve_expression(struct CExpression *exp) {
-    if (!exp) return;
-    const char *mapped_name;
-    switch (exp->kind) {
-        case AST_EXP_CONST:
-            break;
-        case AST_EXP_UNOP:
-            resolve_expression(exp->unary.operand);
-            break;
-        case AST_EXP_BINOP:
-            resolve_expression(exp->binop.left);
-            resolve_expression(exp->binop.right);
-            break;
-        case AST_EXP_VAR:
-            mapped_name = resolve_var(exp->var.source_name);
-            if (!mapped_name) {
-                printf("Error: %s has not been declared\n", exp->var.source_name);
-                exit(1);
-            }
-            if (traceResolution) {
-                printf("resolving %s as %s\n", exp->var.name, mapped_name);
-            }
-            exp->var.name = mapped_name;
-            break;
-        case AST_EXP_ASSIGNMENT:
-            if (exp->assign.dst->kind != AST_EXP_VAR) {
-                printf("Error in assignment; invalid lvalue\n");
-                exit(1);
-            }
-            mapped_name = resolve_var(exp->assign.dst->var.source_name);
-            if (!mapped_name) {
-                printf("Error: %s has not been declared\n", exp->assign.dst->var.source_name);
-                exit(1);
-            }
-            if (traceResolution) {
-                printf("resolving %s as %s\n", exp->assign.dst->var.name, mapped_name);
-            }
-            exp->assign.dst->var.name = mapped_name;
-            resolve_expression(exp->assign.src);
-            break;
-        case AST_EXP_INCREMENT:
-            if (exp->increment.operand->kind != AST_EXP_VAR) {
-                printf("Error in increment/decrement; invalid lvalue\n");
-                exit(1);
-            }
-            mapped_name = resolve_var(exp->increment.operand->var.source_name);
-            if (!mapped_name) {
-                printf("Error: %s has not been declared\n", exp->increment.operand->var.source_name);
-                exit(1);
-            }
-            if (traceResolution) {
-                printf("resolving %s as %s\n", exp->increment.operand->var.name, mapped_name);
-            }
-            exp->increment.operand->var.name = mapped_name;
-            break;
-        case AST_EXP_CONDITIONAL:
-            resolve_expression(exp->conditional.left_exp);
-            resolve_expression(exp->conditional.middle_exp);
-            resolve_expression(exp->conditional.right_exp);
-            break;
-        case AST_EXP_FUNCTION_CALL:
-            mapped_name = resolve_var(exp->function_call.func.source_name);
-            if (!mapped_name) {
-                printf("Error: function %s has not been declared\n", exp->function_call.func.name);
-                exit(1);
-            }
-            exp->function_call.func.name = mapped_name;
-            for (int ix = 0; ix < exp->function_call.args.num_items; ix++) {
-                resolve_expression(exp->function_call.args.items[ix]);
-            }
-            break;
-    }
-}
-
-static void resolve_funcdecl(struct CFuncDecl *function) {
+static void analyze_function(struct CFuncDecl *function) {
+    if (!function) return;
     // Doesn't decorate, just makes sure it doesn't collide with a non-extern.
     add_identifier(IDENTIFIER_ID, function->name, true /*has_linkage*/);
+    typecheck_funcdecl(function);
 
     if (function->body) {
         // Any parameters are in the same scope as function block declarations, so push a new id context,
@@ -201,265 +151,181 @@ static void resolve_funcdecl(struct CFuncDecl *function) {
         for (int ix = 0; ix < function->params.num_items; ix++) {
             struct CIdentifier *var = &function->params.items[ix];
             var->name =  add_identifier(IDENTIFIER_ID, var->source_name, false /*has_linkage*/);
+            // Add decorated param names to symbol table. They've been uniquified, so no collisions.
+            add_symbol(symbol_new_local_var(*var));
         }
-        resolve_block(function->body);
+        int first_goto = pending_gotos.num_items;
+        analyze_body(function->body, (struct LoopLabelContext) {.enclosing_break_id = NO_FLOW_ID,
+                                                                .enclosing_continue_id = NO_FLOW_ID});
+        resolve_gotos(first_goto);
         pop_id_context();
     }
 }
 
 /**
- *
- * @param vardecl
+ * Analyzes the body of a function, and everything in it. The statements and declarations are taken from a
+ * work stack, to which each statement pushes those it encloses, so no depth of nesting recurses. They are
+ * still analyzed in source order.
+ * @param body of the function.
+ * @param context of the body, outside any loop or switch.
  */
-static void resolve_vardecl(struct CVarDecl *vardecl) {
-    if (!vardecl) return;
-    bool has_linkage = false;
-    bool current_scope = false;
-    if (lookup_identifier(IDENTIFIER_ID, vardecl->var.source_name, &has_linkage, &current_scope) != NULL) {
-        if (current_scope && !(has_linkage && vardecl->storage_class==SC_EXTERN)) {
-            failf("Error: variable \"%s\" has conflicting local declarations.", vardecl->var.source_name);
+static void analyze_body(const struct CBlock *body, struct LoopLabelContext context) {
+    int base = analyze_work.num_items;
+    push_block_items(body, context);
+    while (analyze_work.num_items > base) {
+        struct AnalyzeWork work = list_of_analyze_work_pop(&analyze_work);
+        switch (work.kind) {
+            case WORK_STATEMENT:
+                analyze_statement(work.statement, work.context);
+                break;
+            case WORK_DECLARATION:
+                analyze_block_declaration(work.declaration);
+                break;
+            case WORK_END_SCOPE:
+                pop_id_context();
+                break;
         }
     }
-    vardecl->var.name =  add_identifier(IDENTIFIER_ID, vardecl->var.source_name, vardecl->storage_class==SC_EXTERN);
-    // Update the initializer, if there is one.
-    if (vardecl->initializer) {
-        resolve_expression(vardecl->initializer);
-    }
 }
 
-static void resolve_forinit(struct CForInit *for_init) {
-    if (!for_init) return;
-    if (for_init->kind == FOR_INIT_DECL) {
-        assert(for_init->declaration->decl_kind == VAR_DECL);
-        resolve_vardecl(for_init->declaration->var);
-        if (for_init->declaration->var->storage_class != SC_NONE) {
-            failf("Error: unexpected storage class for for-init declaration: %s", for_init->declaration->var->var.name);
+// Pushes the items of a block, last first, so that they are analyzed in order.
+static void push_block_items(const struct CBlock *block, struct LoopLabelContext context) {
+    for (int ix = block->items.num_items - 1; ix >= 0; ix--) {
+        struct CBlockItem *bi = block->items.items[ix];
+        if (bi->kind == AST_BI_STATEMENT) {
+            push_statement(bi->statement, context);
+        } else {
+            list_of_analyze_work_append(&analyze_work, (struct AnalyzeWork){.kind = WORK_DECLARATION,
+                                                                            .declaration = bi->declaration});
         }
-    } else {
-        resolve_expression(for_init->expression);
     }
 }
 
-static void resolve_statement(const struct CStatement *statement) {
+static void push_statement(struct CStatement *statement, struct LoopLabelContext context) {
     if (!statement) return;
-    if (c_statement_has_labels(statement)) {
-        int num_labels = c_statement_num_labels(statement);
-        struct CLabel *labels = c_statement_get_labels(statement);
-        for (int i=0; i<num_labels; ++i) {
-            if (labels[i].kind == LABEL_DECL) {
-                struct CIdentifier *var = &labels[i].identifier;
-                var->name =  add_identifier(IDENTIFIER_LABEL, var->source_name, false /*has_linkage*/);
-            }
-        }
-    }
-    switch (statement->kind) {
-        case STMT_RETURN:
-        case STMT_AUTO_RETURN:
-            resolve_expression(statement->expression);
-            break;
-        case STMT_EXP:
-            resolve_expression(statement->expression);
-            break;
-        case STMT_NULL:
-            break;
-        case STMT_IF:
-            resolve_expression(statement->if_statement.condition);
-            resolve_statement(statement->if_statement.then_statement);
-            resolve_statement(statement->if_statement.else_statement);
-            break;
-        case STMT_GOTO:
-            // Not handled here; separate pass, after all labels in function have been found.
-            break;
-        case STMT_COMPOUND:
-            push_id_context(0);
-            resolve_block(statement->compound);
-            pop_id_context();
-            break;
-        case STMT_BREAK:
-        case STMT_CONTINUE:
-            break;
-        case STMT_FOR:
-            push_id_context(0);
-            resolve_forinit(statement->for_statement.init);
-            resolve_expression(statement->for_statement.condition);
-            resolve_expression(statement->for_statement.post);
-            resolve_statement(statement->for_statement.body);
-            pop_id_context();
-            break;
-        case STMT_SWITCH:
-            resolve_expression(statement->switch_statement.expression);
-            resolve_statement(statement->switch_statement.body);
-            break;
-        case STMT_WHILE:
-        case STMT_DOWHILE:
-            resolve_expression(statement->while_or_do_statement.condition);
-            resolve_statement(statement->while_or_do_statement.body);
-            break;
-    }
+    list_of_analyze_work_append(&analyze_work, (struct AnalyzeWork){.kind = WORK_STATEMENT, .statement = statement,
+                                                                    .context = context});
 }
-//endregion
 
-//region resolve gotos
-/**
- * Matches "goto" statements with their target labels.
- *
- * Searches the AST for goto statements, and matches them with their previously-uniquified
- * label. Unique names were generated for all statement labels in "resolve_statement".
- * 
- * @param statement A statement which may BE a goto, or may CONTAIN a goto.
- */
-static void resolve_goto(const struct CStatement *statement) {
-    const char *mapped_name;
-    switch (statement->kind) {
-        case STMT_RETURN:
-        case STMT_AUTO_RETURN:
-        case STMT_EXP:
-        case STMT_BREAK:
-        case STMT_CONTINUE:
-        case STMT_NULL:
-            break;
-        case STMT_IF:
-            resolve_goto(statement->if_statement.then_statement);
-            if (statement->if_statement.else_statement) {
-                resolve_goto(statement->if_statement.else_statement);
-            }
-            break;
-        case STMT_GOTO:
-            mapped_name = resolve_label(statement->goto_statement.label->var.source_name);
-            if (!mapped_name) {
-                printf("Error: identifier \"%s\" has not been declared\n", statement->goto_statement.label->var.source_name);
-                exit(1);
-            }
-            statement->goto_statement.label->var.name = mapped_name;
-            if (traceResolution) {
-                printf("Resolving identifier \"%s\" as \"%s\"\n", statement->goto_statement.label->var.source_name,
-                       mapped_name);
+// Pushes the end of a scope opened with push_id_context(), to be popped once what was pushed after it is done.
+static void push_end_scope(void) {
+    list_of_analyze_work_append(&analyze_work, (struct AnalyzeWork){.kind = WORK_END_SCOPE});
+}
+
+static void analyze_block_declaration(struct CDeclaration *declaration) {
+    switch (declaration->decl_kind) {
+        case FUNC_DECL:
+            if (declaration->func->body) {
+                failf("Nested function definitions are not supported: %s\n", strpool_str(declaration->func->name));
             }
-            break;
-        case STMT_COMPOUND:
-            for (int ix = 0; ix < statement->compound->items.num_items; ix++) {
-                struct CBlockItem *bi = statement->compound->items.items[ix];
-                if (bi->kind == AST_BI_STATEMENT) {
-                    resolve_goto(bi->statement);
-                }
+            add_identifier(IDENTIFIER_ID, declaration->func->name, true /*has_linkage*/);
+            if (declaration->func->storage_class == SC_STATIC) {
+                failf("Block-scope static functions are not supported: %s\n", strpool_str(declaration->func->name));
             }
+            typecheck_funcdecl(declaration->func);
             break;
-        case STMT_WHILE:
-        case STMT_DOWHILE:
-            resolve_goto(statement->while_or_do_statement.body);
-            break;
-        case STMT_FOR:
-            resolve_goto(statement->for_statement.body);
-            break;
-        case STMT_SWITCH:
-            resolve_goto(statement->switch_statement.body);
+        case VAR_DECL:
+            analyze_vardecl(declaration->var);
             break;
     }
 }
-//endregion
-
-//region resolve loops & switches
-/**
- * For every statement in a block, label the loops, switches, breaks, continues, and cases associated with
- * the statement and any enclosed statements. (NB: doesn't include ordinary statement labels, like "exit:").
- *
- * @param block The block to process.
- * @param context The enclosing switch/loop context (flow ids of enclosing switches and loops).
- */
-static void label_block_loops(const struct CBlock *block, struct LoopLabelContext context) {
-    for (int ix = 0; ix < block->items.num_items; ix++) {
-        struct CBlockItem *bi = block->items.items[ix];
-        if (bi->kind == AST_BI_STATEMENT) {
-            label_statement_loops(bi->statement, context);
-        }
-    }
-}
 
 /**
- * Label loops and switch cases for a statement.
+ * Analyzes a statement, and pushes any statements it contains, to be analyzed next.
  *
  * Assigns a "flow id" to every loop and switch statement. These ids are used to generate unique
  * branch labels needed by "break" and "continue" statements, and for "case X:" and "default:" labels
- * in a switch statement.
- *
- * If the given statement is a loop or switch, assign it a new flow id, then examine the associated
- * body and mark break and continue statements and case labels with the flow id.
- *
- * If the given statement is a break or continue, mark it with the enclosing loop or switch statement's
- * flow id.
- *
- * If the statement as child statements (eg, if/else, blocks), handle them recursively.
- *
- * For any "case X:" or "default:" labels attached to the statement, mark those labels with the flow id
- * of the enclosing switch statement.
+ * in a switch statement. The body of a loop or switch is pushed with a context with the new flow id,
+ * so that its break and continue statements and case labels are marked with it.
  *
  * Later, when generating TACKY IR, the flow ids will be used to deterministicly create unique labels.
  *
- * @param statement to be labelled.
+ * @param statement to be analyzed.
  * @param context A context describing the enclosing scope(s). In particular this contains the flow id
  *          of any loop or switch enclosing the statement. So, if this statement is a "break", it will
  *          be marked with the flow id of the enclosing loop or switch.
  */
-static void label_statement_loops(struct CStatement *statement, struct LoopLabelContext context) {
-    if (!statement) return;
+static void analyze_statement(struct CStatement *statement, struct LoopLabelContext context) {
     int flow_id;
     struct LoopLabelContext new_context = context;
-    struct CStatement *body;
+    analyze_statement_labels(statement, context);
 
     switch (statement->kind) {
+        case STMT_RETURN:
+        case STMT_AUTO_RETURN:
+        case STMT_EXP:
+            analyze_expression(statement->expression);
+            break;
+        case STMT_NULL:
+            break;
+        case STMT_IF:
+            analyze_expression(statement->if_statement.condition);
+            push_statement(statement->if_statement.else_statement, context);
+            push_statement(statement->if_statement.then_statement, context);
+            break;
+        case STMT_GOTO:
+            // Resolved once all the labels in the function have been found.
+            list_of_goto_append(&pending_gotos, statement);
+            break;
+        case STMT_COMPOUND:
+            push_id_context(0);
+            push_end_scope();
+            push_block_items(statement->compound, context);
+            break;
         case STMT_BREAK:
-            if (!context.enclosing_break_id) {
+            if (context.enclosing_break_id == NO_FLOW_ID) {
                 printf("Error: break statement outside of loop\n");
                 exit(1);
             }
             c_statement_set_flow_id(statement, context.enclosing_break_id);
             break;
         case STMT_CONTINUE:
-            if (!context.enclosing_continue_id) {
+            if (context.enclosing_continue_id == NO_FLOW_ID) {
                 printf("Error: continue statement outside of loop\n");
                 exit(1);
             }
             c_statement_set_flow_id(statement, context.enclosing_continue_id);
             break;
-
+        case STMT_FOR:
+            // The for-init declaration is in a scope of its own, around the body.
+            push_id_context(0);
+            push_end_scope();
+            analyze_forinit(statement->for_statement.init);
+            analyze_expression(statement->for_statement.condition);
+            analyze_expression(statement->for_statement.post);
+            flow_id = next_uniquifier();
+            c_statement_set_flow_id(statement, flow_id);
+            new_context.enclosing_break_id = flow_id;
+            new_context.enclosing_continue_id = flow_id;
+            push_statement(statement->for_statement.body, new_context);
+            break;
         case STMT_WHILE:
         case STMT_DOWHILE:
-            body = statement->while_or_do_statement.body;
-        label_loop_body:
+            analyze_expression(statement->while_or_do_statement.condition);
             flow_id = next_uniquifier();
             c_statement_set_flow_id(statement, flow_id);
             new_context.enclosing_break_id = flow_id;
             new_context.enclosing_continue_id = flow_id;
-            label_statement_loops(body, new_context);
+            push_statement(statement->while_or_do_statement.body, new_context);
             break;
-        case STMT_FOR:
-            body = statement->for_statement.body;
-            goto label_loop_body;
-
         case STMT_SWITCH:
+            analyze_expression(statement->switch_statement.expression);
             flow_id = next_uniquifier();
             c_statement_set_flow_id(statement, flow_id);
             new_context.enclosing_break_id = flow_id;
             new_context.enclosing_switch = statement;
-            label_statement_loops(statement->switch_statement.body, new_context);
-            break;
-
-        case STMT_IF:
-            label_statement_loops(statement->if_statement.then_statement, context);
-            label_statement_loops(statement->if_statement.else_statement, context);
-            break;
-        case STMT_COMPOUND:
-            label_block_loops(statement->compound, context);
-            break;
-
-        case STMT_GOTO:
-        case STMT_EXP:
-        case STMT_NULL:
-        case STMT_RETURN:
-        case STMT_AUTO_RETURN:
+            push_statement(statement->switch_statement.body, new_context);
             break;
     }
+}
 
+/**
+ * Gives a statement's own labels unique names, and marks its "case X:" and "default:" labels with the flow
+ * id of the enclosing switch.
+ * @param statement whose labels are to be analyzed.
+ * @param context of the statement.
+ */
+static void analyze_statement_labels(struct CStatement *statement, struct LoopLabelContext context) {
     if (c_statement_has_labels(statement)) {
         int num_labels = c_statement_num_labels(statement);
         struct CLabel *labels = c_statement_get_labels(statement);
@@ -485,113 +351,193 @@ static void label_statement_loops(struct CStatement *statement, struct LoopLabel
                 }
                 labels[i].switch_flow_id = context.enclosing_switch->flow_id;
             } else if (labels[i].kind == LABEL_DECL) {
-                // LABEL_DECL is handled completely in IR generation.
+                struct CIdentifier *var = &labels[i].identifier;
+                var->name =  add_identifier(IDENTIFIER_LABEL, var->source_name, false /*has_linkage*/);
             }
         }
     }
 }
-//endregion
 
-//region typecheck
-void typecheck_program(const struct CProgram *program) {
-    for (int ix=0; ix<program->declarations.num_items; ix++) {
-        struct CDeclaration *decl = program->declarations.items[ix];
-        switch (decl->decl_kind) {
-            case FUNC_DECL:
-                typecheck_function(decl->func);
-                break;
-            case VAR_DECL:
-                typecheck_file_scope_vardecl(decl->var);
-                break;
+/**
+ * Matches the "goto" statements of a function with their target labels. Unique names were generated for all
+ * statement labels in analyze_statement_labels().
+ * @param first of the function's gotos in pending_gotos; they are removed.
+ */
+static void resolve_gotos(int first) {
+    for (int ix = first; ix < pending_gotos.num_items; ix++) {
+        const struct CStatement *statement = pending_gotos.items[ix];
+        uint32_t mapped_name = resolve_label(statement->goto_statement.label->var.source_name);
+        if (!mapped_name) {
+            printf("Error: identifier \"%s\" has not been declared\n", strpool_str(statement->goto_statement.label->var.source_name));
+            exit(1);
         }
+        statement->goto_statement.label->var.name = mapped_name;
+        TRACE(TRACE_RESOLUTION, "Resolving identifier \"%s\" as \"%s\"\n", strpool_str(statement->goto_statement.label->var.source_name),
+                   strpool_str(mapped_name));
+    }
+    pending_gotos.num_items = first;
+}
 
+static void analyze_forinit(struct CForInit *for_init) {
+    if (!for_init) return;
+    if (for_init->kind == FOR_INIT_DECL) {
+        assert(for_init->declaration->decl_kind == VAR_DECL);
+        analyze_vardecl(for_init->declaration->var);
+        if (for_init->declaration->var->storage_class != SC_NONE) {
+            failf("Error: unexpected storage class for for-init declaration: %s", strpool_str(for_init->declaration->var->var.name));
+        }
+    } else {
+        analyze_expression(for_init->expression);
     }
 }
-void typecheck_block(struct CBlock* block) {
-    for (int ix = 0; ix < block->items.num_items; ix++) {
-        struct CBlockItem *bi = block->items.items[ix];
-        switch (bi->kind) {
-            case AST_BI_STATEMENT:
-                typecheck_statement(bi->statement);
-                break;
-            case AST_BI_DECLARATION:
-                switch (bi->declaration->decl_kind) {
-                    case FUNC_DECL:
-                        typecheck_function(bi->declaration->func);
-                        break;
-                    case VAR_DECL:
-                        typecheck_block_scope_vardecl(bi->declaration->var);
-                        break;
-                }
-                break;
+
+/**
+ * Analyzes a block-scope variable declaration: gives the variable a unique name, enters it in the symbol
+ * table, and analyzes any initializer, in which the new variable is already visible.
+ * @param vardecl to be analyzed.
+ */
+static void analyze_vardecl(struct CVarDecl *vardecl) {
+    if (!vardecl) return;
+    bool has_linkage = false;
+    bool current_scope = false;
+    if (lookup_identifier(IDENTIFIER_ID, vardecl->var.source_name, &has_linkage, &current_scope) != 0) {
+        if (current_scope && !(has_linkage && vardecl->storage_class==SC_EXTERN)) {
+            failf("Error: variable \"%s\" has conflicting local declarations.", strpool_str(vardecl->var.source_name));
+        }
+    }
+    vardecl->var.name =  add_identifier(IDENTIFIER_ID, vardecl->var.source_name, vardecl->storage_class==SC_EXTERN);
+
+    struct Symbol symbol;
+    if (vardecl->storage_class == SC_EXTERN) {
+        if (vardecl->initializer) {
+            failf("Initializer on local extern variable deckaration: %s", strpool_str(vardecl->var.name));
+        }
+        if (find_symbol(vardecl->var, &symbol) == SYMTAB_OK) {
+            if (!SYMBOL_ATTR_IS_VAR(symbol.attrs)) {
+                failf("Function redeclared as a variable: %s", strpool_str(vardecl->var.name));
+            }
+        } else {
+            symbol = symbol_new_static_var(vardecl->var, SYMBOL_STATIC_NO_INIT|SYMBOL_GLOBAL, 0);
+            add_symbol(symbol);
+        }
+
+    } else if (vardecl->storage_class == SC_STATIC) {
+        int initial_value = 0;
+        if (c_expression_is_const(vardecl->initializer)) {
+            initial_value = vardecl->initializer->literal.int_val;
+        } else if (vardecl->initializer) {
+            failf("Initializer for static variable %s is not a constant expression", strpool_str(vardecl->var.name));
+        }
+        symbol = symbol_new_static_var(vardecl->var, SYMBOL_STATIC_INITIALIZED, initial_value);
+        add_symbol(symbol);
+
+    } else {
+        symbol = symbol_new_local_var(vardecl->var);
+        add_symbol(symbol);
+        if (vardecl->initializer) {
+            analyze_expression(vardecl->initializer);
         }
     }
 }
-void typecheck_expression(struct CExpression *exp) {
+
+/**
+ * Resolves every identifier in an expression to its unique name, and checks it against the symbol table.
+ * @param exp to be analyzed.
+ */
+static void analyze_expression(struct CExpression *exp) {
     if (!exp) return;
+    uint32_t mapped_name;
     struct Symbol symbol;
-    switch (exp->kind) {
-        case AST_EXP_FUNCTION_CALL:
-            if (find_symbol(exp->var, &symbol) == SYMTAB_OK) {
-                if (!(symbol.attrs & SYMBOL_FUNC)) {
-                    failf("Non function used as function: %s", exp->var.name);
+    int base = expression_stack.num_items;
+    list_of_CExpression_append(&expression_stack, exp);
+    while (expression_stack.num_items > base) {
+        exp = list_of_CExpression_pop(&expression_stack);
+        if (!exp) continue;
+        struct CExpression *var = NULL;
+        switch (exp->kind) {
+            case AST_EXP_CONST:
+                // We only have integer constants at this time, so nothing to check.
+                break;
+            case AST_EXP_UNOP:
+                list_of_CExpression_append(&expression_stack, exp->unary.operand);
+                break;
+            case AST_EXP_BINOP:
+                list_of_CExpression_append(&expression_stack, exp->binop.right);
+                list_of_CExpression_append(&expression_stack, exp->binop.left);
+                break;
+            case AST_EXP_VAR:
+                var = exp;
+                break;
+            case AST_EXP_ASSIGNMENT:
+                if (exp->assign.dst->kind != AST_EXP_VAR) {
+                    printf("Error in assignment; invalid lvalue\n");
+                    exit(1);
+                }
+                var = exp->assign.dst;
+                list_of_CExpression_append(&expression_stack, exp->assign.src);
+                break;
+            case AST_EXP_INCREMENT:
+                if (exp->increment.operand->kind != AST_EXP_VAR) {
+                    printf("Error in increment/decrement; invalid lvalue\n");
+                    exit(1);
                 }
-                if (symbol.num_params != exp->function_call.args.num_items) {
-                    failf("Function %s called with %d arguments, but %d expected",
-                           exp->var.name, exp->function_call.args.num_items, symbol.num_params);
+                var = exp->increment.operand;
+                break;
+            case AST_EXP_CONDITIONAL:
+                list_of_CExpression_append(&expression_stack, exp->conditional.right_exp);
+                list_of_CExpression_append(&expression_stack, exp->conditional.middle_exp);
+                list_of_CExpression_append(&expression_stack, exp->conditional.left_exp);
+                break;
+            case AST_EXP_FUNCTION_CALL:
+                mapped_name = resolve_var(exp->function_call.func.source_name);
+                if (!mapped_name) {
+                    printf("Error: function %s has not been declared\n", strpool_str(exp->function_call.func.name));
+                    exit(1);
                 }
-                for (int ix = 0; ix < exp->function_call.args.num_items; ix++) {
-                    typecheck_expression(exp->function_call.args.items[ix]);
+                exp->function_call.func.name = mapped_name;
+                if (find_symbol(exp->var, &symbol) == SYMTAB_OK) {
+                    if (!(symbol.attrs & SYMBOL_FUNC)) {
+                        failf("Non function used as function: %s", strpool_str(exp->var.name));
+                    }
+                    if (symbol.num_params != exp->function_call.args.num_items) {
+                        failf("Function %s called with %d arguments, but %d expected",
+                               strpool_str(exp->var.name), exp->function_call.args.num_items, symbol.num_params);
+                    }
+                } else {
+                    failf("(Internal) Function not found in symbol table: %s", strpool_str(exp->var.name));
                 }
-            } else {
-                failf("(Internal) Function not found in symbol table: %s", exp->var.name);
+                for (int ix = exp->function_call.args.num_items - 1; ix >= 0; ix--) {
+                    list_of_CExpression_append(&expression_stack, exp->function_call.args.items[ix]);
+                }
+                break;
+        }
+        if (var) {
+            // A variable, or the lvalue of an assignment or increment.
+            mapped_name = resolve_var(var->var.source_name);
+            if (!mapped_name) {
+                printf("Error: %s has not been declared\n", strpool_str(var->var.source_name));
+                exit(1);
             }
-            break;
-        case AST_EXP_VAR:
-            if (find_symbol(exp->var, &symbol) == SYMTAB_OK) {
+            TRACE(TRACE_RESOLUTION, "resolving %s as %s\n", strpool_str(var->var.name), strpool_str(mapped_name));
+            var->var.name = mapped_name;
+            if (find_symbol(var->var, &symbol) == SYMTAB_OK) {
                 if (!SYMBOL_ATTR_IS_VAR(symbol.attrs)) {
-                    failf("Non variable used as variable: %s", exp->var.name);
+                    failf("Non variable used as variable: %s", strpool_str(var->var.name));
                 }
             } else {
-                failf("(Internal) Variable not found in symbol table: %s", exp->var.name);
+                failf("(Internal) Variable not found in symbol table: %s", strpool_str(var->var.name));
             }
-            break;
-        case AST_EXP_ASSIGNMENT:
-            typecheck_expression(exp->assign.dst);
-            typecheck_expression(exp->assign.src);
-            break;
-        case AST_EXP_BINOP:
-            typecheck_expression(exp->binop.left);
-            typecheck_expression(exp->binop.right);
-            break;
-        case AST_EXP_CONDITIONAL:
-            typecheck_expression(exp->conditional.left_exp);
-            typecheck_expression(exp->conditional.middle_exp);
-            typecheck_expression(exp->conditional.right_exp);
-            break;
-        case AST_EXP_CONST:
-            // We only have integer constants at this time, so nothing to check.
-            break;
-        case AST_EXP_INCREMENT:
-            typecheck_expression(exp->increment.operand);
-            break;
-        case AST_EXP_UNOP:
-            typecheck_expression(exp->unary.operand);
-            break;
-    }
-}
-void typecheck_forinit(struct CForInit *for_init) {
-    if (!for_init) return;
-    switch (for_init->kind) {
-        case FOR_INIT_DECL:
-            typecheck_block_scope_vardecl(for_init->declaration->var);
-            break;
-        case FOR_INIT_EXPR:
-            typecheck_expression(for_init->expression);
-            break;
+        }
     }
 }
-void typecheck_function(struct CFuncDecl *function) {
+//endregion
+
+//region typecheck
+/**
+ * Enters a function declaration or definition in the symbol table, checking it against any earlier one.
+ * @param function declared.
+ */
+static void typecheck_funcdecl(struct CFuncDecl *function) {
     if (!function) return;
     int num_params = function->params.num_items;
     int has_body = function->body != NULL;
@@ -602,17 +548,17 @@ void typecheck_function(struct CFuncDecl *function) {
     struct Symbol symbol;
     if (find_symbol(function_id, &symbol) == SYMTAB_OK) {
         if (SYMBOL_ATTR_IS_VAR(symbol.attrs)) {
-            failf("Incompatible function/var declarations: %s", function->name);
+            failf("Incompatible function/var declarations: %s", strpool_str(function->name));
         }
         func_defined = SYMBOL_IS_DEFINED(symbol.attrs);
         if (func_defined && has_body) {
-            failf("Function %s already defined", function->name);
+            failf("Function %s already defined", strpool_str(function->name));
         }
         if (num_params != symbol.num_params) {
-            failf("Incompatible function declarations for %s; %d vs %d params", function->name, num_params, symbol.num_params);
+            failf("Incompatible function declarations for %s; %d vs %d params", strpool_str(function->name), num_params, symbol.num_params);
         }
         if (SYMBOL_IS_GLOBAL(symbol.attrs) && function->storage_class == SC_STATIC) {
-            failf("Static function declaration follows non-static: %s", function->name);
+            failf("Static function declaration follows non-static: %s", strpool_str(function->name));
         }
         global = SYMBOL_IS_GLOBAL(symbol.attrs);
     }
@@ -620,16 +566,8 @@ void typecheck_function(struct CFuncDecl *function) {
                                    SYMBOL_DEFINED_IF(func_defined || has_body);
     symbol = symbol_new_func(function_id, function->params.num_items, func_attrs);
     upsert_symbol(symbol);
-    if (has_body) {
-        // Add decorated param names to symbol table. They've been uniquified, so no collisions.
-        for (int ix = 0; ix < function->params.num_items; ix++) {
-            symbol = symbol_new_local_var(function->params.items[ix]);
-            add_symbol(symbol);
-        }
-        typecheck_block(function->body);
-    }
 }
-void typecheck_file_scope_vardecl(struct CVarDecl *vardecl) {
+static void typecheck_file_scope_vardecl(struct CVarDecl *vardecl) {
     if (!vardecl) return;
     // File scope variables have static lifetime. Any initial_value must be a constant expression.
     enum SYMBOL_ATTRS initializer_attrs = SYMBOL_NONE;
@@ -640,7 +578,7 @@ void typecheck_file_scope_vardecl(struct CVarDecl *vardecl) {
             initial_value = vardecl->initializer->literal.int_val;
             initializer_attrs = SYMBOL_STATIC_INITIALIZED;
         } else {
-            failf("Initializer for file scope variable %s is not a constant expression", vardecl->var.name);
+            failf("Initializer for file scope variable %s is not a constant expression", strpool_str(vardecl->var.name));
         }
     } else if (vardecl->storage_class == SC_EXTERN) {
         initializer_attrs = SYMBOL_STATIC_NO_INIT;
@@ -652,7 +590,7 @@ void typecheck_file_scope_vardecl(struct CVarDecl *vardecl) {
     struct Symbol symbol;
     if (find_symbol(vardecl->var, &symbol) == SYMTAB_OK) {
         if (!SYMBOL_ATTR_IS_VAR(symbol.attrs)) {
-            failf("Function redeclared as a variable: %s", vardecl->var.name);
+            failf("Function redeclared as a variable: %s", strpool_str(vardecl->var.name));
         }
 
         if (vardecl->storage_class == SC_EXTERN) {
@@ -660,12 +598,12 @@ void typecheck_file_scope_vardecl(struct CVarDecl *vardecl) {
             global = SYMBOL_IS_GLOBAL(symbol.attrs);
         } else if (SYMBOL_IS_GLOBAL(symbol.attrs) != global) {
             // was-global == is-global ?
-            failf("Incompatible variable linkage for %s", vardecl->var.name);
+            failf("Incompatible variable linkage for %s", strpool_str(vardecl->var.name));
         }
 
         if (symbol.attrs & SYMBOL_STATIC_INITIALIZED) {
             if (initializer_attrs == SYMBOL_STATIC_INITIALIZED) {
-                failf("Conflicting file scope variable definitions for %s", vardecl->var.name);
+                failf("Conflicting file scope variable definitions for %s", strpool_str(vardecl->var.name));
             } else {
                 initializer_attrs = SYMBOL_STATIC_INITIALIZED;
                 initial_value = symbol.int_val;
@@ -678,81 +616,6 @@ void typecheck_file_scope_vardecl(struct CVarDecl *vardecl) {
     symbol = symbol_new_static_var(vardecl->var, attrs, initial_value);
     upsert_symbol(symbol);
 }
-
-void typecheck_statement(const struct CStatement *statement) {
-    if (!statement) return;
-    switch (statement->kind) {
-        case STMT_RETURN:
-        case STMT_AUTO_RETURN:
-            typecheck_expression(statement->expression);
-            break;
-        case STMT_EXP:
-            typecheck_expression(statement->expression);
-            break;
-        case STMT_COMPOUND:
-            typecheck_block(statement->compound);
-            break;
-        case STMT_WHILE:
-        case STMT_DOWHILE:
-            typecheck_expression(statement->while_or_do_statement.condition);
-            typecheck_statement(statement->while_or_do_statement.body);
-            break;
-        case STMT_FOR:
-            typecheck_forinit(statement->for_statement.init);
-            typecheck_expression(statement->for_statement.condition);
-            typecheck_expression(statement->for_statement.post);
-            typecheck_statement(statement->for_statement.body);
-            break;
-        case STMT_IF:
-            typecheck_expression(statement->if_statement.condition);
-            typecheck_statement(statement->if_statement.then_statement);
-            typecheck_statement(statement->if_statement.else_statement);
-            break;
-        case STMT_SWITCH:
-            typecheck_expression(statement->switch_statement.expression);
-            typecheck_statement(statement->switch_statement.body);
-            break;
-        case STMT_BREAK:
-        case STMT_CONTINUE:
-        case STMT_GOTO:
-        case STMT_NULL:
-            break;
-    }
-}
-void typecheck_block_scope_vardecl(struct CVarDecl *vardecl) {
-    if (!vardecl) return;
-    struct Symbol symbol;
-    if (vardecl->storage_class == SC_EXTERN) {
-        if (vardecl->initializer) {
-            failf("Initializer on local extern variable deckaration: %s", vardecl->var.name);
-        }
-        if (find_symbol(vardecl->var, &symbol) == SYMTAB_OK) {
-            if (!SYMBOL_ATTR_IS_VAR(symbol.attrs)) {
-                failf("Function redeclared as a variable: %s", vardecl->var.name);
-            }
-        } else {
-            symbol = symbol_new_static_var(vardecl->var, SYMBOL_STATIC_NO_INIT|SYMBOL_GLOBAL, 0);
-            add_symbol(symbol);
-        }
-
-    } else if (vardecl->storage_class == SC_STATIC) {
-        int initial_value = 0;
-        if (c_expression_is_const(vardecl->initializer)) {
-            initial_value = vardecl->initializer->literal.int_val;
-        } else if (vardecl->initializer) {
-            failf("Initializer for static variable %s is not a constant expression", vardecl->var.name);
-        }
-        symbol = symbol_new_static_var(vardecl->var, SYMBOL_STATIC_INITIALIZED, initial_value);
-        add_symbol(symbol);
-
-    } else {
-        symbol = symbol_new_local_var(vardecl->var);
-        add_symbol(symbol);
-        if (vardecl->initializer) {
-            typecheck_expression(vardecl->initializer);
-        }
-    }
-}
 //endregion
 
 #pragma clang diagnostic pop
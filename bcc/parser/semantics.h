@@ -6,5 +6,7 @@
 #define BCC_SEMANTICS_H
 
 extern void semantic_analysis(const struct CProgram* program);
+extern void semantic_analysis_begin(void);
+extern void semantic_analysis_declaration(struct CDeclaration *declaration);
 
 #endif //BCC_SEMANTICS_H
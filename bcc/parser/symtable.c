@@ -10,20 +10,40 @@
 #include <assert.h>
 #include "idtable.h"
 #include "inc/utils.h"
+#include "inc/set_of.h"
 #include "../utils/startup.h"
 
 LIST_OF_ITEM_DECL(list_of_symbol, struct Symbol)
-struct list_of_symbol_helpers list_of_symbol_helpers = {
-        .delete = symbol_delete,
-        .null = {},
-};
-LIST_OF_ITEM_DEFN(list_of_symbol,struct Symbol)
+LIST_OF_ITEM_DEFN_STATIC(list_of_symbol,struct Symbol,symbol_delete)
 
 
 struct list_of_symbol symbol_table;
 
+/*
+ * Hash index over symbol_table, from the symbol's (interned) name to its position in symbol_table. The
+ * symbols themselves stay in symbol_table, in the order they were added, for get_symbol(ix).
+ */
+struct symbol_index_item {
+    uint32_t name;
+    int ix;
+};
+static inline unsigned long symbol_index_item_hash(struct symbol_index_item item) {
+    return item.name * 2654435761u;
+}
+static inline int symbol_index_item_cmp(struct symbol_index_item l, struct symbol_index_item r) {
+    return (l.name > r.name) - (l.name < r.name);
+}
+static inline int symbol_index_item_is_null(struct symbol_index_item item) {
+    return item.name == 0;
+}
+SET_OF_ITEM_DECL(set_of_symbol_index, struct symbol_index_item)
+SET_OF_ITEM_DEFN_STATIC(set_of_symbol_index, struct symbol_index_item, symbol_index_item_hash, symbol_index_item_cmp,
+                        SET_OF_NO_DUP, SET_OF_NO_DELETE, symbol_index_item_is_null)
+static struct set_of_symbol_index symbol_index;
+
 void symtab_init() {
     list_of_symbol_init(&symbol_table, 1023);
+    set_of_symbol_index_init(&symbol_index, 2047);
     idtable_init();
 }
 
@@ -70,30 +90,55 @@ void symbol_delete(struct Symbol symbol) {
     // no-op
 }
 
-static struct Symbol* find_internal(const char* name) {
-    // TODO: Implement a hash lookup
-    for (int ix=0; ix<symbol_table.num_items; ix++) {
-        struct Symbol* symbol = &symbol_table.items[ix];
-        if (strcmp(symbol->identifier.name, name) == 0) {
-            return symbol;
-        }
+static struct Symbol* find_internal(uint32_t name) {
+    // Nothing to find if the table hasn't been initialized (or is empty).
+    if (symbol_table.num_items == 0) return NULL;
+    struct symbol_index_item key = {.name = name};
+    struct symbol_index_item found;
+    if (!set_of_symbol_index_find(&symbol_index, key, &found)) {
+        return NULL;
     }
-    return NULL;
+    return &symbol_table.items[found.ix];
 }
 
 enum SYMTAB_RESULT add_symbol(struct Symbol symbol) {
     if (find_internal(symbol.identifier.name)) {
         return SYMTAB_DUPLICATE;
     }
+    struct symbol_index_item item = {.name = symbol.identifier.name, .ix = symbol_table.num_items};
     list_of_symbol_append(&symbol_table, symbol);
+    set_of_symbol_index_insert(&symbol_index, item);
     return SYMTAB_OK;;
 }
+/**
+ * Forgets the local (automatic) variables added at or after position first, once the function that declared
+ * them has been compiled; nothing after the function can refer to them. The other symbols keep their order.
+ * @param first the number of symbols before the function was analyzed.
+ */
+void symtab_forget_locals(int first) {
+    int to = first;
+    for (int from = first; from < symbol_table.num_items; from++) {
+        struct Symbol symbol = symbol_table.items[from];
+        struct symbol_index_item key = {.name = symbol.identifier.name};
+        if (symbol.attrs == SYMBOL_LOCAL_VAR) {
+            set_of_symbol_index_remove(&symbol_index, key);
+            continue;
+        }
+        if (to != from) {
+            symbol_table.items[to] = symbol;
+            set_of_symbol_index_lookup(&symbol_index, key)->ix = to;
+        }
+        ++to;
+    }
+    symbol_table.num_items = to;
+}
+
 enum SYMTAB_RESULT find_symbol(struct CIdentifier id, struct Symbol* pResult) {
     struct Symbol* found = find_internal(id.name);
     if (found) *pResult = *found;
     return found ? SYMTAB_OK : SYMTAB_NOTFOUND;
 }
-enum SYMTAB_RESULT find_symbol_by_name(const char *name, struct Symbol* pResult) {
+enum SYMTAB_RESULT find_symbol_by_name(uint32_t name, struct Symbol* pResult) {
     struct Symbol* found = find_internal(name);
     if (found) *pResult = *found;
     return found ? SYMTAB_OK : SYMTAB_NOTFOUND;
@@ -60,8 +60,9 @@ extern void symbol_delete(struct Symbol symbol);
 
 extern enum SYMTAB_RESULT add_symbol(struct Symbol symbol);
 extern enum SYMTAB_RESULT find_symbol(struct CIdentifier id, struct Symbol* found);
-extern enum SYMTAB_RESULT find_symbol_by_name(const char *name, struct Symbol* found);
+extern enum SYMTAB_RESULT find_symbol_by_name(uint32_t name, struct Symbol* found);
 extern enum SYMTAB_RESULT upsert_symbol(struct Symbol symbol);
+extern void symtab_forget_locals(int first);
 
 extern void symtab_init(void);
 
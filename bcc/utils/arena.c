@@ -0,0 +1,110 @@
+//
+// Created by Bill Evans on 10/17/26.
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdalign.h>
+
+#include "inc/arena.h"
+#include "inc/utils.h"
+
+struct arena_block {
+    struct arena_block *prev;
+    size_t size;                    // Usable bytes following this header.
+    alignas(max_align_t) char data[];
+};
+
+#define ARENA_ALIGN (alignof(max_align_t))
+
+/**
+ * Initializes an arena. No memory is allocated until the first arena_alloc().
+ * @param arena to be initialized.
+ * @param block_size size of the blocks from which allocations are carved.
+ */
+void arena_init(struct arena *arena, size_t block_size) {
+    arena->blocks = NULL;
+    arena->next = arena->limit = NULL;
+    arena->block_size = block_size;
+    arena->num_allocs = arena->num_bytes = arena->num_blocks = 0;
+}
+
+static void arena_new_block(struct arena *arena, size_t size) {
+    if (size < arena->block_size) size = arena->block_size;
+    struct arena_block *block = malloc(sizeof(struct arena_block) + size);
+    if (!block) fail("Out of memory");
+    block->prev = arena->blocks;
+    block->size = size;
+    ++arena->num_blocks;
+    arena->blocks = block;
+    arena->next = block->data;
+    arena->limit = block->data + size;
+}
+
+/**
+ * Allocates memory from an arena. The memory is suitably aligned for any type, and is not initialized.
+ * @param arena from which to allocate.
+ * @param size in bytes.
+ * @return the memory.
+ */
+void *arena_alloc(struct arena *arena, size_t size) {
+    size = (size + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+    if ((size_t)(arena->limit - arena->next) < size) {
+        arena_new_block(arena, size);
+    }
+    void *result = arena->next;
+    arena->next += size;
+    ++arena->num_allocs;
+    arena->num_bytes += size;
+    return result;
+}
+
+/**
+ * Allocates zeroed memory from an arena.
+ */
+void *arena_alloc_zero(struct arena *arena, size_t size) {
+    void *result = arena_alloc(arena, size);
+    memset(result, 0, size);
+    return result;
+}
+
+/**
+ * Releases everything allocated from the arena. The arena may be used again.
+ * @param arena to be released.
+ */
+void arena_release(struct arena *arena) {
+    struct arena_block *block = arena->blocks;
+    while (block) {
+        struct arena_block *prev = block->prev;
+        free(block);
+        block = prev;
+    }
+    arena->blocks = NULL;
+    arena->next = arena->limit = NULL;
+    arena->num_allocs = arena->num_bytes = arena->num_blocks = 0;
+}
+
+/**
+ * Releases everything allocated from the arena, but keeps its first block for the allocations that follow,
+ * so that an arena used over and over for small things does not go back to malloc each time.
+ * @param arena to be reset.
+ */
+void arena_reset(struct arena *arena) {
+    struct arena_block *block = arena->blocks;
+    while (block && block->prev) {
+        struct arena_block *prev = block->prev;
+        free(block);
+        block = prev;
+    }
+    // A first block made for one large allocation isn't worth keeping.
+    if (block && block->size != arena->block_size) {
+        free(block);
+        block = NULL;
+    }
+    arena->blocks = block;
+    arena->next = block ? block->data : NULL;
+    arena->limit = block ? block->data + block->size : NULL;
+    arena->num_allocs = arena->num_bytes = 0;
+    arena->num_blocks = block ? 1 : 0;
+}
+
@@ -0,0 +1,187 @@
+//
+// Created by Bill Evans on 10/17/26.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "inc/utils.h"
+
+/*
+ * Probe length and throughput of set_of, for ints (dense and scattered keys) and for strings. Each is run
+ * with the helpers called through function pointers (set_of_int, set_of_str, defined with SET_OF_ITEM_DEFN)
+ * and with the same operations bound statically (defined with SET_OF_ITEM_DEFN_STATIC).
+ */
+static inline unsigned long int_hash(int item) { return (unsigned long)(long)item; }
+static inline int int_cmp(int l, int r) { return r - l; }
+static inline int int_is_null(int item) { return item == 0; }
+SET_OF_ITEM_DECL(set_of_int_static, int)
+SET_OF_ITEM_DEFN_STATIC(set_of_int_static, int, int_hash, int_cmp, SET_OF_NO_DUP, SET_OF_NO_DELETE, int_is_null)
+
+static inline const char *str_dup(const char *item) { return strdup(item); }
+static inline void str_free(const char *item) { free((void *)item); }
+static inline int str_is_null(const char *item) { return item == NULL; }
+SET_OF_ITEM_DECL(set_of_str_static, const char*)
+SET_OF_ITEM_DEFN_STATIC(set_of_str_static, const char*, hash_str, strcmp, str_dup, str_free, str_is_null)
+
+static const int bench_sizes[] = {1000, 10000, 100000, 1000000};
+#define NUM_BENCH_SIZES ((int)(sizeof(bench_sizes)/sizeof(bench_sizes[0])))
+
+/* Key number ix of a run of ints; keys for misses are the ones past the number inserted. */
+static int bench_key(int ix, int scattered) {
+    return scattered ? (int)((unsigned)(ix + 1) * 2654435761u) | 1 : ix + 1;
+}
+
+/* Keys for a run of strings; keys for misses are the ones past the number inserted. */
+static char **bench_str_keys(int n) {
+    char **keys = malloc(n * sizeof(char *));
+    for (int ix = 0; ix < n; ++ix) {
+        char buf[24];
+        sprintf(buf, "tmp.%d", ix);
+        keys[ix] = strdup(buf);
+    }
+    return keys;
+}
+
+static void print_bench_line(const char *what, const char *how, int n, double mean_probe, int max_probe, double ns[4]) {
+    printf("  %-9s %-7s %8d  probe mean %5.2f max %3d  ns/op: insert %6.1f  hit %6.1f  miss %6.1f  remove %6.1f\n",
+           what, how, n, mean_probe, max_probe, ns[0], ns[1], ns[2], ns[3]);
+}
+
+/*
+ * Times inserting n keys into a set of type NAME, finding each of them, finding n keys that aren't there,
+ * and removing the n keys. KEY(ix) is the ix'th key.
+ */
+#define SET_OF_BENCH(NAME, KEY_TYPE, KEY, LABEL, HOW)                                                   \
+    struct NAME set;                                                                                    \
+    double ns[4], t;                                                                                    \
+    KEY_TYPE found;                                                                                     \
+    NAME##_init(&set, 10);                                                                              \
+    t = now_seconds();                                                                                  \
+    for (int ix = 0; ix < n; ++ix) NAME##_insert(&set, KEY(ix));                                        \
+    ns[0] = (now_seconds() - t) * 1e9 / n;                                                              \
+    double mean_probe = 1.0 + (double)set.collisions / set.num_items;                                   \
+    int max_probe = NAME##_max_probe_length(&set);                                                      \
+    t = now_seconds();                                                                                  \
+    for (int ix = 0; ix < n; ++ix) failures += !NAME##_find(&set, KEY(ix), &found);                     \
+    ns[1] = (now_seconds() - t) * 1e9 / n;                                                              \
+    t = now_seconds();                                                                                  \
+    for (int ix = n; ix < 2*n; ++ix) failures += NAME##_find(&set, KEY(ix), &found);                    \
+    ns[2] = (now_seconds() - t) * 1e9 / n;                                                              \
+    t = now_seconds();                                                                                  \
+    for (int ix = 0; ix < n; ++ix) NAME##_remove(&set, KEY(ix));                                        \
+    ns[3] = (now_seconds() - t) * 1e9 / n;                                                              \
+    failures += set.num_items != 0;                                                                     \
+    print_bench_line(LABEL, HOW, n, mean_probe, max_probe, ns);                                         \
+    NAME##_delete(&set)
+
+static int set_of_int_bench(int n, int scattered) {
+    int failures = 0;
+#define INT_KEY(ix) bench_key(ix, scattered)
+    {
+        SET_OF_BENCH(set_of_int, int, INT_KEY, scattered ? "int/rand" : "int/dense", "helpers");
+    }
+    {
+        SET_OF_BENCH(set_of_int_static, int, INT_KEY, scattered ? "int/rand" : "int/dense", "static");
+    }
+#undef INT_KEY
+    return failures;
+}
+
+static int set_of_str_bench(int n) {
+    int failures = 0;
+    char **keys = bench_str_keys(2 * n);
+#define STR_KEY(ix) keys[ix]
+    {
+        SET_OF_BENCH(set_of_str, const char*, STR_KEY, "str", "helpers");
+    }
+    {
+        SET_OF_BENCH(set_of_str_static, const char*, STR_KEY, "str", "static");
+    }
+#undef STR_KEY
+    for (int ix = 0; ix < 2*n; ++ix) free(keys[ix]);
+    free(keys);
+    return failures;
+}
+
+static int set_of_bench(void) {
+    int failures = 0;
+    printf("set_of probe length and throughput:\n");
+    for (int ix = 0; ix < NUM_BENCH_SIZES; ++ix) {
+        failures += set_of_int_bench(bench_sizes[ix], 0);
+        failures += set_of_int_bench(bench_sizes[ix], 1);
+        failures += set_of_str_bench(bench_sizes[ix]);
+    }
+    if (failures) printf("FAIL: %d wrong results in set_of benchmark\n", failures);
+    return failures;
+}
+
+/*
+ * The same small lists of ints, built in a list with a small buffer (list_of_int) and in one without.
+ */
+LIST_OF_ITEM_DECL(list_of_int_heap, int)
+LIST_OF_ITEM_DEFN_STATIC(list_of_int_heap, int, LIST_OF_NO_DELETE)
+#define LIST_BENCH_LISTS 1000000
+#define LIST_BENCH_ITEMS 4
+
+#define LIST_OF_BENCH(NAME, HOW)                                                                        \
+    do {                                                                                                \
+        struct NAME list;                                                                               \
+        long sum = 0;                                                                                   \
+        double t = now_seconds();                                                                       \
+        for (int ix = 0; ix < LIST_BENCH_LISTS; ++ix) {                                                 \
+            NAME##_init(&list, 0);                                                                      \
+            for (int item = 0; item < LIST_BENCH_ITEMS; ++item) NAME##_append(&list, ix + item);        \
+            while (!NAME##_is_empty(&list)) sum += NAME##_pop(&list);                                   \
+            NAME##_delete(&list);                                                                       \
+        }                                                                                               \
+        t = now_seconds() - t;                                                                          \
+        failures += sum != expected_sum;                                                                \
+        printf("  %-12s %d lists of %d: %6.1f ns/list\n", HOW, LIST_BENCH_LISTS, LIST_BENCH_ITEMS,       \
+               t * 1e9 / LIST_BENCH_LISTS);                                                             \
+    } while (0)
+
+/**
+ * Checks that a list with a small buffer keeps its items there until they don't fit, and moves them back on
+ * shrink_to_fit, through append, insert, pop and reserve. Times small lists with and without the small buffer.
+ * @return the number of failures.
+ */
+static int list_of_check(void) {
+    int failures = 0;
+    struct list_of_int list;
+    list_of_int_init(&list, 0);
+    for (int ix = 0; ix < 8; ++ix) list_of_int_append(&list, ix);
+    failures += list.items != list.small;
+    for (int ix = 8; ix < 100; ++ix) list_of_int_append(&list, ix);
+    failures += list.items == list.small || list.num_items != 100;
+    list_of_int_insert(&list, -1, 0);
+    failures += list.items[0] != -1 || list.items[100] != 99;
+    for (int ix = 99; ix >= 2; --ix) failures += list_of_int_pop(&list) != ix;
+    list_of_int_shrink_to_fit(&list);
+    failures += list.items != list.small || list.num_items != 3;
+    list_of_int_reserve(&list, 1000);
+    failures += list.max_num_items < 1000 || list.items[0] != -1 || list.items[1] != 0 || list.items[2] != 1;
+    list_of_int_delete(&list);
+    if (failures) printf("FAIL: %d wrong results from list_of\n", failures);
+
+    printf("list_of small buffer:\n");
+    long expected_sum = 0;
+    for (int ix = 0; ix < LIST_BENCH_LISTS; ++ix) {
+        for (int item = 0; item < LIST_BENCH_ITEMS; ++item) expected_sum += ix + item;
+    }
+    LIST_OF_BENCH(list_of_int, "small buffer");
+    LIST_OF_BENCH(list_of_int_heap, "heap");
+    return failures;
+}
+
+/**
+ * Benchmarks set_of, with its operations bound through helpers and statically, and checks its results, and
+ * those of list_of.
+ * @return the number of failures.
+ */
+int containers_test(void) {
+    int failures = set_of_bench();
+    failures += list_of_check();
+    return test_result("containers", failures);
+}
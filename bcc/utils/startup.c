@@ -8,6 +8,7 @@
 #include <assert.h>
 
 #include "startup.h"
+#include "trace.h"
 
 #define TEST_OPT "--test"
 #define LEX_OPT "--lex"
@@ -20,6 +21,12 @@
 #define NO_LINK_OPT "-c"
 #define PP_ONLY_OPT "-E"
 #define ONAME_OPT "-o"
+#define SCAN_OPT "--scan="
+#define MEM_OPT "--mem"
+#define TRACE_OPT "--trace="
+#define DUMP_AST_OPT "-fdump-ast="
+#define DUMP_IR_OPT "-fdump-ir="
+#define DUMP_ASM_OPT "-fdump-asm="
 
 // if 1, run unit tests.
 int configOptTest = 0;
@@ -40,9 +47,13 @@ int configOptNoAssemble = 0;
 // if 1, don't invoke the linker. "-c"
 int configOptNoLink = 0;
 
-int traceAstMem = 0;
-int traceTokens = 1;
-int traceResolution = 1;
+// Lexer scanning kernels: "auto", "scalar", "sse2", or "avx2". "--scan=kernel"
+char const *configOptScanKernel = NULL;
+
+// Files to receive the AST, IR, and assembly as they are built, or NULL; "-" for stdout. "-fdump-ast=FILE", ...
+char const *configOptDumpAst = NULL;
+char const *configOptDumpIr = NULL;
+char const *configOptDumpAsm = NULL;
 
 // Name of the input file (.c file)
 char const *inputFname;
@@ -146,6 +157,24 @@ static int parseArgs(int argc, char **argv) {
                 // -o oname
                 ++configOptsFound;
                 oFname = argv[++i];
+            } else if (strncmp(argv[i], SCAN_OPT, strlen(SCAN_OPT)) == 0) {
+                // --scan=kernel
+                configOptScanKernel = argv[i] + strlen(SCAN_OPT);
+            } else if (strcmp(argv[i], MEM_OPT) == 0) {
+                // --mem, the same as --trace=mem
+                trace_enable("mem");
+            } else if (strncmp(argv[i], TRACE_OPT, strlen(TRACE_OPT)) == 0) {
+                // --trace=category,...
+                ok = trace_enable(argv[i] + strlen(TRACE_OPT)) && ok;
+            } else if (strncmp(argv[i], DUMP_AST_OPT, strlen(DUMP_AST_OPT)) == 0) {
+                // -fdump-ast=FILE
+                configOptDumpAst = argv[i] + strlen(DUMP_AST_OPT);
+            } else if (strncmp(argv[i], DUMP_IR_OPT, strlen(DUMP_IR_OPT)) == 0) {
+                // -fdump-ir=FILE
+                configOptDumpIr = argv[i] + strlen(DUMP_IR_OPT);
+            } else if (strncmp(argv[i], DUMP_ASM_OPT, strlen(DUMP_ASM_OPT)) == 0) {
+                // -fdump-asm=FILE
+                configOptDumpAsm = argv[i] + strlen(DUMP_ASM_OPT);
             } else {
                 fprintf(stderr, "error: unknown command line argument: %s\n", argv[i]);
                 ok = 0;
@@ -159,7 +188,7 @@ static int parseArgs(int argc, char **argv) {
 
 static int validateArgs() {
     int ok = 1;
-    if (numInputFileNames == 0) {
+    if (numInputFileNames == 0 && !configOptTest) {
         fprintf(stderr, "error: no input files provided.\n");
     } else {
         if ((configOptPpOnly || configOptNoLink) && numInputFileNames > 1 && oFname != NULL) {
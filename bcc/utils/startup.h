@@ -14,10 +14,11 @@ extern int configOptTackyOnly;
 extern int configOptCodegenOnly;
 extern int configOptNoAssemble;
 extern int configOptNoLink;
+extern char const *configOptScanKernel;
 
-extern int traceAstMem;
-extern int traceTokens;
-extern int traceResolution;
+extern char const *configOptDumpAst;
+extern char const *configOptDumpIr;
+extern char const *configOptDumpAsm;
 
 extern char const *inputFname;
 extern int inputFileIsC;
@@ -0,0 +1,218 @@
+//
+// Created by Bill Evans on 10/17/26.
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "inc/strpool.h"
+#include "inc/arena.h"
+#include "inc/utils.h"
+
+/*
+ * The pool may be used by several threads at once.
+ *
+ * The entries are kept in fixed-size chunks, which never move once allocated, so looking up an id is
+ * wait-free: two loads, no lock.
+ *
+ * The hash index is split into shards, by the high bits of the hash. Looking up a string that is already
+ * interned takes no lock; each slot is published with a release store after its entry is complete. Adding
+ * a string takes its shard's lock, and looks again, in case another thread added it first. A shard's index
+ * grows by building a new one and publishing it; the old one is kept, since a reader may still be probing
+ * it. A reader that misses in an old index only falls through to the locked path, which uses the new one.
+ */
+
+// Shards of the hash index, chosen by the top bits of the hash. A power of two.
+#define STRPOOL_SHARD_BITS 6
+#define STRPOOL_NUM_SHARDS (1 << STRPOOL_SHARD_BITS)
+// Initial size of each shard's hash index, a power of two.
+#define STRPOOL_INITIAL_INDEX_SIZE 64
+#define STRPOOL_BLOCK_SIZE (16*1024)
+// Entries per chunk, and the most chunks there can be.
+#define STRPOOL_CHUNK_BITS 14
+#define STRPOOL_CHUNK_SIZE (1u << STRPOOL_CHUNK_BITS)
+#define STRPOOL_MAX_CHUNKS (1u << (32 - STRPOOL_CHUNK_BITS))
+
+// Each interned string, with its length and hash, so that neither is ever computed again.
+struct strpool_entry {
+    const char *text;
+    uint32_t length;
+    uint32_t hash;
+};
+// The entry for id is chunks[id >> STRPOOL_CHUNK_BITS][id & (STRPOOL_CHUNK_SIZE-1)]. entries[0] is the NULL string.
+static struct strpool_entry *_Atomic chunks[STRPOOL_MAX_CHUNKS];
+static _Atomic uint32_t num_strings = 0;
+
+// Open-addressed hash index from string to id, at most half full. 0 is an empty slot.
+struct strpool_index {
+    uint32_t mask;
+    struct strpool_index *retired;  // The index this one replaced, still possibly in use by a reader.
+    _Atomic uint32_t slots[];
+};
+struct strpool_shard {
+    pthread_mutex_t lock;           // Held to add a string.
+    struct strpool_index *_Atomic index;
+    uint32_t count;                 // Strings in this shard.
+    struct arena text_arena;        // The text of the shard's strings, which never moves.
+} __attribute__((aligned(64)));
+static struct strpool_shard shards[STRPOOL_NUM_SHARDS];
+
+static atomic_int initialized = 0;
+static pthread_once_t init_once = PTHREAD_ONCE_INIT;
+
+static struct strpool_index *strpool_new_index(uint32_t size) {
+    struct strpool_index *index = calloc(1, sizeof(struct strpool_index) + size * sizeof(uint32_t));
+    if (!index) fail("Out of memory");
+    index->mask = size - 1;
+    return index;
+}
+
+static void strpool_init_once(void) {
+    for (int ix = 0; ix < STRPOOL_NUM_SHARDS; ix++) {
+        pthread_mutex_init(&shards[ix].lock, NULL);
+        arena_init(&shards[ix].text_arena, STRPOOL_BLOCK_SIZE);
+        atomic_store_explicit(&shards[ix].index, strpool_new_index(STRPOOL_INITIAL_INDEX_SIZE), memory_order_relaxed);
+    }
+    struct strpool_entry *chunk = malloc(STRPOOL_CHUNK_SIZE * sizeof(struct strpool_entry));
+    chunk[0] = (struct strpool_entry){.text = NULL};
+    atomic_store_explicit(&chunks[0], chunk, memory_order_relaxed);
+    atomic_store_explicit(&num_strings, 1, memory_order_relaxed);
+    atomic_store_explicit(&initialized, 1, memory_order_release);
+}
+
+/**
+ * Initializes the string pool. Calling it again, from any thread, has no effect.
+ */
+void strpool_init(void) {
+    pthread_once(&init_once, strpool_init_once);
+}
+
+static inline struct strpool_entry *strpool_entry(uint32_t id) {
+    return &atomic_load_explicit(&chunks[id >> STRPOOL_CHUNK_BITS], memory_order_acquire)[id & (STRPOOL_CHUNK_SIZE-1)];
+}
+
+// Looks for a string in one index of a shard. Returns its id, or 0 if it isn't there; *pSlot is where the probe ended.
+static inline uint32_t strpool_probe(struct strpool_index *index, const char *str, uint32_t length, uint32_t hash, uint32_t *pSlot) {
+    uint32_t slot = hash & index->mask;
+    uint32_t id;
+    while ((id = atomic_load_explicit(&index->slots[slot], memory_order_acquire)) != 0) {
+        // Only strings with the same hash and length need their characters compared.
+        struct strpool_entry *entry = strpool_entry(id);
+        if (entry->hash == hash && entry->length == length && memcmp(entry->text, str, length) == 0) {
+            return id;
+        }
+        slot = (slot + 1) & index->mask;
+    }
+    *pSlot = slot;
+    return 0;
+}
+
+// Rebuilds a shard's hash index at twice its size, from the cached hashes, and publishes it. Called with the shard locked.
+static void strpool_grow_index(struct strpool_shard *shard) {
+    struct strpool_index *old = atomic_load_explicit(&shard->index, memory_order_relaxed);
+    struct strpool_index *index = strpool_new_index((old->mask + 1) * 2);
+    index->retired = old;
+    for (uint32_t ix = 0; ix <= old->mask; ++ix) {
+        uint32_t id = atomic_load_explicit(&old->slots[ix], memory_order_relaxed);
+        if (!id) continue;
+        uint32_t slot = strpool_entry(id)->hash & index->mask;
+        while (atomic_load_explicit(&index->slots[slot], memory_order_relaxed) != 0) slot = (slot + 1) & index->mask;
+        atomic_store_explicit(&index->slots[slot], id, memory_order_relaxed);
+    }
+    atomic_store_explicit(&shard->index, index, memory_order_release);
+}
+
+// Allocates the next id, and the chunk for it if it is the first of its chunk.
+static uint32_t strpool_new_id(void) {
+    uint32_t id = atomic_fetch_add_explicit(&num_strings, 1, memory_order_relaxed);
+    if (id == UINT32_MAX) fail("Too many strings");
+    struct strpool_entry *_Atomic *pChunk = &chunks[id >> STRPOOL_CHUNK_BITS];
+    if (!atomic_load_explicit(pChunk, memory_order_acquire)) {
+        // Another thread may be allocating the same chunk; the first to publish it wins.
+        struct strpool_entry *chunk = malloc(STRPOOL_CHUNK_SIZE * sizeof(struct strpool_entry));
+        if (!chunk) fail("Out of memory");
+        struct strpool_entry *expected = NULL;
+        if (!atomic_compare_exchange_strong_explicit(pChunk, &expected, chunk, memory_order_acq_rel, memory_order_acquire)) {
+            free(chunk);
+        }
+    }
+    return id;
+}
+
+/**
+ * Interns a length-delimited string; it need not be NUL-terminated. Safe to call from any thread.
+ * @param str the characters of the string.
+ * @param length of the string.
+ * @return the id of the string, the same id for every call with the same characters.
+ */
+uint32_t strpool_intern_n(const char *str, size_t length) {
+    if (!atomic_load_explicit(&initialized, memory_order_acquire)) strpool_init();
+    uint32_t hash = (uint32_t)hash_bytes(str, length);
+    struct strpool_shard *shard = &shards[hash >> (32 - STRPOOL_SHARD_BITS)];
+    uint32_t slot;
+    uint32_t id = strpool_probe(atomic_load_explicit(&shard->index, memory_order_acquire), str, length, hash, &slot);
+    if (id) return id;
+
+    pthread_mutex_lock(&shard->lock);
+    // Look again, in the current index; another thread may have added the string, or grown the index.
+    struct strpool_index *index = atomic_load_explicit(&shard->index, memory_order_relaxed);
+    id = strpool_probe(index, str, length, hash, &slot);
+    if (!id) {
+        char *text = arena_alloc(&shard->text_arena, length + 1);
+        memcpy(text, str, length);
+        text[length] = '\0';
+        id = strpool_new_id();
+        *strpool_entry(id) = (struct strpool_entry){.text = text, .length = (uint32_t)length, .hash = hash};
+        // The entry is complete before any reader can find its id.
+        atomic_store_explicit(&index->slots[slot], id, memory_order_release);
+        if (++shard->count * 2 > index->mask + 1) {
+            strpool_grow_index(shard);
+        }
+    }
+    pthread_mutex_unlock(&shard->lock);
+    return id;
+}
+
+/**
+ * Interns a NUL-terminated string.
+ * @param str to be interned. May be NULL, which is id 0.
+ * @return the id of the string.
+ */
+uint32_t strpool_intern(const char *str) {
+    if (!str) return 0;
+    return strpool_intern_n(str, strlen(str));
+}
+
+/**
+ * The string with the given id.
+ * @param id of an interned string.
+ * @return the string, or NULL for id 0. Valid for the life of the program.
+ */
+const char *strpool_str(uint32_t id) {
+    return strpool_entry(id)->text;
+}
+
+/**
+ * @param id of an interned string.
+ * @return the length of the string, without computing it.
+ */
+uint32_t strpool_length(uint32_t id) {
+    return strpool_entry(id)->length;
+}
+
+/**
+ * @param id of an interned string.
+ * @return the hash of the string, as hash_bytes() computed it when the string was interned.
+ */
+uint32_t strpool_hash(uint32_t id) {
+    return strpool_entry(id)->hash;
+}
+
+/**
+ * @return the number of ids issued, including id 0.
+ */
+uint32_t strpool_count(void) {
+    return atomic_load_explicit(&num_strings, memory_order_acquire);
+}
@@ -0,0 +1,175 @@
+//
+// Created by Bill Evans on 10/17/26.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "inc/strpool.h"
+#include "inc/utils.h"
+#include "../parser/idtable.h"
+
+// Interns done by all the threads together, in each round.
+#define CONTENTION_TEST_OPS (1 << 21)
+// Names shared by all the threads; most interns are of one of these, as most are of names already seen.
+#define CONTENTION_TEST_VOCABULARY 4096
+// One intern in this many is of a name new to the pool.
+#define CONTENTION_TEST_NEW_EVERY 10
+#define CONTENTION_TEST_MAX_THREADS 64
+// Uniquifiers given to each thread by the deterministic naming check.
+#define UNIQUIFIER_TEST_RANGE 1000
+#define UNIQUIFIER_TEST_NAMES 3
+
+struct contention_worker {
+    pthread_t thread;
+    int thread_ix;
+    int num_ops;
+    const char **vocabulary;
+    const char **new_names;         // Names only this thread interns.
+    uint32_t *ids;                  // The id each intern returned.
+    pthread_barrier_t *start;
+};
+
+// The name interned by a worker's ix'th intern.
+static const char *contention_name(const struct contention_worker *worker, int ix) {
+    if (ix % CONTENTION_TEST_NEW_EVERY == CONTENTION_TEST_NEW_EVERY - 1) {
+        return worker->new_names[ix / CONTENTION_TEST_NEW_EVERY];
+    }
+    return worker->vocabulary[((uint32_t)ix * 2654435761u + worker->thread_ix * 40503u) % CONTENTION_TEST_VOCABULARY];
+}
+
+static void *contention_worker_main(void *arg) {
+    struct contention_worker *worker = arg;
+    pthread_barrier_wait(worker->start);
+    for (int ix = 0; ix < worker->num_ops; ix++) {
+        worker->ids[ix] = strpool_intern(contention_name(worker, ix));
+    }
+    return NULL;
+}
+
+/**
+ * Runs one round of the contention benchmark: the threads all start together, and intern names, most of
+ * them shared with the other threads, the rest new. Every thread must get the same id for the same name.
+ * @param round number, which makes this round's names new to the pool.
+ * @param num_threads to run.
+ * @param seconds receives the time the interning took.
+ * @return the number of wrong ids.
+ */
+static int contention_round(int round, int num_threads, double *seconds) {
+    char buf[48];
+    const char **vocabulary = malloc(CONTENTION_TEST_VOCABULARY * sizeof(const char *));
+    for (int ix = 0; ix < CONTENTION_TEST_VOCABULARY; ix++) {
+        sprintf(buf, "r%d.shared.%d", round, ix);
+        vocabulary[ix] = strdup(buf);
+    }
+    struct contention_worker workers[CONTENTION_TEST_MAX_THREADS];
+    pthread_barrier_t start;
+    pthread_barrier_init(&start, NULL, num_threads + 1);
+    int num_ops = CONTENTION_TEST_OPS / num_threads;
+    int num_new = num_ops / CONTENTION_TEST_NEW_EVERY;
+    for (int t = 0; t < num_threads; t++) {
+        struct contention_worker *worker = &workers[t];
+        *worker = (struct contention_worker){.thread_ix = t, .num_ops = num_ops, .vocabulary = vocabulary,
+                                             .ids = malloc(num_ops * sizeof(uint32_t)), .start = &start};
+        worker->new_names = malloc(num_new * sizeof(const char *));
+        for (int ix = 0; ix < num_new; ix++) {
+            sprintf(buf, "r%d.t%d.new.%d", round, t, ix);
+            worker->new_names[ix] = strdup(buf);
+        }
+        pthread_create(&worker->thread, NULL, contention_worker_main, worker);
+    }
+    pthread_barrier_wait(&start);
+    double begin = now_seconds();
+    for (int t = 0; t < num_threads; t++) {
+        pthread_join(workers[t].thread, NULL);
+    }
+    *seconds = now_seconds() - begin;
+    pthread_barrier_destroy(&start);
+
+    int errors = 0;
+    for (int t = 0; t < num_threads; t++) {
+        struct contention_worker *worker = &workers[t];
+        for (int ix = 0; ix < num_ops; ix++) {
+            const char *name = contention_name(worker, ix);
+            if (worker->ids[ix] != strpool_intern(name) || strcmp(strpool_str(worker->ids[ix]), name) != 0) {
+                ++errors;
+            }
+        }
+        for (int ix = 0; ix < num_new; ix++) free((char *)worker->new_names[ix]);
+        free(worker->new_names);
+        free(worker->ids);
+    }
+    for (int ix = 0; ix < CONTENTION_TEST_VOCABULARY; ix++) free((char *)vocabulary[ix]);
+    free(vocabulary);
+    return errors;
+}
+
+struct uniquifier_worker {
+    pthread_t thread;
+    int range;
+    uint32_t names[UNIQUIFIER_TEST_NAMES];
+};
+
+static void *uniquifier_worker_main(void *arg) {
+    struct uniquifier_worker *worker = arg;
+    set_uniquifier_range(worker->range * UNIQUIFIER_TEST_RANGE, (worker->range + 1) * UNIQUIFIER_TEST_RANGE);
+    for (int ix = 0; ix < UNIQUIFIER_TEST_NAMES; ix++) {
+        worker->names[ix] = strpool_intern(uniquify_name("%.100s.%d", "uniquifier_test"));
+    }
+    return NULL;
+}
+
+/**
+ * Checks that threads given ranges of uniquifiers make the same names however they are scheduled.
+ * @return the number of wrong names.
+ */
+static int uniquifier_check(void) {
+    struct uniquifier_worker workers[CONTENTION_TEST_MAX_THREADS];
+    for (int t = 0; t < CONTENTION_TEST_MAX_THREADS; t++) {
+        // Hand the ranges out in reverse, so the threads started first get the highest ranges.
+        workers[t].range = CONTENTION_TEST_MAX_THREADS - 1 - t;
+        pthread_create(&workers[t].thread, NULL, uniquifier_worker_main, &workers[t]);
+    }
+    int errors = 0;
+    char expected[48];
+    for (int t = 0; t < CONTENTION_TEST_MAX_THREADS; t++) {
+        pthread_join(workers[t].thread, NULL);
+        for (int ix = 0; ix < UNIQUIFIER_TEST_NAMES; ix++) {
+            sprintf(expected, "uniquifier_test.%d", workers[t].range * UNIQUIFIER_TEST_RANGE + ix);
+            if (strcmp(strpool_str(workers[t].names[ix]), expected) != 0) ++errors;
+        }
+    }
+    return errors;
+}
+
+/**
+ * Interns names from 1 to 64 threads at once, timing each, and checks that every thread got the same id
+ * for the same name. Also checks that uniquified names depend only on the uniquifier ranges given to the
+ * threads.
+ * @return the number of failures.
+ */
+int strpool_concurrency_test(void) {
+    int failures = 0;
+    printf("String pool contention, %d interns, 1 in %d new:\n", CONTENTION_TEST_OPS, CONTENTION_TEST_NEW_EVERY);
+    double single = 0;
+    int round = 0;
+    for (int num_threads = 1; num_threads <= CONTENTION_TEST_MAX_THREADS; num_threads *= 2) {
+        double seconds;
+        int errors = contention_round(++round, num_threads, &seconds);
+        if (num_threads == 1) single = seconds;
+        printf("  %2d threads: %8.1f ms, %6.1f M interns/s, %5.2fx one thread\n", num_threads, seconds * 1e3,
+               CONTENTION_TEST_OPS / seconds / 1e6, single / seconds);
+        if (errors) {
+            printf("FAIL: %d threads: %d wrong ids\n", num_threads, errors);
+            ++failures;
+        }
+    }
+    int errors = uniquifier_check();
+    if (errors) {
+        printf("FAIL: %d wrong uniquified names\n", errors);
+        ++failures;
+    }
+    return test_result("string pool concurrency", failures);
+}
@@ -0,0 +1,46 @@
+//
+// Created by Bill Evans on 10/17/26.
+//
+
+#include <string.h>
+
+#include "trace.h"
+
+static const char *const trace_category_names[] = {
+#define X(a,b) b
+    TRACE_CATEGORY_LIST__
+#undef X
+};
+#define NUM_TRACE_CATEGORIES ((int)(sizeof(trace_category_names)/sizeof(trace_category_names[0])))
+
+// Bit n set if category n is enabled.
+unsigned int trace_categories = 0;
+
+/**
+ * Enables trace categories.
+ * @param names a comma separated list of category names, or "all".
+ * @return 1 if every name is a category, 0 otherwise.
+ */
+int trace_enable(const char *names) {
+    int ok = 1;
+    while (*names) {
+        size_t length = strcspn(names, ",");
+        if (length == 3 && strncmp(names, "all", 3) == 0) {
+            trace_categories = (1u << NUM_TRACE_CATEGORIES) - 1;
+        } else {
+            int ix;
+            for (ix = 0; ix < NUM_TRACE_CATEGORIES; ++ix) {
+                if (strlen(trace_category_names[ix]) == length && strncmp(names, trace_category_names[ix], length) == 0) break;
+            }
+            if (ix < NUM_TRACE_CATEGORIES) {
+                trace_categories |= 1u << ix;
+            } else {
+                fprintf(stderr, "error: unknown trace category: %.*s\n", (int)length, names);
+                ok = 0;
+            }
+        }
+        names += length;
+        if (*names == ',') ++names;
+    }
+    return ok;
+}
@@ -0,0 +1,39 @@
+//
+// Created by Bill Evans on 10/17/26.
+//
+
+#ifndef BCC_TRACE_H
+#define BCC_TRACE_H
+
+#include <stdio.h>
+
+/*
+ * Trace points, by category. A category is enabled at run time with "--trace=tokens,scopes" (or "--trace=all").
+ * Building with BCC_NO_TRACE defined compiles every trace point out.
+ */
+#define TRACE_CATEGORY_LIST__ \
+    X(TOKENS,       "tokens"),          \
+    X(RESOLUTION,   "resolution"),      \
+    X(SCOPES,       "scopes"),          \
+    X(MEM,          "mem"),
+
+enum TRACE_CATEGORY {
+#define X(a,b) TRACE_##a
+    TRACE_CATEGORY_LIST__
+#undef X
+};
+
+extern unsigned int trace_categories;
+
+#ifdef BCC_NO_TRACE
+#define trace_enabled(category) 0
+#else
+#define trace_enabled(category) ((trace_categories & (1u << (category))) != 0)
+#endif
+
+// The arguments are not evaluated unless the category is enabled.
+#define TRACE(category, ...) do { if (trace_enabled(category)) printf(__VA_ARGS__); } while (0)
+
+extern int trace_enable(const char *names);
+
+#endif //BCC_TRACE_H
@@ -6,22 +6,47 @@
 #include <string.h>
 #include <stdio.h>
 #include <stdarg.h>
+#include <stdint.h>
+#include <limits.h>
+#include <time.h>
 
 #include "inc/set_of.h"
 #include "inc/utils.h"
 
-unsigned long hash_str(const char *str)
+/**
+ * Hash of a length-delimited string, taken a 64-bit word at a time (in the manner of FxHash), with the
+ * last partial word zero-padded, and a final mix so that the low bits depend on every byte.
+ * @param str the characters to hash.
+ * @param length of str.
+ * @return the hash.
+ */
+unsigned long hash_bytes(const char *str, size_t length)
 {
-    unsigned long hash = 5381;
-    int c;
-
-    while ((c = (unsigned char)*str++)) {
-        hash = ((hash << 5) + hash) + c;
-    } /* hash * 33 + c */
-
+    const uint64_t seed = 0x517cc1b727220a95ul;
+    uint64_t hash = length * seed;
+    uint64_t word;
+    while (length >= sizeof(word)) {
+        memcpy(&word, str, sizeof(word));
+        hash = (((hash << 5) | (hash >> 59)) ^ word) * seed;
+        str += sizeof(word);
+        length -= sizeof(word);
+    }
+    if (length) {
+        word = 0;
+        memcpy(&word, str, length);
+        hash = (((hash << 5) | (hash >> 59)) ^ word) * seed;
+    }
+    hash ^= hash >> 32;
+    hash *= 0x9E3779B97F4A7C15ul;
+    hash ^= hash >> 29;
     return hash;
 }
 
+unsigned long hash_str(const char *str)
+{
+    return hash_bytes(str, strlen(str));
+}
+
 int long_is_zero(long l) {
     return l == 0;
 }
@@ -40,13 +65,54 @@ void failf(const char* fmt, ...) {
     exit(1);
 }
 
+// Each thread numbers its own names, from its own range; see set_uniquifier_range().
+static _Thread_local int uniquifier = 0;
+static _Thread_local int uniquifier_limit = INT_MAX;
+
+/**
+ * The next number with which to make a name unique. Each thread has its own counter, so threads never
+ * contend for it.
+ * @return the number.
+ */
 int next_uniquifier(void) {
-    static int counter = 0;
-    return counter++;
+    if (uniquifier == uniquifier_limit) fail("Ran out of uniquifiers");
+    return uniquifier++;
+}
+
+/**
+ * Gives the calling thread a range of uniquifiers of its own. Work handed to threads gets ranges fixed by
+ * the work itself, eg, by a function's position in the file, so that the names made don't depend on which
+ * thread does the work, or when.
+ * @param first uniquifier of the range.
+ * @param limit one past the last uniquifier of the range.
+ */
+void set_uniquifier_range(int first, int limit) {
+    uniquifier = first;
+    uniquifier_limit = limit;
 }
 
 long identity(long l) { return l; }
 
+/**
+ * @return a monotonic time, in seconds, for timing the built-in tests and benchmarks.
+ */
+double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * Reports the result of one of the built-in tests; any failures have been reported as they were found.
+ * @param what was tested.
+ * @param failures found by the test.
+ * @return failures.
+ */
+int test_result(const char *what, int failures) {
+    if (!failures) printf("PASS: %s\n", what);
+    return failures;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 //
 // Set implementation for "strings".
@@ -79,8 +145,4 @@ struct set_of_int_helpers set_of_int_helpers = {
         .is_null = (int (*)(int)) long_is_zero,
 };
 
-struct list_of_int_helpers list_of_int_helpers = {
-        .delete = no_delete,
-        .null = 0,
-};
-LIST_OF_ITEM_DEFN(list_of_int,int)
+LIST_OF_ITEM_DEFN_STATIC(list_of_int,int,LIST_OF_NO_DELETE)